@@ -0,0 +1,73 @@
+#pragma once
+#include "Helgelse/DamageTracker.hpp"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Helgelse {
+enum struct RenderMode {
+	Continuous, // render every window each refresh
+	OnChange	// sleep until a window's subtree receives an insert or an event
+};
+
+// Shared between inserting threads and the frame loop, records which windows need a new frame and where
+struct ChangeTracker {
+	ChangeTracker(std::function<void()> wake={}) : wake(std::move(wake)) {}
+
+	auto setMode(RenderMode mode) {
+		this->mode = mode;
+		this->notify();
+	}
+	auto renderMode() const -> RenderMode { return this->mode; }
+
+	auto markChanged(std::string_view window) {
+		{
+			std::lock_guard lock(this->mutex);
+			this->damageOf(window).add(DamageRegion::everything());
+		}
+		this->notify();
+	}
+
+	auto markDamaged(std::string_view window, Rect const &rect) {
+		{
+			std::lock_guard lock(this->mutex);
+			this->damageOf(window).add(rect);
+		}
+		this->notify();
+	}
+
+	// What changed in the window since it was last taken, nullopt when nothing did. The frame loop's only way to ask
+	auto takeDamage(std::string_view window) -> std::optional<DamageRegion> {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->changed.find(window);
+		if(it==this->changed.end())
+			return std::nullopt;
+		auto damage = std::move(it->second);
+		this->changed.erase(it);
+		return damage;
+	}
+
+private:
+	// Only the first change to a window since its last frame allocates
+	auto damageOf(std::string_view window) -> DamageRegion& {
+		if(auto const it = this->changed.find(window); it != this->changed.end())
+			return it->second;
+		return this->changed.emplace(std::string(window), DamageRegion{}).first->second;
+	}
+
+	auto notify() -> void {
+		if(this->wake)
+			this->wake();
+	}
+
+	std::atomic<RenderMode> mode = RenderMode::Continuous;
+	std::mutex mutex;
+	std::map<std::string, DamageRegion, std::less<>> changed;
+	std::function<void()> wake;
+};
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Helgelse {
+// A storage buffer of the job, bound at its index in ComputeJob::buffers
+struct ComputeBuffer {
+	std::vector<uint8_t> data; // initial contents, the rest up to size is zero
+	size_t size = 0;		   // 0 means data.size()
+};
+
+/*
+Inserted at "/graphics/compute/<name>": dispatches the shader inserted at
+"/graphics/shaders/<shader>" with groups workgroups, its buffers bound to set 0 in
+order and pushConstants at offset 0. Grabbing "/graphics/compute/<name>" as a
+ComputeResult returns the buffers once the GPU is done, grabBlock waits for that.
+*/
+struct ComputeJob {
+	std::string shader;
+	std::vector<ComputeBuffer> buffers;
+	std::array<uint32_t, 3> groups{1, 1, 1};
+	std::vector<uint8_t> pushConstants;
+};
+
+// Every buffer of the job as the shader left it
+struct ComputeResult {
+	std::vector<std::vector<uint8_t>> buffers;
+};
+
+// Every Vulkan device takes at least 128 bytes of push constants
+constexpr size_t ComputePushConstantBytes = 128;
+
+inline auto compute_buffer_size(ComputeBuffer const &buffer) -> size_t {
+	return std::max(buffer.size, buffer.data.size());
+}
+
+inline auto compute_job_valid(ComputeJob const &job) -> bool {
+	if(job.shader.empty() || job.buffers.empty() || job.pushConstants.size() > ComputePushConstantBytes || job.pushConstants.size() % 4 != 0)
+		return false;
+	for(auto const groups : job.groups)
+		if(groups==0)
+			return false;
+	for(auto const &buffer : job.buffers)
+		if(compute_buffer_size(buffer)==0)
+			return false;
+	return true;
+}
+}
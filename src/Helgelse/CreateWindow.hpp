@@ -1,15 +1,31 @@
 #pragma once
+#include <optional>
 #include <string>
 #include "nlohmann/json.hpp"
 
 namespace Helgelse {
 struct CreateWindow {
     bool operator==(CreateWindow const&) const = default;
-    const char *title = "";
-    bool fullscreen = false;
+    const char *title = "";             // the window's path name when empty
+    bool fullscreen = false;            // exclusive fullscreen on the chosen monitor
+    int width = 0;                      // 0 means 800x600 windowed, the monitor's native mode in fullscreen
+    int height = 0;
+    std::optional<int> x;               // relative to the chosen monitor, centered when not set
+    std::optional<int> y;
+    int monitor = 0;                    // index into glfwGetMonitors, 0 is the primary monitor
+    bool resizable = true;
+    bool decorated = true;
+    bool floating = false;              // always on top
+    bool transparent = false;           // composited with the desktop through the framebuffer's alpha
+    int refreshRate = 0;                // fullscreen refresh rate in Hz, 0 picks the monitor's native rate
+    bool vsync = true;                  // FIFO presentation, otherwise mailbox or immediate when available
 };
-}
 
-inline void to_json(nlohmann::json& j, const Helgelse::CreateWindow& c) {
-    j = nlohmann::json{{"title", c.title}, {"fullscreen", c.fullscreen}};
-}
\ No newline at end of file
+// In the struct's namespace so nlohmann finds it through ADL
+inline void to_json(nlohmann::json& j, const CreateWindow& c) {
+    j = nlohmann::json{{"title", c.title}, {"fullscreen", c.fullscreen}, {"width", c.width}, {"height", c.height},
+                       {"x", c.x ? nlohmann::json(*c.x) : nlohmann::json()}, {"y", c.y ? nlohmann::json(*c.y) : nlohmann::json()},
+                       {"monitor", c.monitor}, {"resizable", c.resizable}, {"decorated", c.decorated}, {"floating", c.floating},
+                       {"transparent", c.transparent}, {"refreshRate", c.refreshRate}, {"vsync", c.vsync}};
+}
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include "Helgelse/Compute.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Helgelse {
+// Laid out like VkDrawIndexedIndirectCommand, what the cull shader writes and the draw consumes
+struct DrawIndexedIndirect {
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+};
+static_assert(sizeof(DrawIndexedIndirect)==20);
+
+// One entry of the instance buffer, std430 pads the struct to the alignment of its vec4
+struct CullInstance {
+	std::array<float, 4> sphere{}; // world space center and radius
+	DrawIndexedIndirect draw;	   // issued as is when the sphere is visible
+	uint32_t padding[3]{};
+};
+static_assert(sizeof(CullInstance)==48);
+
+// Planes as (normal, distance) with normals pointing inside, a point p is inside when dot(normal, p) + distance >= 0
+using Frustum = std::array<std::array<float, 4>, 6>;
+
+// Column major view projection with Vulkan's 0..1 depth range
+inline auto frustum_planes(std::array<float, 16> const &viewProjection) -> Frustum {
+	auto const row = [&](int i) { return std::array<float, 4>{viewProjection[i], viewProjection[4+i], viewProjection[8+i], viewProjection[12+i]}; };
+	auto const normalize = [](std::array<float, 4> plane) {
+		auto const length = std::sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+		if(length > 0.0f)
+			for(auto &value : plane)
+				value /= length;
+		return plane;
+	};
+	auto const add = [](std::array<float, 4> const &a, std::array<float, 4> const &b, float sign) {
+		return std::array<float, 4>{a[0]+sign*b[0], a[1]+sign*b[1], a[2]+sign*b[2], a[3]+sign*b[3]};
+	};
+	auto const x = row(0), y = row(1), z = row(2), w = row(3);
+	// Left, right, bottom, top, near at z = 0 and far at z = w
+	return Frustum{normalize(add(w, x, 1.0f)), normalize(add(w, x, -1.0f)), normalize(add(w, y, 1.0f)), normalize(add(w, y, -1.0f)), normalize(z), normalize(add(w, z, -1.0f))};
+}
+
+inline auto frustum_contains_sphere(Frustum const &frustum, std::array<float, 4> const &sphere) -> bool {
+	for(auto const &plane : frustum)
+		if(plane[0]*sphere[0] + plane[1]*sphere[1] + plane[2]*sphere[2] + plane[3] < -sphere[3])
+			return false;
+	return true;
+}
+
+// The cull shader's push constants
+struct CullPushConstants {
+	Frustum planes{};
+	uint32_t count = 0;
+	uint32_t compact = 1; // 0 without drawIndirectCount: every slot is written, culled ones with no instances
+};
+static_assert(sizeof(CullPushConstants) <= ComputePushConstantBytes);
+
+constexpr uint32_t CullGroupSize = 64;
+
+inline auto cull_groups(uint32_t count) -> uint32_t {
+	return (count + CullGroupSize-1) / CullGroupSize;
+}
+
+// What the shader does, for tests and for checking a replacement shader against
+inline auto cull_instances(Frustum const &frustum, std::vector<CullInstance> const &instances, bool compact=true) -> std::vector<DrawIndexedIndirect> {
+	std::vector<DrawIndexedIndirect> draws;
+	for(auto const &instance : instances) {
+		auto const visible = frustum_contains_sphere(frustum, instance.sphere);
+		if(visible || !compact) {
+			draws.push_back(instance.draw);
+			if(!visible)
+				draws.back().instanceCount = 0;
+		}
+	}
+	return draws;
+}
+
+/*
+Inserted at "/graphics/windows/<window>/culling/<name>": every frame of the window culls
+the instances against the view inserted at ".../culling/<name>/view" on the GPU and
+draws the survivors from the mesh arena over the window's contents, so no per-instance
+work happens on the CPU. A draw's ranges come from the MeshInfo of the mesh, e.g. with
+mesh_draw. The shaders are looked up in the shader library, CullShaderSource,
+CulledVertexShaderSource and CulledFragmentShaderSource are what they must be
+compatible with. An empty instance list removes the set.
+*/
+struct CullSet {
+	std::vector<CullInstance> instances;
+	std::string shader = "cull";
+	std::string vertexShader = "culled.vert";
+	std::string fragmentShader = "culled.frag";
+};
+
+struct CullView {
+	std::array<float, 16> viewProjection{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+};
+
+// The draw's push constants, the vertex shader gets the view the set was culled with
+struct CulledDrawPushConstants {
+	std::array<float, 16> viewProjection{};
+};
+static_assert(sizeof(CulledDrawPushConstants)==64);
+
+/*
+Bindings follow the instance, command and count buffers, the push constants are
+CullPushConstants. Compacted draws come out in whatever order the invocations finish,
+windows have no depth buffer so where culled meshes overlap either may end up on top.
+*/
+constexpr char const *CullShaderSource = R"(#version 450
+layout(local_size_x = 64) in;
+
+struct DrawCommand {
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+struct Instance {
+	vec4 sphere;
+	DrawCommand draw;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, set = 0, binding = 1) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, set = 0, binding = 2) buffer Count { uint drawCount; };
+layout(push_constant) uniform Cull {
+	vec4 planes[6];
+	uint count;
+	uint compact;
+};
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if(i >= count)
+		return;
+	Instance instance = instances[i];
+	bool visible = true;
+	for(int p = 0; p < 6; ++p)
+		visible = visible && dot(planes[p].xyz, instance.sphere.xyz) + planes[p].w >= -instance.sphere.w;
+	if(compact != 0) {
+		if(visible)
+			commands[atomicAdd(drawCount, 1)] = instance.draw;
+	}
+	else {
+		DrawCommand draw = instance.draw;
+		draw.instanceCount = visible ? draw.instanceCount : 0;
+		commands[i] = draw;
+	}
+}
+)";
+
+/*
+Mesh positions are taken as world space, every instance of a draw lands on the same
+spot. Shaders that place instances differently keep the inputs and push constants.
+*/
+constexpr char const *CulledVertexShaderSource = R"(#version 450
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 uv;
+layout(location = 0) out vec3 worldNormal;
+layout(push_constant) uniform View {
+	mat4 viewProjection;
+};
+
+void main() {
+	worldNormal = normal;
+	gl_Position = viewProjection*vec4(position, 1.0);
+}
+)";
+
+constexpr char const *CulledFragmentShaderSource = R"(#version 450
+layout(location = 0) in vec3 worldNormal;
+layout(location = 0) out vec4 color;
+
+void main() {
+	float light = max(dot(normalize(worldNormal), normalize(vec3(0.3, 0.8, 0.5))), 0.0);
+	color = vec4(vec3(0.2 + 0.8*light), 1.0);
+}
+)";
+}
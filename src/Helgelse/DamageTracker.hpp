@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Helgelse {
+struct Rect {
+	bool operator==(Rect const&) const = default;
+	int32_t x = 0;
+	int32_t y = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	auto right() const -> int64_t { return int64_t(this->x) + this->width; }
+	auto bottom() const -> int64_t { return int64_t(this->y) + this->height; }
+	auto area() const -> uint64_t { return uint64_t(this->width) * this->height; }
+	auto empty() const -> bool { return this->width==0 || this->height==0; }
+
+	// Overlapping or edge-adjacent rects are cheaper to redraw as one
+	auto touches(Rect const &rhs) const -> bool {
+		return this->x <= rhs.right() && rhs.x <= this->right() && this->y <= rhs.bottom() && rhs.y <= this->bottom();
+	}
+
+	auto united(Rect const &rhs) const -> Rect {
+		auto const left = std::min(this->x, rhs.x);
+		auto const top	= std::min(this->y, rhs.y);
+		return Rect{left, top, uint32_t(std::max(this->right(), rhs.right()) - left), uint32_t(std::max(this->bottom(), rhs.bottom()) - top)};
+	}
+
+	auto clipped(uint32_t width, uint32_t height) const -> Rect {
+		auto const left	  = std::clamp<int64_t>(this->x, 0, width);
+		auto const top	  = std::clamp<int64_t>(this->y, 0, height);
+		auto const right  = std::clamp<int64_t>(this->right(), 0, width);
+		auto const bottom = std::clamp<int64_t>(this->bottom(), 0, height);
+		return Rect{int32_t(left), int32_t(top), uint32_t(right - left), uint32_t(bottom - top)};
+	}
+};
+
+// The part of a window that must be redrawn, either a few rects or everything
+struct DamageRegion {
+	static constexpr size_t MaxRects = 8;
+
+	static auto everything() -> DamageRegion { return DamageRegion{.full=true}; }
+
+	auto add(Rect rect) {
+		if(this->full || rect.empty())
+			return;
+		// Keep merging until the new rect no longer touches any existing one
+		for(auto it = this->rects.begin(); it != this->rects.end();) {
+			if(it->touches(rect)) {
+				rect = it->united(rect);
+				this->rects.erase(it);
+				it = this->rects.begin();
+			}
+			else
+				++it;
+		}
+		this->rects.push_back(rect);
+		// Past a handful of rects the bookkeeping costs more than it saves
+		if(this->rects.size() > MaxRects) {
+			auto bounds = this->rects.front();
+			for(auto const &r : this->rects)
+				bounds = bounds.united(r);
+			this->rects = {bounds};
+		}
+	}
+
+	auto add(DamageRegion const &region) {
+		if(region.full)
+			this->full = true;
+		if(this->full) {
+			this->rects.clear();
+			return;
+		}
+		for(auto const &rect : region.rects)
+			this->add(rect);
+	}
+
+	auto empty() const -> bool { return !this->full && this->rects.empty(); }
+
+	// Rects to redraw in a width x height target, a full region or one covering most of it becomes the whole target
+	auto resolve(uint32_t width, uint32_t height) const -> std::vector<Rect> {
+		Rect const whole{0, 0, width, height};
+		if(this->full)
+			return {whole};
+		std::vector<Rect> clipped;
+		uint64_t area = 0;
+		for(auto const &rect : this->rects)
+			if(auto const c = rect.clipped(width, height); !c.empty()) {
+				clipped.push_back(c);
+				area += c.area();
+			}
+		if(area*4 >= whole.area()*3)
+			return {whole};
+		return clipped;
+	}
+
+	bool full = false;
+	std::vector<Rect> rects;
+};
+
+/*
+Swapchain images keep whatever was last rendered into them, but an image we get back
+from acquire may be several frames old. The region it needs is the damage of every
+frame presented since that image was last drawn.
+*/
+struct DamageHistory {
+	auto reset(size_t imageCount) {
+		this->lastDrawn.assign(imageCount, Never);
+		this->frames.clear();
+	}
+
+	auto repairRegion(uint32_t image, DamageRegion const &damage) -> DamageRegion {
+		if(image >= this->lastDrawn.size() || this->lastDrawn[image]==Never)
+			return DamageRegion::everything();
+		// frames.back() is the previous frame, walk back to the one this image last showed
+		auto const missed = this->frame - this->lastDrawn[image];
+		if(missed > this->frames.size())
+			return DamageRegion::everything();
+		auto region = damage;
+		for(size_t i = 0; i < missed; ++i)
+			region.add(this->frames[this->frames.size()-1-i]);
+		return region;
+	}
+
+	auto drawn(uint32_t image, DamageRegion const &damage) {
+		if(image >= this->lastDrawn.size())
+			return;
+		this->frames.push_back(damage);
+		if(this->frames.size() > this->lastDrawn.size())
+			this->frames.pop_front();
+		this->lastDrawn[image] = ++this->frame;
+	}
+
+private:
+	static constexpr uint64_t Never = UINT64_MAX;
+	uint64_t frame = 0;
+	std::vector<uint64_t> lastDrawn;
+	std::deque<DamageRegion> frames;
+};
+}
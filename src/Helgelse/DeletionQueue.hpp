@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace Helgelse {
+/*
+Resources the GPU may still be using are retired with the timeline value of the last
+submit that could touch them and destroyed once the GPU has completed that value.
+Nothing waits on the device: removing one window never stalls rendering of the others.
+*/
+struct DeletionQueue {
+	auto retire(uint64_t value, std::function<void()> destroy) {
+		std::lock_guard lock(this->mutex);
+		// Values only grow, keep the queue sorted so collection stops at the first pending entry
+		auto it = this->pending.end();
+		while(it != this->pending.begin() && std::prev(it)->first > value)
+			--it;
+		this->pending.emplace(it, value, std::move(destroy));
+	}
+
+	// Destroys everything retired at or before the completed value, returns how many
+	auto collect(uint64_t completed) -> size_t {
+		std::deque<std::function<void()>> ready;
+		{
+			std::lock_guard lock(this->mutex);
+			while(!this->pending.empty() && this->pending.front().first <= completed) {
+				ready.push_back(std::move(this->pending.front().second));
+				this->pending.pop_front();
+			}
+		}
+		// Run outside the lock, a destructor may retire more
+		for(auto &destroy : ready)
+			destroy();
+		return ready.size();
+	}
+
+	// Only once the GPU is known to be idle, e.g. at shutdown
+	auto flush() -> size_t {
+		return this->collect(UINT64_MAX);
+	}
+
+	auto size() -> size_t {
+		std::lock_guard lock(this->mutex);
+		return this->pending.size();
+	}
+
+private:
+	std::mutex mutex;
+	std::deque<std::pair<uint64_t, std::function<void()>>> pending;
+};
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+
+namespace Helgelse {
+enum struct FramePacing {
+	QueueAhead, // let the CPU run ahead of the display, bounded by the frames in flight
+	LowLatency  // start the frame (and sample input) as late as the measured work allows
+};
+
+struct FramePacer {
+	using Clock = std::chrono::steady_clock;
+
+	FramePacer(FramePacing pacing=FramePacing::QueueAhead, Clock::duration refreshInterval=std::chrono::microseconds(16667))
+		: mode(pacing), refreshInterval(refreshInterval) {}
+
+	auto pacing() const -> FramePacing { return this->mode; }
+	auto setPacing(FramePacing pacing) { this->mode = pacing; }
+	auto setRefreshInterval(Clock::duration interval) { this->refreshInterval = interval; }
+	auto interval() const -> Clock::duration { return this->refreshInterval; }
+
+	// Predicted time from frame start to present, padded by the observed jitter so we rarely miss the vblank.
+	auto workEstimate() const -> Clock::duration { return this->workMean + 2*this->workDeviation; }
+	auto acquireToPresentLatency() const -> Clock::duration { return this->latencyMean; }
+
+	auto nextFrameStart(Clock::time_point now=Clock::now()) const -> Clock::time_point {
+		if(this->mode==FramePacing::QueueAhead || !this->hasVBlank)
+			return now;
+		auto const budget = this->workEstimate() + this->margin;
+		// Target the first vblank that still leaves room for the predicted work
+		auto target = this->lastVBlank + this->refreshInterval;
+		if(target - budget < now)
+			target += ((now + budget - target) / this->refreshInterval + 1) * this->refreshInterval;
+		return target - budget;
+	}
+
+	auto beginFrame(Clock::time_point now=Clock::now()) {
+		this->frameStart = now;
+	}
+
+	auto acquired(Clock::time_point now=Clock::now()) {
+		this->acquireTime = now;
+		// Without present timing the acquire returning is our best guess at where the vblank landed
+		if(!this->hasDisplayTiming) {
+			this->lastVBlank = now;
+			this->hasVBlank = true;
+		}
+	}
+
+	auto presented(Clock::time_point now=Clock::now()) {
+		update_estimate(this->workMean, this->workDeviation, now - this->frameStart);
+		auto deviation = Clock::duration::zero();
+		update_estimate(this->latencyMean, deviation, now - this->acquireTime);
+	}
+
+	// Called when VK_KHR_present_wait reports the frame reached the display
+	auto displayed(Clock::time_point now=Clock::now()) {
+		this->lastVBlank = now;
+		this->hasVBlank = true;
+		this->hasDisplayTiming = true;
+	}
+
+	// Like displayed, for a present that was polled: it reached the display after since and by now, on the vblank between them when the estimate has one
+	auto displayedBetween(Clock::time_point since, Clock::time_point now=Clock::now()) {
+		auto vblank = now;
+		if(this->hasVBlank && this->lastVBlank <= now) {
+			auto const grid = this->lastVBlank + (now - this->lastVBlank) / this->refreshInterval * this->refreshInterval;
+			if(grid > since)
+				vblank = grid;
+		}
+		this->displayed(vblank);
+	}
+
+private:
+	// Smoothed mean and mean deviation, same gains as the TCP round trip estimator
+	static auto update_estimate(Clock::duration &mean, Clock::duration &deviation, Clock::duration sample) -> void {
+		if(mean==Clock::duration::zero()) {
+			mean = sample;
+			deviation = sample/2;
+			return;
+		}
+		auto const error = sample - mean;
+		mean += error/8;
+		deviation += (std::max(error, -error) - deviation)/4;
+	}
+
+	FramePacing mode;
+	Clock::duration refreshInterval;
+	Clock::duration margin = std::chrono::microseconds(500);
+	Clock::duration workMean = Clock::duration::zero();
+	Clock::duration workDeviation = Clock::duration::zero();
+	Clock::duration latencyMean = Clock::duration::zero();
+	Clock::time_point frameStart;
+	Clock::time_point acquireTime;
+	Clock::time_point lastVBlank;
+	bool hasVBlank = false;
+	bool hasDisplayTiming = false;
+};
+}
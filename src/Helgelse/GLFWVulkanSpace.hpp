@@ -1,5 +1,21 @@
 #pragma once
+#include "Helgelse/ChangeTracker.hpp"
+#include "Helgelse/Compute.hpp"
 #include "Helgelse/CreateWindow.hpp"
+#include "Helgelse/Culling.hpp"
+#include "Helgelse/FramePacer.hpp"
+#include "Helgelse/Mesh.hpp"
+#include "Helgelse/PipelineCache.hpp"
+#include "Helgelse/RouteTable.hpp"
+#include "Helgelse/Shader.hpp"
+#include "Helgelse/ShaderWatcher.hpp"
+#include "Helgelse/TextureLoader.hpp"
+#include "Helgelse/Validation.hpp"
+#include "Helgelse/VulkanCompute.hpp"
+#include "Helgelse/VulkanContext.hpp"
+#include "Helgelse/VulkanMeshes.hpp"
+#include "Helgelse/VulkanTextures.hpp"
+#include "Helgelse/VulkanWindow.hpp"
 #include "FSNG/Path.hpp"
 #include "FSNG/Data.hpp"
 #include "FSNG/Forge/Forge.hpp"
@@ -9,7 +25,23 @@
 
 #include <magic_enum.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <string_view>
+#include <system_error>
 #include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <string>
 
@@ -28,19 +60,55 @@ auto glfw_init() -> bool {
 	return true;
 }
 
-auto glfw_create_window(auto const &applicationName, auto width, auto height) -> std::optional<GLFWwindow*> {
+auto glfw_monitor(int index) -> GLFWmonitor* {
+	int monitor_count = 0;
+	auto const monitors = glfwGetMonitors(&monitor_count);
+	if(index >= 0 && index < monitor_count)
+		return monitors[index];
+	return glfwGetPrimaryMonitor();
+}
+
+auto glfw_create_window(Helgelse::CreateWindow const &config, auto const &fallbackTitle) -> std::optional<GLFWwindow*> {
     // create window
+	glfwDefaultWindowHints();
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);		// This tells GLFW to not create an OpenGL context with the window
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-	if(auto window = glfwCreateWindow(width, height, applicationName, nullptr, nullptr))
-		return window;
-	return std::nullopt;
+	glfwWindowHint(GLFW_RESIZABLE, config.resizable ? GLFW_TRUE : GLFW_FALSE);
+	glfwWindowHint(GLFW_DECORATED, config.decorated ? GLFW_TRUE : GLFW_FALSE);
+	glfwWindowHint(GLFW_FLOATING, config.floating ? GLFW_TRUE : GLFW_FALSE);
+	glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, config.transparent ? GLFW_TRUE : GLFW_FALSE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);			// shown once it is in place
+
+	auto const monitor = glfw_monitor(config.monitor);
+	auto const mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+	auto const title = config.title && *config.title ? config.title : fallbackTitle;
+	auto width	= config.width > 0 ? config.width : 800;
+	auto height = config.height > 0 ? config.height : 600;
+	GLFWwindow *window = nullptr;
+	if(config.fullscreen && monitor && mode) {
+		// Exclusive fullscreen, by default in the monitor's native mode so the display never rescales or changes rate
+		glfwWindowHint(GLFW_REFRESH_RATE, config.refreshRate > 0 ? config.refreshRate : mode->refreshRate);
+		width  = config.width > 0 ? config.width : mode->width;
+		height = config.height > 0 ? config.height : mode->height;
+		window = glfwCreateWindow(width, height, title, monitor, nullptr);
+	}
+	else if((window = glfwCreateWindow(width, height, title, nullptr, nullptr))) {
+		int monitor_x = 0, monitor_y = 0;
+		if(monitor)
+			glfwGetMonitorPos(monitor, &monitor_x, &monitor_y);
+		auto const center_x = mode ? (mode->width - width)/2 : 0;
+		auto const center_y = mode ? (mode->height - height)/2 : 0;
+		glfwSetWindowPos(window, monitor_x + config.x.value_or(center_x), monitor_y + config.y.value_or(center_y));
+	}
+	if(!window)
+		return std::nullopt;
+	glfwShowWindow(window);
+	return window;
 }
 
 auto create_application_info(auto const &applicationName) -> VkApplicationInfo {
-	VkApplicationInfo application_info;
+	VkApplicationInfo application_info{};
 	application_info.sType				= VK_STRUCTURE_TYPE_APPLICATION_INFO;
-	application_info.apiVersion			= VK_MAKE_VERSION( 1, 0, 2 );
+	application_info.apiVersion			= VK_API_VERSION_1_2;	// timeline semaphores are core from 1.2
 	application_info.applicationVersion	= VK_MAKE_VERSION( 0, 0, 1 );
 	application_info.engineVersion		= VK_MAKE_VERSION( 0, 0, 1 );
 	application_info.pApplicationName	= applicationName;
@@ -48,15 +116,49 @@ auto create_application_info(auto const &applicationName) -> VkApplicationInfo {
     return application_info;
 }
 
-auto vulkan_create_instance(auto const &instance_layers, auto const &instance_extensions, auto const &applicationName) -> std::optional<VkInstance> {
+inline VKAPI_ATTR auto VKAPI_CALL vulkan_debug_message(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT,
+														 VkDebugUtilsMessengerCallbackDataEXT const *data, void*) -> VkBool32 {
+	std::cout << "Vulkan " << magic_enum::enum_name(severity) << ": " << data->pMessage << std::endl;
+	return VK_FALSE;
+}
+
+auto vulkan_debug_messenger_info() -> VkDebugUtilsMessengerCreateInfoEXT {
+	VkDebugUtilsMessengerCreateInfoEXT messenger_create_info{};
+	messenger_create_info.sType			  = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	messenger_create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	messenger_create_info.messageType	  = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	messenger_create_info.pfnUserCallback = vulkan_debug_message;
+	return messenger_create_info;
+}
+
+auto vulkan_create_instance(auto const &instance_layers, auto const &instance_extensions, auto const &applicationName, Helgelse::Validation validation) -> std::optional<VkInstance> {
 	auto application_info = create_application_info(applicationName);
 
+	// Chained into instance creation so the layers also report on vkCreateInstance itself
+	auto messenger_create_info = vulkan_debug_messenger_info();
+	VkValidationFeatureEnableEXT const sync_features[] {VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT};
+	VkValidationFeatureEnableEXT const gpu_features[] {VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT, VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_RESERVE_BINDING_SLOT_EXT};
+	VkValidationFeaturesEXT validation_features{};
+	validation_features.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+	validation_features.pNext = &messenger_create_info;
+	if(validation==Helgelse::Validation::Synchronization) {
+		validation_features.enabledValidationFeatureCount = 1;
+		validation_features.pEnabledValidationFeatures	  = sync_features;
+	}
+	else if(validation==Helgelse::Validation::GPUAssisted) {
+		validation_features.enabledValidationFeatureCount = 2;
+		validation_features.pEnabledValidationFeatures	  = gpu_features;
+	}
+
 	VkInstanceCreateInfo instance_create_info{};
 	instance_create_info.sType					 = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instance_create_info.pApplicationInfo		 = &application_info;
-	instance_create_info.enabledLayerCount		 = 0;
-	//instance_create_info.enabledLayerCount	 = instance_layers.size();
-	//instance_create_info.ppEnabledLayerNames	 = instance_layers.data();
+	if(validation==Helgelse::Validation::Standard)
+		instance_create_info.pNext				 = &messenger_create_info;
+	else if(validation != Helgelse::Validation::None)
+		instance_create_info.pNext				 = &validation_features;
+	instance_create_info.enabledLayerCount		 = instance_layers.size();
+	instance_create_info.ppEnabledLayerNames	 = instance_layers.data();
 	instance_create_info.enabledExtensionCount	 = instance_extensions.size();
 	instance_create_info.ppEnabledExtensionNames = instance_extensions.data();
 	instance_create_info.flags                  |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
@@ -70,21 +172,52 @@ auto vulkan_create_instance(auto const &instance_layers, auto const &instance_ex
     return instance;
 }
 
-auto vulkan_create_device(auto const &GPUs, auto const &device_extensions, auto const &graphics_queue_family) -> std::optional<VkDevice> {
+auto vulkan_setup_debug_utils(Helgelse::VulkanContext &context) {
+	if(context.validation==Helgelse::Validation::None)
+		return;
+	if(auto const create_messenger = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(context.instance, "vkCreateDebugUtilsMessengerEXT"))) {
+		auto const messenger_create_info = vulkan_debug_messenger_info();
+		create_messenger(context.instance, &messenger_create_info, nullptr, &context.debugMessenger);
+	}
+	context.setObjectName = reinterpret_cast<PFN_vkSetDebugUtilsObjectNameEXT>(vkGetInstanceProcAddr(context.instance, "vkSetDebugUtilsObjectNameEXT"));
+	context.beginLabel	  = reinterpret_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(vkGetInstanceProcAddr(context.instance, "vkCmdBeginDebugUtilsLabelEXT"));
+	context.endLabel	  = reinterpret_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(vkGetInstanceProcAddr(context.instance, "vkCmdEndDebugUtilsLabelEXT"));
+}
+
+auto vulkan_supports_instance_layer(char const *name) -> bool {
+	uint32_t layer_count = 0;
+	vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
+	std::vector<VkLayerProperties> layers(layer_count);
+	vkEnumerateInstanceLayerProperties(&layer_count, layers.data());
+	for(auto const &layer : layers)
+		if(std::strcmp(layer.layerName, name)==0)
+			return true;
+	return false;
+}
+
+// One queue from each distinct family, the graphics family first
+auto vulkan_create_device(auto const &GPUs, auto const &device_extensions, std::vector<uint32_t> const &queue_families, void *features=nullptr) -> std::optional<VkDevice> {
 	const float priorities[] {1.0f};
-	VkDeviceQueueCreateInfo queue_create_info{};
-	queue_create_info.sType			   = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queue_create_info.queueCount	   = 1;
-	queue_create_info.queueFamilyIndex = graphics_queue_family;
-	queue_create_info.pQueuePriorities = priorities;
+	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+	for(auto const family : queue_families) {
+		if(std::any_of(queue_create_infos.begin(), queue_create_infos.end(), [family](auto const &info) { return info.queueFamilyIndex==family; }))
+			continue;
+		VkDeviceQueueCreateInfo queue_create_info{};
+		queue_create_info.sType			   = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queue_create_info.queueFamilyIndex = family;
+		queue_create_info.queueCount	   = 1;
+		queue_create_info.pQueuePriorities = priorities;
+		queue_create_infos.push_back(queue_create_info);
+	}
 
 	VkDeviceCreateInfo device_create_info{};
 	device_create_info.sType				   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	device_create_info.queueCreateInfoCount	   = 1;
-	device_create_info.pQueueCreateInfos	   = &queue_create_info;
+	device_create_info.pNext				   = features;
+	device_create_info.queueCreateInfoCount	   = queue_create_infos.size();
+	device_create_info.pQueueCreateInfos	   = queue_create_infos.data();
 //	device_create_info.enabledLayerCount	   = device_layers.size();				// depricated
 //	device_create_info.ppEnabledLayerNames	   = device_layers.data();				// depricated
-	device_create_info.enabledLayerCount	   = device_extensions.size();
+	device_create_info.enabledExtensionCount   = device_extensions.size();
 	device_create_info.ppEnabledExtensionNames = device_extensions.data();
 
 	VkDevice device	= VK_NULL_HANDLE;
@@ -96,16 +229,26 @@ auto vulkan_create_device(auto const &GPUs, auto const &device_extensions, auto
     return device;
 }
 
-auto vulkan_setup_extensions() -> std::tuple<std::vector<const char*>, std::vector<const char*>, std::vector<const char*>> {
+auto vulkan_setup_extensions(Helgelse::Validation &validation) -> std::tuple<std::vector<const char*>, std::vector<const char*>, std::vector<const char*>> {
     // regular instance and device layers and extensions
 	std::vector<const char*> instance_layers;
 	//	std::vector<const char*> device_layers;					// depricated
 	std::vector<const char*> instance_extensions;
 	std::vector<const char*> device_extensions;
 
-    // if using debugging, push back debug layers and extensions
-	instance_layers.push_back("VK_LAYER_LUNARG_standard_validation");
-	instance_extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+    // if using debugging, push back debug layers and extensions, with validation off nothing is added at all
+	if(validation != Helgelse::Validation::None) {
+		if(vulkan_supports_instance_layer("VK_LAYER_KHRONOS_validation")) {
+			instance_layers.push_back("VK_LAYER_KHRONOS_validation");
+			instance_extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+			if(validation != Helgelse::Validation::Standard)
+				instance_extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+		}
+		else {
+			std::cout << "Validation requested but VK_LAYER_KHRONOS_validation is not installed" << std::endl;
+			validation = Helgelse::Validation::None;
+		}
+	}
 	//	device_layers.push_back( "VK_LAYER_LUNARG_standard_validation" );			// depricated
 
     // push back extensions and layers you need
@@ -156,86 +299,327 @@ auto vulkan_setup_graphics_queue_family(auto const &GPUs) -> std::optional<uint3
 	return graphicsQueueFamily;
 }
 
-auto glfw_create_surface(auto const &instance, auto const &window, auto width, auto height) -> std::optional<VkSurfaceKHR> {
-    // make sure we indeed get the surface size we want.
-	glfwGetFramebufferSize(window, &width, &height);
-
-    // Create window surface, looks a lot like a Vulkan function ( and not GLFW function )
-	// This is a one function solution for all operating systems. No need to hassle with the OS specifics.
-	// For windows this would be vkCreateWin32SurfaceKHR() or on linux XCB window library this would be vkCreateXcbSurfaceKHR()
-	VkSurfaceKHR surface = VK_NULL_HANDLE;
-	VkResult ret = glfwCreateWindowSurface( instance, window, nullptr, &surface );
-	if(VK_SUCCESS != ret) {
-		// couldn't create surface, exit
-		glfwTerminate();
-		return std::nullopt;
-	}
-	return surface;
+// Families with transfer but neither graphics nor compute are the copy engines, uploads there run beside rendering
+auto vulkan_setup_transfer_queue_family(auto const &gpu, uint32_t graphicsQueueFamily) -> uint32_t {
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> family_properties(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &queue_family_count, family_properties.data());
+	for(uint32_t i = 0; i < queue_family_count; ++i)
+		if((family_properties[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(family_properties[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			return i;
+	return graphicsQueueFamily;
 }
 
-auto glfw_poll_loop(auto const &window) {
-    /*
-	All regular Vulkan API stuff goes here, no more GLFW commands needed for the window.
-	We still need to initialize the swapchain, it's images and all the rest
-	just like we would have done with OS native windows.
-	*/
-	while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-    }
+// Families with compute but not graphics run jobs asynchronously to rendering, the graphics family does both otherwise
+auto vulkan_setup_compute_queue_family(auto const &gpu, uint32_t graphicsQueueFamily) -> uint32_t {
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> family_properties(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &queue_family_count, family_properties.data());
+	for(uint32_t i = 0; i < queue_family_count; ++i)
+		if((family_properties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(family_properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+			return i;
+	return graphicsQueueFamily;
 }
 
-auto vulkan_terminate(auto const &instance, auto const &surface, auto const &window, auto const &device) {
-	// Destroy window surface, Note that this is a native Vulkan API function
-	// ( surface was created with GLFW function )
-	if(instance != VK_NULL_HANDLE)
-		vkDestroySurfaceKHR(instance, surface, nullptr);
+auto vulkan_setup_present_wait(auto const &gpu, auto &device_extensions) -> bool {
+	// present_wait gives the frame pacer real display timestamps, it depends on present_id
+	if(!vulkan_supports_device_extension(gpu, VK_KHR_PRESENT_ID_EXTENSION_NAME) ||
+	   !vulkan_supports_device_extension(gpu, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+		return false;
+	device_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+	device_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	return true;
+}
 
-	// destroy window using GLFW function
-	glfwDestroyWindow(window);
+auto vulkan_setup_dynamic_rendering(auto const &gpu, auto &device_extensions) -> bool {
+	// Without it every swapchain image needs a framebuffer and every attachment setup a render pass
+	if(!vulkan_supports_device_extension(gpu, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		return false;
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features{};
+	dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &dynamic_rendering_features;
+	vkGetPhysicalDeviceFeatures2(gpu, &features);
+	if(dynamic_rendering_features.dynamicRendering != VK_TRUE)
+		return false;
+	// depth_stencil_resolve and create_renderpass2 are its prerequisites, both core in 1.2
+	device_extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	return true;
+}
 
-	// destroy Vulkan device and instance normally
-	if(device != VK_NULL_HANDLE)
-		vkDestroyDevice(device, nullptr);
-	if(instance != VK_NULL_HANDLE)
-		vkDestroyInstance(instance, nullptr);
+auto vulkan_supports_timeline_semaphore(auto const &gpu) -> bool {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(gpu, &properties);
+	if(properties.apiVersion < VK_API_VERSION_1_2)
+		return false;
+	VkPhysicalDeviceVulkan12Features vulkan12_features{};
+	vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &vulkan12_features;
+	vkGetPhysicalDeviceFeatures2(gpu, &features);
+	return vulkan12_features.timelineSemaphore==VK_TRUE;
 }
 
-auto vulkan_init(auto const &applicationName, auto const &window, auto width, auto height) -> bool {
-	auto [instance_layers, instance_extensions, device_extensions] = vulkan_setup_extensions();
+auto vulkan_supports_draw_indirect_count(auto const &gpu) -> bool {
+	VkPhysicalDeviceVulkan12Features vulkan12_features{};
+	vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &vulkan12_features;
+	vkGetPhysicalDeviceFeatures2(gpu, &features);
+	return vulkan12_features.drawIndirectCount==VK_TRUE;
+}
 
-    VkInstance instance = VK_NULL_HANDLE;
-	if(auto instanceOpt = vulkan_create_instance(instance_layers, instance_extensions, applicationName))
-		instance = instanceOpt.value();
-	else
-		return false;
+auto glfw_wait_for_frame(auto const &windows, auto const &changes) {
+	// Suspended windows never wake the loop, throttled ones only at their next retry
+	auto const onChange = changes.renderMode()==Helgelse::RenderMode::OnChange;
+	auto next_start = Helgelse::FramePacer::Clock::time_point::max();
+	auto next_retry = Helgelse::FramePacer::Clock::time_point::max();
+	for(auto const &[name, window] : windows) {
+		if(vulkan_window_suspended(window))
+			continue;
+		if(window.throttledUntil > Helgelse::FramePacer::Clock::now())
+			next_retry = std::min(next_retry, window.throttledUntil);
+		else if(!onChange)
+			next_start = std::min(next_start, window.pacer.nextFrameStart());
+	}
+	next_start = std::min(next_start, next_retry);
+
+	// On-change rendering and windows that are all suspended sleep in the event queue, inserts and restores wake it
+	if(next_start==Helgelse::FramePacer::Clock::time_point::max()) {
+		glfwWaitEvents();
+		return;
+	}
+	if(onChange) {
+		glfwWaitEventsTimeout(std::chrono::duration<double>(next_start - Helgelse::FramePacer::Clock::now()).count());
+		return;
+	}
+	// Otherwise sleep until the window that wants to start soonest, then sample input
+	std::this_thread::sleep_until(next_start);
+	glfwPollEvents();
+}
+
+/*
+Runs on the frame loop's thread, the only one that adds or erases windows and which holds
+the mutex while it does. The map is therefore walked without the lock: other threads only
+look windows up under it and change what they hold below the lock, nothing drawing reads.
+*/
+auto vulkan_render_windows(auto const &context, auto &windows, auto &changes, auto &windowsMutex) {
+	vulkan_collect_garbage(context);
+	for(auto it = windows.begin(); it != windows.end();) {
+		auto &window = it->second;
+		if(glfwWindowShouldClose(window.window)) {
+			std::lock_guard lock(windowsMutex);
+			vulkan_destroy_window(context, window);
+			it = windows.erase(it);
+			continue;
+		}
+		vulkan_poll_present(context, window);
+		auto const now = Helgelse::FramePacer::Clock::now();
+		if(vulkan_window_suspended(window) || window.throttledUntil > now) {
+			++it;
+			continue;
+		}
+		auto const onChange = changes.renderMode()==Helgelse::RenderMode::OnChange;
+		if(onChange || window.pacer.nextFrameStart(now) <= now) {
+			// Continuous rendering redraws everything, on-change only what was damaged since the last frame
+			auto const damage = changes.takeDamage(window.name);
+			if(onChange && !damage) {
+				++it;
+				continue;
+			}
+			window.pacer.beginFrame(now);
+			auto const result = vulkan_draw_frame(context, window, onChange ? damage.value() : Helgelse::DamageRegion::everything());
+			if(!vulkan_handle_frame_result(context, window, changes, result, now))
+				return;
+		}
+		++it;
+	}
+	// Poll the heaps once everything drawn this frame touched what it uses, only what no window drew is evicted
+	context.residency->update(vulkan_query_memory_budget(context));
+}
+
+auto vulkan_destroy_device(auto const &context) {
+	// Readers still waiting on the timelines give up and leave before their semaphores and the device go away
+	for(auto const &timeline : {context.timeline, context.transfers, context.compute})
+		if(timeline)
+			timeline->abandon();
+	for(auto const &timeline : {context.timeline, context.transfers, context.compute})
+		if(timeline && timeline->semaphore != VK_NULL_HANDLE)
+			vkDestroySemaphore(context.device, timeline->semaphore, nullptr);
+	if(context.device != VK_NULL_HANDLE)
+		vkDestroyDevice(context.device, nullptr);
+}
+
+auto vulkan_terminate(auto const &context, auto &&windows) {
+	for(auto &[name, window] : windows)
+		vulkan_destroy_window(context, window);
+	windows.clear();
+
+	// The device goes away, so this is the one place that waits for all submitted work
+	for(auto const &timeline : {context.timeline, context.transfers, context.compute})
+		if(timeline)
+			timeline->wait(timeline->last());
+	context.deletions->flush();
 
+	// destroy Vulkan device and instance normally
+	vulkan_destroy_device(context);
+	if(context.debugMessenger != VK_NULL_HANDLE)
+		if(auto const destroy_messenger = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(context.instance, "vkDestroyDebugUtilsMessengerEXT")))
+			destroy_messenger(context.instance, context.debugMessenger, nullptr);
+	if(context.instance != VK_NULL_HANDLE)
+		vkDestroyInstance(context.instance, nullptr);
+}
+
+// Picks the GPU and creates the device with everything tied to it, also used to replace a lost device
+auto vulkan_setup_device(Helgelse::VulkanContext &context, uint64_t initialValue=0, uint64_t initialTransferValue=0, uint64_t initialComputeValue=0) -> bool {
+	auto device_extensions = context.deviceExtensions;
 	std::vector<VkPhysicalDevice> GPUs;
-	if(auto GPUsOpt = vulkan_setup_gpus(instance))
+	if(auto GPUsOpt = vulkan_setup_gpus(context.instance); GPUsOpt && !GPUsOpt->empty())
 		GPUs = GPUsOpt.value();
 	else
 		return false;
+	context.gpu = GPUs[0];
 
-	uint32_t graphicsQueueFamily;
 	if(auto const graphicsQueueFamilyOpt = vulkan_setup_graphics_queue_family(GPUs))
-		graphicsQueueFamily = graphicsQueueFamilyOpt.value();
+		context.graphicsQueueFamily = graphicsQueueFamilyOpt.value();
 	else
 		return false;
 
-    VkDevice device = VK_NULL_HANDLE;
-	if(auto const deviceOpt = vulkan_create_device(GPUs, device_extensions, graphicsQueueFamily))
-		device = deviceOpt.value();
-	else
+	if(!vulkan_supports_timeline_semaphore(context.gpu)) {
+		std::cout << "Vulkan 1.2 with timeline semaphores is required" << std::endl;
 		return false;
+	}
+
+	VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{};
+	present_wait_features.sType		  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	present_wait_features.presentWait = VK_TRUE;
+	VkPhysicalDevicePresentIdFeaturesKHR present_id_features{};
+	present_id_features.sType	  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	present_id_features.pNext	  = &present_wait_features;
+	present_id_features.presentId = VK_TRUE;
+	context.hasPresentWait = vulkan_setup_present_wait(context.gpu, device_extensions);
+	if((context.hasIncrementalPresent = vulkan_supports_device_extension(context.gpu, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME)))
+		device_extensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+	if((context.hasMemoryBudget = vulkan_supports_device_extension(context.gpu, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)))
+		device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features{};
+	dynamic_rendering_features.sType			= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	dynamic_rendering_features.pNext			= context.hasPresentWait ? &present_id_features : nullptr;
+	dynamic_rendering_features.dynamicRendering = VK_TRUE;
+	context.hasDynamicRendering = vulkan_setup_dynamic_rendering(context.gpu, device_extensions);
+	VkPhysicalDeviceVulkan12Features vulkan12_features{};
+	vulkan12_features.sType				= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12_features.pNext				= context.hasDynamicRendering ? static_cast<void*>(&dynamic_rendering_features) : context.hasPresentWait ? static_cast<void*>(&present_id_features) : nullptr;
+	vulkan12_features.timelineSemaphore = VK_TRUE;
+	// Culled draws are issued with a count the GPU wrote, without it every instance keeps a draw slot
+	context.hasDrawIndirectCount		= vulkan_supports_draw_indirect_count(context.gpu);
+	vulkan12_features.drawIndirectCount = context.hasDrawIndirectCount ? VK_TRUE : VK_FALSE;
+	// Whichever block compression families the GPU has, KTX2 textures upload in them as they are
+	VkPhysicalDeviceFeatures available{};
+	vkGetPhysicalDeviceFeatures(context.gpu, &available);
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType							   = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext							   = &vulkan12_features;
+	features.features.textureCompressionBC	   = available.textureCompressionBC;
+	features.features.textureCompressionETC2	   = available.textureCompressionETC2;
+	features.features.textureCompressionASTC_LDR = available.textureCompressionASTC_LDR;
+	features.features.multiDrawIndirect		   = available.multiDrawIndirect;
+	// Without it an indirect call draws one command, culled slots are then drawn one call each
+	context.hasMultiDrawIndirect = available.multiDrawIndirect==VK_TRUE;
 
-	VkSurfaceKHR surface = VK_NULL_HANDLE;
-	if(auto const surfaceOpt = glfw_create_surface(instance, window, width, height))
-		surface = surfaceOpt.value();
+	context.transferQueueFamily = vulkan_setup_transfer_queue_family(context.gpu, context.graphicsQueueFamily);
+	context.computeQueueFamily	= vulkan_setup_compute_queue_family(context.gpu, context.graphicsQueueFamily);
+	if(auto const deviceOpt = vulkan_create_device(GPUs, device_extensions, {context.graphicsQueueFamily, context.transferQueueFamily, context.computeQueueFamily}, &features))
+		context.device = deviceOpt.value();
 	else
 		return false;
+	vkGetDeviceQueue(context.device, context.graphicsQueueFamily, 0, &context.graphicsQueue);
+	vkGetDeviceQueue(context.device, context.transferQueueFamily, 0, &context.transferQueue);
+	vkGetDeviceQueue(context.device, context.computeQueueFamily, 0, &context.computeQueue);
+	context.textureFormats = vulkan_supported_texture_formats(context.gpu, features.features);
+	if(!(context.timeline = vulkan_create_timeline(context.device, initialValue)) ||
+	   !(context.transfers = vulkan_create_timeline(context.device, initialTransferValue)) ||
+	   !(context.compute = vulkan_create_timeline(context.device, initialComputeValue)))
+		return false;
+	vulkan_name_object(context, VK_OBJECT_TYPE_SEMAPHORE, context.timeline->semaphore, "gpu timeline");
+	vulkan_name_object(context, VK_OBJECT_TYPE_SEMAPHORE, context.transfers->semaphore, "transfer timeline");
+	vulkan_name_object(context, VK_OBJECT_TYPE_SEMAPHORE, context.compute->semaphore, "compute timeline");
+	if(context.hasDynamicRendering) {
+		context.beginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(context.device, "vkCmdBeginRenderingKHR"));
+		context.endRendering   = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(context.device, "vkCmdEndRenderingKHR"));
+		context.hasDynamicRendering = context.beginRendering != nullptr && context.endRendering != nullptr;
+	}
+	if(context.hasPresentWait) {
+		context.waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(context.device, "vkWaitForPresentKHR"));
+		context.hasPresentWait = context.waitForPresent != nullptr;
+	}
+	return true;
+}
+
+/*
+A lost device (driver reset, TDR) takes every object created from it along, but nothing
+the space holds: window configs, content and bounds live in the path space, and all GPU
+state is derived from them each frame. Recovery throws the device away, creates a new
+one on the same instance and rebuilds each window's swapchain on its existing surface.
+The next frame redraws everything from the space, render graph transients included.
+*/
+auto vulkan_recover_device(Helgelse::VulkanContext &context, auto &windows) -> bool {
+	std::cout << "Vulkan device lost, recreating it" << std::endl;
+	// Returns at once on a lost device, but lets a device that recovered on its own finish
+	vkDeviceWaitIdle(context.device);
+	for(auto &[name, window] : windows)
+		vulkan_destroy_window_resources(context, window);
+	context.deletions->flush();
 
-	glfw_poll_loop(window);
+	auto const lastValue		 = context.timeline->last();
+	auto const lastTransferValue = context.transfers ? context.transfers->last() : 0;
+	auto const lastComputeValue	 = context.compute ? context.compute->last() : 0;
+	vulkan_destroy_device(context);
+	context.device		  = VK_NULL_HANDLE;
+	context.graphicsQueue = VK_NULL_HANDLE;
+	context.transferQueue = VK_NULL_HANDLE;
+	context.computeQueue  = VK_NULL_HANDLE;
+	context.timeline	  = nullptr;
+	context.transfers	  = nullptr;
+	context.compute		  = nullptr;
+	if(!vulkan_setup_device(context, lastValue, lastTransferValue, lastComputeValue))
+		return false;
+	++context.deviceResets;
 
-    return true;
+	for(auto &[name, window] : windows) {
+		if(!vulkan_create_window_resources(context, window)) {
+			std::cout << "Could not rebuild window " << name << " after losing the device" << std::endl;
+			glfwSetWindowShouldClose(window.window, GLFW_TRUE);
+			continue;
+		}
+		if(window.changes)
+			window.changes->markChanged(window.name);
+	}
+	return true;
+}
+
+auto vulkan_init(auto const &applicationName, Helgelse::Validation validation) -> std::optional<Helgelse::VulkanContext> {
+	Helgelse::VulkanContext context;
+	context.validation = validation_from_environment(validation);
+	auto [instance_layers, instance_extensions, device_extensions] = vulkan_setup_extensions(context.validation);
+
+	if(auto instanceOpt = vulkan_create_instance(instance_layers, instance_extensions, applicationName, context.validation))
+		context.instance = instanceOpt.value();
+	else
+		return std::nullopt;
+	vulkan_setup_debug_utils(context);
+
+	context.deviceExtensions = device_extensions;
+	if(!vulkan_setup_device(context)) {
+		vulkan_terminate(context, std::map<std::string, Helgelse::VulkanWindow>{});
+		return std::nullopt;
+	}
+    return context;
 }
 
 auto glfw_terminate() {
@@ -243,6 +627,64 @@ auto glfw_terminate() {
 }
 
 namespace Helgelse {
+/*
+Everything behind a GLFWVulkanSpace: the device, the windows and all the frame loop
+draws them with. Copies of the space share one, whichever copy goes last takes the
+state along and with it the device.
+*/
+struct GLFWVulkanState {
+	~GLFWVulkanState() {
+		if(this->isVulkanInitialized) {
+			if(this->textures) {
+				auto retired = std::make_shared<VulkanTextures>(std::move(*this->textures));
+				vulkan_retire(this->context, [context = this->context, retired] { vulkan_destroy_textures(context, *retired); });
+			}
+			if(this->meshes) {
+				auto retired = std::make_shared<VulkanMeshes>(std::move(*this->meshes));
+				vulkan_retire(this->context, [context = this->context, retired] { vulkan_destroy_meshes(context, *retired); });
+			}
+			// Running builds finish first, frames and jobs may still use what was built
+			vulkan_retire(this->context, [context = this->context, pipelines = this->pipelineCache->reset()]() mutable {
+				for(auto &pipeline : pipelines)
+					vulkan_destroy_compute_pipeline(context, pipeline);
+			});
+			if(this->compute) {
+				auto retired = std::make_shared<VulkanCompute>(std::move(*this->compute));
+				auto jobs	 = std::make_shared<decltype(this->computeJobs)>(std::move(this->computeJobs));
+				vulkan_retire(this->context, [context = this->context, retired, jobs] {
+					for(auto &[name, job] : *jobs)
+						vulkan_destroy_compute_job(context, *retired, job);
+					vulkan_destroy_compute(context, *retired);
+				});
+			}
+			vulkan_terminate(this->context, this->windows);
+		}
+	}
+
+	bool isGLFWInitialized = false;
+	bool isVulkanInitialized = false;
+	bool isLoopRunning = false;
+	std::map<std::string, VulkanWindow, std::less<>> windows;
+	std::vector<std::pair<std::string, CreateWindow>> pendingWindows;
+	std::mutex windowsMutex;
+	std::shared_ptr<ChangeTracker> changes = std::make_shared<ChangeTracker>([] { glfwPostEmptyEvent(); });
+	FramePacing pacing = FramePacing::QueueAhead;
+	Validation validation = Validation::None; // HELGELSE_VALIDATION overrides it
+	std::shared_ptr<TextureLoader> textureLoader = std::make_shared<TextureLoader>(texture_default_decoders(), [] { glfwPostEmptyEvent(); });
+	std::optional<VulkanTextures> textures; // created with the device, decoded textures wait in the loader until then
+	std::shared_ptr<ShaderLibrary> shaders = std::make_shared<ShaderLibrary>();
+	std::shared_ptr<ShaderWatcher> shaderWatcher = std::make_shared<ShaderWatcher>(this->shaders, shader_compile, [] { glfwPostEmptyEvent(); });
+	std::optional<VulkanCompute> compute;
+	std::shared_ptr<PipelineCache<VulkanComputePipeline>> pipelineCache = std::make_shared<PipelineCache<VulkanComputePipeline>>([] { glfwPostEmptyEvent(); });
+	std::shared_ptr<MeshLibrary> meshLibrary = std::make_shared<MeshLibrary>();
+	std::optional<VulkanMeshes> meshes; // the arena, created with the device
+	std::map<std::string, VulkanComputeJob, std::less<>> computeJobs; // until grabbed
+	std::vector<std::pair<std::string, ComputeJob>> pendingCompute;	  // for the frame loop to submit
+	uint64_t cullGenerations = 0; // tells a replaced cull set from the one its GPU buffers were built from
+
+	VulkanContext context;
+};
+
 struct GLFWVulkanSpace {
     ~GLFWVulkanSpace() {
         Forge::instance()->clearBlock(*this->root);
@@ -251,53 +693,674 @@ struct GLFWVulkanSpace {
     auto operator==(GLFWVulkanSpace const &rhs) const -> bool { }
 
     virtual auto grabBlock(Path const &range, std::type_info const *info, void *data, bool isTriviallyCopyable) -> bool {
-        return false;
+		auto const path = range.toString();
+		return path.starts_with("/compute/") && this->grabCompute(std::string_view(path).substr(9), info, data, true);
     }
 
     virtual auto grab(Path const &range, std::type_info const *info, void *data, bool isTriviallyCopyable) -> bool {
-        return false;
+		auto const path = range.toString();
+		if(auto const route = grabRoutes().find(path, RouteTable<GrabHandler>::None))
+			return (*route->first)(*this, route->second, info, data);
+		return false;
     }
 
     virtual auto read(Path const &range, std::type_info const *info, void *data, bool isTriviallyCopyable) -> bool {
-        return false;
+		auto const path = range.toString();
+		return this->readStats(path, info, data) || this->readTexture(path, info, data, false) || this->readMesh(path, info, data, false) || this->readGPU(path, info, data, false);
     }
 
     virtual auto readBlock(Path const &range, std::type_info const *info, void *data, bool isTriviallyCopyable) -> bool {
-		return false;
+		auto const path = range.toString();
+		return this->readStats(path, info, data) || this->readTexture(path, info, data, true) || this->readMesh(path, info, data, true) || this->readGPU(path, info, data, true);
     }
 
+	// Inserts through the path space land here, a type some handler takes goes on to the same typed dispatch as the overload below
     virtual auto insert(Path const &range, Data const &data, Path const &coroResultPath="") -> bool {
-        if(range.spaceName()=="windows") {
-			auto const applicationName = "GLFW with Vulkan";
-			int width  = 800;
-			int height = 600;
-			if(!this->isGLFWInitialized)
-				if(!glfw_init())
-					return false;
-			if(auto const windowOpt = glfw_create_window(applicationName, width, height); auto window = windowOpt.value()) {
-				if(!this->isVulkanInitialized)
-					if(!vulkan_init(applicationName, window, width, height)) {
-						vulkan_terminate(instance, surface, window, device);
-						return false;
-					}
-			}
-			return true;
-        }
-        return false;
+		auto const path = range.toString();
+		auto const &routes = insertRoutes(); // also registers the typed entry points
+		if(auto const typed = typedInserts().find(std::type_index(data.type())); typed != typedInserts().end())
+			return typed->second(*this, path, data);
+		// A type no handler names only reaches the handlers taking any type
+		if(auto const route = routes.find(path, RouteTable<InsertHandler>::None))
+			return route->first->fromData(*this, route->second, data);
+		return false;
     }
 
+	// Typed fast path for callers holding the space itself, the route slot is resolved at compile time and no Data is built for typed handlers
+	template<typename T> requires (!std::is_same_v<std::remove_cvref_t<T>, Data>)
+	auto insert(Path const &range, T const &value) -> bool {
+		return this->insertTyped(range.toString(), value, nullptr);
+	}
+
     virtual auto toJSON() const -> nlohmann::json {
         nlohmann::json json;
         return json;
     }
 private:
-    PathSpaceTE *root=nullptr;
-	bool isGLFWInitialized = false;
-	bool isVulkanInitialized = false;
-	std::map<std::string, GLFWwindow*> windows;
+	struct InsertHandler {
+		auto (*fromData)(GLFWVulkanSpace &space, RouteMatch const &match, Data const &data) -> bool = nullptr;
+		auto (*fromValue)(GLFWVulkanSpace &space, RouteMatch const &match, void const *value) -> bool = nullptr;
+	};
+
+	// Data is the one already holding value when the insert came through the path space, otherwise nullptr
+	template<typename T>
+	auto insertTyped(std::string_view path, T const &value, Data const *data) -> bool {
+		auto const route = insertRoutes().find(path, RouteTable<InsertHandler>::typeSlot<T>());
+		if(!route)
+			return false;
+		if(route->first->fromValue)
+			return route->first->fromValue(*this, route->second, &value);
+		if(data)
+			return route->first->fromData(*this, route->second, *data);
+		return route->first->fromData(*this, route->second, Data(value));
+	}
+
+	// Per type a handler takes, unwraps the Data once and dispatches on the type's compile time slot
+	using TypedInsert = auto (*)(GLFWVulkanSpace &space, std::string_view path, Data const &data) -> bool;
+	static auto typedInserts() -> std::unordered_map<std::type_index, TypedInsert>& {
+		static std::unordered_map<std::type_index, TypedInsert> inserts;
+		return inserts;
+	}
+
+	// The thunks are generated per type, a handler that can't take T is a compile error rather than a false at runtime
+	template<typename T, auto Method>
+	static auto registerHandler(RouteTable<InsertHandler> &routes, std::string_view pattern) {
+		static_assert(std::is_invocable_r_v<bool, decltype(Method), GLFWVulkanSpace&, RouteMatch const&, T const&>, "insert handler does not accept this type");
+		routes.add<T>(pattern, InsertHandler{
+			[](GLFWVulkanSpace &space, RouteMatch const &match, Data const &data) -> bool { return (space.*Method)(match, data.as<T>()); },
+			[](GLFWVulkanSpace &space, RouteMatch const &match, void const *value) -> bool { return (space.*Method)(match, *static_cast<T const*>(value)); }
+		});
+		typedInserts().try_emplace(std::type_index(typeid(T)), [](GLFWVulkanSpace &space, std::string_view path, Data const &data) -> bool {
+			auto const &value = data.as<T>();
+			return space.insertTyped(path, value, &data);
+		});
+	}
+
+	template<auto Method>
+	static auto registerAnyHandler(RouteTable<InsertHandler> &routes, std::string_view pattern) {
+		static_assert(std::is_invocable_r_v<bool, decltype(Method), GLFWVulkanSpace&, RouteMatch const&, Data const&>, "insert handler must take Data");
+		routes.add(pattern, InsertHandler{
+			[](GLFWVulkanSpace &space, RouteMatch const &match, Data const &data) -> bool { return (space.*Method)(match, data); }
+		});
+	}
+
+	// Built once, every insert is a single walk over its path segments
+	static auto insertRoutes() -> RouteTable<InsertHandler> const& {
+		static auto const routes = [] {
+			RouteTable<InsertHandler> routes;
+			registerHandler<FramePacing, &GLFWVulkanSpace::insertPacing>(routes, "/pacing");
+			registerHandler<RenderMode, &GLFWVulkanSpace::insertRenderMode>(routes, "/rendermode");
+			registerHandler<Validation, &GLFWVulkanSpace::insertValidation>(routes, "/validation");
+			registerHandler<std::string, &GLFWVulkanSpace::insertTexture>(routes, "/textures/*");
+			registerHandler<TextureUsage, &GLFWVulkanSpace::insertTextureUsage>(routes, "/textures/*");
+			registerHandler<std::vector<uint32_t>, &GLFWVulkanSpace::insertShader>(routes, "/shaders/*");
+			registerHandler<std::string, &GLFWVulkanSpace::insertShaderFile>(routes, "/shaders/*");
+			registerHandler<ComputeJob, &GLFWVulkanSpace::insertCompute>(routes, "/compute/*");
+			registerHandler<Mesh, &GLFWVulkanSpace::insertMesh>(routes, "/meshes/*");
+			registerHandler<CreateWindow, &GLFWVulkanSpace::insertWindow>(routes, "/windows/*");
+			registerHandler<Rect, &GLFWVulkanSpace::insertBounds>(routes, "/windows/*/*/bounds");
+			registerHandler<CullSet, &GLFWVulkanSpace::insertCullSet>(routes, "/windows/*/culling/*");
+			registerHandler<CullView, &GLFWVulkanSpace::insertCullView>(routes, "/windows/*/culling/*/view");
+			registerAnyHandler<&GLFWVulkanSpace::insertContent>(routes, "/windows/*/**");
+			return routes;
+		}();
+		return routes;
+	}
+
+	// "/textures/<name>" is a TextureInfo, a blocking read waits until the texture is resident or failed to load
+	auto readTexture(std::string_view path, std::type_info const *info, void *data, bool block) -> bool {
+		if(!path.starts_with("/textures/") || info==nullptr || *info != typeid(TextureInfo))
+			return false;
+		auto const name	   = path.substr(10);
+		auto const texture = block ? this->state->textureLoader->wait(name) : this->state->textureLoader->info(name);
+		if(!texture)
+			return false;
+		*static_cast<TextureInfo*>(data) = *texture;
+		return true;
+	}
+
+	// "/meshes/<name>" is a MeshInfo, a blocking read waits until the mesh is resident or failed to upload
+	auto readMesh(std::string_view path, std::type_info const *info, void *data, bool block) -> bool {
+		if(!path.starts_with("/meshes/") || info==nullptr || *info != typeid(MeshInfo))
+			return false;
+		auto const name = path.substr(8);
+		auto const mesh = block ? this->state->meshLibrary->wait(name) : this->state->meshLibrary->info(name);
+		if(!mesh)
+			return false;
+		*static_cast<MeshInfo*>(data) = *mesh;
+		return true;
+	}
+
+	// "/stats/memory" is a MemoryStats with every heap's usage and budget as of the last frame
+	auto readStats(std::string_view path, std::type_info const *info, void *data) -> bool {
+		if(path != "/stats/memory" || info==nullptr || *info != typeid(MemoryStats))
+			return false;
+		std::shared_ptr<MemoryResidency> residency;
+		{
+			std::lock_guard lock(this->state->windowsMutex);
+			residency = this->state->context.residency;
+		}
+		*static_cast<MemoryStats*>(data) = residency->stats();
+		return true;
+	}
 
-	VkInstance instance = VK_NULL_HANDLE;
-	VkSurfaceKHR surface = VK_NULL_HANDLE;
-	VkDevice device = VK_NULL_HANDLE;
+	/*
+	"/gpu/progress" is the last timeline value the GPU completed and "/gpu/submitted" the
+	last one handed to it, both uint64_t. A blocking read of "/gpu/progress" returns once
+	everything submitted so far is done, "/gpu/progress/<value>" once that value is reached.
+	"/gpu/resets" counts the lost devices that were replaced. Blocking reads fail when the
+	device is lost while waiting, values continue on the replacement device.
+	*/
+	auto readGPU(std::string_view path, std::type_info const *info, void *data, bool block) -> bool {
+		if(!path.starts_with("/gpu/") || info==nullptr || *info != typeid(uint64_t))
+			return false;
+		std::shared_ptr<GPUTimeline> timeline;
+		{
+			std::lock_guard lock(this->state->windowsMutex);
+			if(path=="/gpu/resets") {
+				*static_cast<uint64_t*>(data) = this->state->context.deviceResets;
+				return true;
+			}
+			timeline = this->state->context.timeline;
+		}
+		if(!timeline)
+			return false;
+		auto &value = *static_cast<uint64_t*>(data);
+		path.remove_prefix(5);
+		if(path=="submitted") {
+			value = timeline->last();
+			return true;
+		}
+		if(!path.starts_with("progress"))
+			return false;
+		path.remove_prefix(8);
+		// "progress" itself or "progress/<value>", nothing else that merely starts with it
+		if(!path.empty() && !path.starts_with('/'))
+			return false;
+		if(block) {
+			auto target = timeline->last();
+			if(!path.empty()) {
+				auto const end	  = path.data()+path.size();
+				auto const parsed = std::from_chars(path.data()+1, end, target);
+				if(parsed.ec != std::errc{} || parsed.ptr != end)
+					return false;
+			}
+			if(!timeline->wait(target))
+				return false;
+		}
+		else if(!path.empty())
+			return false;
+		value = timeline->progress();
+		return true;
+	}
+
+	using GrabHandler = auto (*)(GLFWVulkanSpace &space, RouteMatch const &match, std::type_info const *info, void *data) -> bool;
+
+	static auto grabRoutes() -> RouteTable<GrabHandler> const& {
+		static auto const routes = [] {
+			RouteTable<GrabHandler> routes;
+			routes.add("/windows/*", [](GLFWVulkanSpace &space, RouteMatch const &match, std::type_info const *info, void *data) { return space.grabWindow(match, info, data); });
+			routes.add("/textures/*", [](GLFWVulkanSpace &space, RouteMatch const &match, std::type_info const *info, void *data) { return space.grabTexture(match, info, data); });
+			routes.add("/compute/*", [](GLFWVulkanSpace &space, RouteMatch const &match, std::type_info const *info, void *data) { return space.grabCompute(match.capture(0), info, data, false); });
+			routes.add("/meshes/*", [](GLFWVulkanSpace &space, RouteMatch const &match, std::type_info const *info, void *data) { return space.grabMesh(match, info, data); });
+			return routes;
+		}();
+		return routes;
+	}
+
+	// Grabbing a window closes it, the frame loop retires its Vulkan objects without stalling the other windows
+	auto grabWindow(RouteMatch const &match, std::type_info const *info, void *data) -> bool {
+		if(info != nullptr && *info != typeid(CreateWindow))
+			return false;
+		std::lock_guard lock(this->state->windowsMutex);
+		auto const name = match.capture(0);
+		auto const pending = std::find_if(this->state->pendingWindows.begin(), this->state->pendingWindows.end(), [name](auto const &window) { return window.first==name; });
+		if(pending != this->state->pendingWindows.end()) {
+			if(data)
+				*static_cast<CreateWindow*>(data) = pending->second;
+			this->state->pendingWindows.erase(pending);
+			return true;
+		}
+		auto const it = this->state->windows.find(name);
+		if(it==this->state->windows.end())
+			return false;
+		if(data)
+			*static_cast<CreateWindow*>(data) = it->second.config;
+		glfwSetWindowShouldClose(it->second.window, GLFW_TRUE);
+		this->state->changes->markChanged(it->second.name);
+		return true;
+	}
+
+	// Grabbing a texture removes it, the frame loop frees its image once no frame samples it
+	auto grabTexture(RouteMatch const &match, std::type_info const *info, void *data) -> bool {
+		if(info != nullptr && *info != typeid(TextureInfo))
+			return false;
+		auto const name	   = std::string(match.capture(0));
+		auto const texture = this->state->textureLoader->info(name);
+		if(!texture || !this->state->textureLoader->remove(name))
+			return false;
+		if(data)
+			*static_cast<TextureInfo*>(data) = *texture;
+		glfwPostEmptyEvent();
+		return true;
+	}
+
+	// Grabbing a mesh removes it, its range in the arena is reused once no frame draws from it
+	auto grabMesh(RouteMatch const &match, std::type_info const *info, void *data) -> bool {
+		if(info != nullptr && *info != typeid(Mesh))
+			return false;
+		auto const mesh = this->state->meshLibrary->remove(std::string(match.capture(0)));
+		if(!mesh)
+			return false;
+		if(data)
+			*static_cast<Mesh*>(data) = *mesh;
+		glfwPostEmptyEvent();
+		return true;
+	}
+
+	// Uploaded into the mesh arena by the frame loop, a mesh under the same name is replaced once the new one is resident
+	auto insertMesh(RouteMatch const &match, Mesh const &mesh) -> bool {
+		if(!this->state->meshLibrary->set(std::string(match.capture(0)), mesh)) {
+			std::cout << "Mesh " << match.capture(0) << " needs vertices and whole triangles of indices within them" << std::endl;
+			return false;
+		}
+		glfwPostEmptyEvent();
+		return true;
+	}
+
+	// The path of a PNG, JPEG or KTX2 file, decoded on the worker pool and uploaded by the frame loop
+	auto insertTexture(RouteMatch const &match, std::string const &path) -> bool {
+		this->state->textureLoader->load(std::string(match.capture(0)), path);
+		return true;
+	}
+
+	// SPIR-V words, compute jobs and pipelines refer to the shader by the last path segment
+	auto insertShader(RouteMatch const &match, std::vector<uint32_t> const &spirv) -> bool {
+		auto const id = std::string(match.capture(0));
+		this->state->shaderWatcher->unwatch(id);
+		return this->state->shaders->set(id, spirv);
+	}
+
+	/*
+	The path of a .spv file, read once right here, or of a GLSL or HLSL source, which is
+	compiled in the background and again whenever the file changes. Frames keep the
+	previous version until a compile succeeds.
+	*/
+	auto insertShaderFile(RouteMatch const &match, std::string const &path) -> bool {
+		if(std::error_code error; !std::filesystem::is_regular_file(path, error)) {
+			std::cout << "Error loading shader " << match.capture(0) << ": no file at " << path << std::endl;
+			return false;
+		}
+		if(shader_is_source(path)) {
+			this->state->shaderWatcher->watch(std::string(match.capture(0)), path);
+			return true;
+		}
+		this->state->shaderWatcher->unwatch(std::string(match.capture(0)));
+		auto spirv = shader_read_spirv(path);
+		if(!spirv) {
+			std::cout << "Error loading shader " << match.capture(0) << " from " << path << std::endl;
+			return false;
+		}
+		return this->state->shaders->set(std::string(match.capture(0)), std::move(*spirv));
+	}
+
+	/*
+	Jobs are submitted by the thread that owns the device: the frame loop picks them up
+	while it runs, otherwise they go out right here. Nothing needs a window, a space that
+	only computes creates the device on the first job. A name holds one job until it is
+	grabbed.
+	*/
+	auto insertCompute(RouteMatch const &match, ComputeJob const &job) -> bool {
+		auto const name = std::string(match.capture(0));
+		if(!compute_job_valid(job)) {
+			std::cout << "Compute job " << name << " needs a shader, buffers, non-zero group counts and at most " << ComputePushConstantBytes << " bytes of push constants" << std::endl;
+			return false;
+		}
+		std::unique_lock lock(this->state->windowsMutex);
+		if(this->state->computeJobs.contains(name) || !this->initVulkan(false) || !this->state->compute || vulkan_device_lost(this->state->context))
+			return false;
+		auto &entry = this->state->computeJobs[name];
+		entry.value = this->state->context.compute->next();
+		if(this->state->isLoopRunning) {
+			this->state->pendingCompute.emplace_back(name, job);
+			lock.unlock();
+			glfwPostEmptyEvent();
+			return true;
+		}
+		this->state->shaders->commit(); // no frames to keep consistent, recompiled shaders count right away
+		// Nor any that could hitch, waiting for the pipeline right here is fine
+		if(vulkan_compute_job_waiting(this->state->context, *this->state->pipelineCache, *this->state->shaders, job))
+			this->state->pipelineCache->wait();
+		entry = vulkan_submit_compute_job(this->state->context, *this->state->compute, *this->state->pipelineCache, *this->state->shaders, name, job, entry.value);
+		return true;
+	}
+
+	// The result only once the GPU is done, a grabBlock waits for that. Fails for jobs that failed or were lost with the device
+	auto grabCompute(std::string_view name, std::type_info const *info, void *data, bool block) -> bool {
+		if(info != nullptr && *info != typeid(ComputeResult))
+			return false;
+		std::shared_ptr<GPUTimeline> timeline;
+		uint64_t value = 0;
+		{
+			std::lock_guard lock(this->state->windowsMutex);
+			auto const it = this->state->computeJobs.find(name);
+			if(it==this->state->computeJobs.end() || !this->state->context.compute)
+				return false;
+			timeline = this->state->context.compute;
+			value	 = it->second.value;
+		}
+		if(block ? !timeline->wait(value) : !timeline->reached(value))
+			return false;
+		std::lock_guard lock(this->state->windowsMutex);
+		auto const it = this->state->computeJobs.find(name);
+		// Taken by another grab meanwhile
+		if(it==this->state->computeJobs.end() || it->second.value != value)
+			return false;
+		auto job = std::move(it->second);
+		this->state->computeJobs.erase(it);
+		if(!job.failed && data)
+			*static_cast<ComputeResult*>(data) = vulkan_read_compute_job(job);
+		if(this->state->compute)
+			vulkan_destroy_compute_job(this->state->context, *this->state->compute, job);
+		return !job.failed;
+	}
+
+	// Usage reported while drawing, the next frame streams the texture's levels up or down to match
+	auto insertTextureUsage(RouteMatch const &match, TextureUsage const &usage) -> bool {
+		return this->state->textureLoader->used(match.capture(0), usage);
+	}
+
+	auto insertPacing(RouteMatch const&, FramePacing const &pacing) -> bool {
+		this->state->pacing = pacing;
+		return true;
+	}
+
+	// Layers are picked when the instance is created, so this only takes effect before the first window
+	auto insertValidation(RouteMatch const&, Validation const &validation) -> bool {
+		std::lock_guard lock(this->state->windowsMutex);
+		if(this->state->isVulkanInitialized)
+			return validation==this->state->context.validation;
+		this->state->validation = validation;
+		return true;
+	}
+
+	auto insertRenderMode(RouteMatch const&, RenderMode const &mode) -> bool {
+		this->state->changes->setMode(mode);
+		return true;
+	}
+
+	// Blocks while the space has windows when no frame loop runs yet, see queueWindow
+	auto insertWindow(RouteMatch const &match, CreateWindow const &createWindow) -> bool {
+		return this->queueWindow(std::string(match.capture(0)), createWindow);
+	}
+
+	// Anything below a window lands in the window's own space and schedules a redraw of just that window
+	auto insertContent(RouteMatch const &match, Data const &data) -> bool {
+		std::lock_guard lock(this->state->windowsMutex);
+		auto const it = this->state->windows.find(match.capture(0));
+		if(it==this->state->windows.end())
+			return false;
+		auto &window = it->second;
+		if(!window.content.insert(Path{std::string(match.after(0))}, data))
+			return false;
+		auto const itemName = match.remainder.substr(0, match.remainder.find('/'));
+		if(auto const bounds = window.itemBounds.find(itemName); bounds != window.itemBounds.end())
+			this->state->changes->markDamaged(window.name, bounds->second);
+		else
+			this->state->changes->markChanged(window.name);
+		return true;
+	}
+
+	// "<item>/bounds" declares where the item draws, both its old and new area need repainting
+	auto insertBounds(RouteMatch const &match, Rect const &bounds) -> bool {
+		std::lock_guard lock(this->state->windowsMutex);
+		auto const it = this->state->windows.find(match.capture(0));
+		if(it==this->state->windows.end())
+			return false;
+		auto &window = it->second;
+		auto const itemName = match.capture(1);
+		if(!window.content.insert(Path{std::string(match.after(0))}, bounds))
+			return false;
+		if(auto const old = window.itemBounds.find(itemName); old != window.itemBounds.end()) {
+			this->state->changes->markDamaged(window.name, old->second);
+			old->second = bounds;
+		}
+		else
+			window.itemBounds.emplace(itemName, bounds);
+		this->state->changes->markDamaged(window.name, bounds);
+		return true;
+	}
+
+	// Instances the window culls on the GPU every frame, a new set replaces the old one on the GPU as a whole
+	auto insertCullSet(RouteMatch const &match, CullSet const &set) -> bool {
+		std::lock_guard lock(this->state->windowsMutex);
+		auto const it = this->state->windows.find(match.capture(0));
+		if(it==this->state->windows.end())
+			return false;
+		auto &window = it->second;
+		auto const name = std::string(match.capture(1));
+		if(set.instances.empty())
+			window.cullSets.erase(name);
+		else {
+			auto &state		 = window.cullSets[name];
+			state.set		 = set;
+			state.generation = ++this->state->cullGenerations;
+		}
+		window.cullSetsChanged = true;
+		this->state->changes->markChanged(window.name);
+		return true;
+	}
+
+	// Only the frustum changes, the instances stay where they are on the GPU
+	auto insertCullView(RouteMatch const &match, CullView const &view) -> bool {
+		std::lock_guard lock(this->state->windowsMutex);
+		auto const it = this->state->windows.find(match.capture(0));
+		if(it==this->state->windows.end())
+			return false;
+		auto const set = it->second.cullSets.find(match.capture(1));
+		if(set==it->second.cullSets.end())
+			return false;
+		set->second.view = view;
+		set->second.frustum = frustum_planes(view.viewProjection);
+		it->second.cullSetsChanged = true;
+		this->state->changes->markChanged(it->second.name);
+		return true;
+	}
+
+	/*
+	Windows are created on the thread running the frame loop, other threads queue them and
+	wake it. Without a running loop the inserting thread becomes the loop: the insert only
+	returns once the last window closed. GLFW wants windows created and events polled on
+	the main thread on some platforms, so the first window is best inserted from there and
+	everything else from other threads.
+	*/
+	auto queueWindow(std::string const &name, CreateWindow const &createWindow) -> bool {
+		std::unique_lock lock(this->state->windowsMutex);
+		if(this->state->isLoopRunning) {
+			this->state->pendingWindows.emplace_back(name, createWindow);
+			lock.unlock();
+			glfwPostEmptyEvent();
+			return true;
+		}
+		if(!this->initVulkan(true))
+			return false;
+		this->state->pendingWindows.emplace_back(name, createWindow);
+		this->state->isLoopRunning = true;
+		lock.unlock();
+		this->runFrameLoop();
+		return true;
+	}
+
+	// Called with the windows mutex held. Compute works without GLFW, e.g. headless on lavapipe, windows don't
+	auto initVulkan(bool forWindows) -> bool {
+		auto const applicationName = "GLFW with Vulkan";
+		if(!this->state->isGLFWInitialized)
+			this->state->isGLFWInitialized = glfw_init();
+		if(!this->state->isGLFWInitialized && forWindows)
+			return false;
+		if(this->state->isVulkanInitialized)
+			return true;
+		if(auto contextOpt = vulkan_init(applicationName, this->state->validation))
+			this->state->context = contextOpt.value();
+		else
+			return false;
+		this->state->isVulkanInitialized = true;
+		if(!(this->state->textures = vulkan_create_textures(this->state->context)))
+			std::cout << "Could not set up texture uploads, textures stay unavailable" << std::endl;
+		if(!(this->state->compute = vulkan_create_compute(this->state->context)))
+			std::cout << "Could not set up compute, compute jobs stay unavailable" << std::endl;
+		if(!(this->state->meshes = vulkan_create_meshes(this->state->context)))
+			std::cout << "Could not set up the mesh arena, meshes stay unavailable" << std::endl;
+		// The shaders window culling uses unless others were inserted, when there is a compiler to build them
+		for(auto const &[id, source, path] : {std::tuple{"cull", CullShaderSource, "cull.comp"}, std::tuple{"culled.vert", CulledVertexShaderSource, "culled.vert"},
+											  std::tuple{"culled.frag", CulledFragmentShaderSource, "culled.frag"}})
+			if(this->state->shaders->version(id)==0)
+				if(auto compiled = shader_compile(source, path); !compiled.spirv.empty())
+					this->state->shaders->set(id, std::move(compiled.spirv));
+		// Loads inserted before there was a device were transcoded for RGBA8 only
+		this->state->textureLoader->setSupportedFormats(this->state->context.textureFormats);
+		return true;
+	}
+
+	auto createWindow(std::string const &name, CreateWindow const &createWindow) -> bool {
+		auto const windowOpt = glfw_create_window(createWindow, name.c_str());
+		if(!windowOpt)
+			return false;
+		auto vulkanWindowOpt = vulkan_create_window(this->state->context, name, createWindow, windowOpt.value(), this->state->pacing);
+		if(!vulkanWindowOpt) {
+			glfwDestroyWindow(windowOpt.value());
+			return false;
+		}
+		auto &window = this->state->windows[name] = std::move(vulkanWindowOpt.value());
+		window.changes = this->state->changes.get();
+		window.shaders = this->state->shaders.get();
+		window.pipelines = this->state->pipelineCache.get();
+		window.textures = &this->state->textures;
+		window.meshes = &this->state->meshes;
+		glfw_set_change_callbacks(window);
+		glfw_set_resize_callback(window);
+		this->state->changes->markChanged(name);
+		return true;
+	}
+
+	auto runFrameLoop() -> void {
+		while(true) {
+			{
+				std::lock_guard lock(this->state->windowsMutex);
+				for(auto const &[name, createWindow] : this->state->pendingWindows)
+					this->createWindow(name, createWindow);
+				this->state->pendingWindows.clear();
+				// Frames record from a copy, the inserts keep changing the window's own sets meanwhile
+				for(auto &[name, window] : this->state->windows)
+					if(std::exchange(window.cullSetsChanged, false))
+						cull_sets_update(window.drawnCullSets, window.cullSets);
+				// Between frames, so every window draws the next one with the same shaders
+				// Pipelines built since the last frame can draw what was skipped while they were missing
+				if(this->state->shaders->commit() | (this->state->pipelineCache->takeFinished() > 0))
+					for(auto const &[name, window] : this->state->windows)
+						this->state->changes->markChanged(name);
+				this->submitPendingCompute(this->state->windows.empty());
+				this->evictPipelines();
+				if(this->state->windows.empty()) {
+					this->state->isLoopRunning = false;
+					return;
+				}
+			}
+			glfw_wait_for_frame(this->state->windows, *this->state->changes);
+			// Uploads and frames from here on touch their allocations in the new frame
+			this->state->context.residency->beginFrame();
+			if(this->state->textures && vulkan_update_textures(this->state->context, *this->state->textures, *this->state->textureLoader))
+				for(auto const &[name, window] : this->state->windows)
+					this->state->changes->markChanged(name); // the placeholder drawn so far can be replaced
+			// Only culled draws use meshes, windows without any have no pixels that change
+			if(this->state->meshes && vulkan_update_meshes(this->state->context, *this->state->meshes, *this->state->meshLibrary))
+				for(auto const &[name, window] : this->state->windows)
+					if(!window.drawnCullSets.empty())
+						this->state->changes->markChanged(name);
+			vulkan_render_windows(this->state->context, this->state->windows, *this->state->changes, this->state->windowsMutex);
+			if(vulkan_device_lost(this->state->context) && !this->recoverDevice())
+				return;
+		}
+	}
+
+	/*
+	Called with the windows mutex held. Jobs go in insert order, the order their timeline
+	values were handed out in, so one whose pipeline is still being built holds back the
+	ones after it until the finished build wakes the loop again. Without frames to keep
+	going the builds are waited for right here.
+	*/
+	auto submitPendingCompute(bool wait) -> void {
+		if(!this->state->compute) {
+			this->state->pendingCompute.clear();
+			return;
+		}
+		auto submitted = this->state->pendingCompute.begin();
+		for(; submitted != this->state->pendingCompute.end(); ++submitted) {
+			auto const &[name, job] = *submitted;
+			if(vulkan_compute_job_waiting(this->state->context, *this->state->pipelineCache, *this->state->shaders, job)) {
+				if(!wait)
+					break;
+				this->state->pipelineCache->wait();
+			}
+			if(auto const it = this->state->computeJobs.find(name); it != this->state->computeJobs.end())
+				it->second = vulkan_submit_compute_job(this->state->context, *this->state->compute, *this->state->pipelineCache, *this->state->shaders, name, job, it->second.value);
+		}
+		this->state->pendingCompute.erase(this->state->pendingCompute.begin(), submitted);
+		vulkan_collect_compute(this->state->context, *this->state->compute);
+	}
+
+	// Called with the windows mutex held. Pipelines of replaced shaders go once nothing fell back to them for a while
+	auto evictPipelines() -> void {
+		this->state->pipelineCache->tick();
+		for(auto const &pipeline : this->state->pipelineCache->evict(this->state->shaders->hashes())) {
+			if(this->state->compute)
+				vulkan_retire_compute_pipeline(this->state->context, *this->state->compute, pipeline);
+			else
+				vulkan_retire(this->state->context, [context = this->state->context, pipeline]() mutable { vulkan_destroy_compute_pipeline(context, pipeline); });
+		}
+	}
+
+	// Without a device to replace the lost one every window is closed, a later window insert starts over
+	auto recoverDevice() -> bool {
+		std::lock_guard lock(this->state->windowsMutex);
+		if(this->state->textures)
+			vulkan_destroy_textures(this->state->context, *this->state->textures);
+		// Jobs can't be redone, their inputs are gone. Grabbing them fails, pending ones hold values of the old timeline
+		for(auto &[name, job] : this->state->computeJobs) {
+			if(this->state->compute)
+				vulkan_destroy_compute_job(this->state->context, *this->state->compute, job);
+			job.failed = true;
+		}
+		this->state->pendingCompute.clear();
+		for(auto &pipeline : this->state->pipelineCache->reset())
+			vulkan_destroy_compute_pipeline(this->state->context, pipeline);
+		if(this->state->compute)
+			vulkan_destroy_compute(this->state->context, *this->state->compute);
+		if(this->state->meshes)
+			vulkan_destroy_meshes(this->state->context, *this->state->meshes);
+		if(vulkan_recover_device(this->state->context, this->state->windows)) {
+			// Textures are rebuilt from the files the space names, the same way they were loaded the first time
+			this->state->textures = vulkan_create_textures(this->state->context);
+			this->state->compute = vulkan_create_compute(this->state->context);
+			this->state->meshes = vulkan_create_meshes(this->state->context);
+			this->state->meshLibrary->reloadAll(); // the space kept every mesh, they go up again like the first time
+			this->state->textureLoader->setSupportedFormats(this->state->context.textureFormats);
+			this->state->textureLoader->reloadAll();
+			return true;
+		}
+		this->state->textures.reset();
+		this->state->compute.reset();
+		this->state->meshes.reset();
+		this->state->computeJobs.clear();
+		std::cout << "Could not recreate the Vulkan device, closing all windows" << std::endl;
+		vulkan_terminate(this->state->context, this->state->windows);
+		this->state->context = VulkanContext{};
+		this->state->isVulkanInitialized = false;
+		this->state->isLoopRunning = false;
+		return false;
+	}
+
+    PathSpaceTE *root=nullptr;
+	std::shared_ptr<GLFWVulkanState> state = std::make_shared<GLFWVulkanState>(); // shared by every copy of the space
 };
 }
\ No newline at end of file
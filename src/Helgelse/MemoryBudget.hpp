@@ -0,0 +1,149 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+struct HeapBudget {
+	uint64_t usage = 0;	 // bytes in use by this process, or what we track ourselves without VK_EXT_memory_budget
+	uint64_t budget = 0; // bytes the driver expects we can use, shrinks when other applications take memory
+	uint64_t size = 0;
+	bool deviceLocal = false;
+};
+
+// What read("/graphics/stats/memory") returns
+struct MemoryStats {
+	std::vector<HeapBudget> heaps;
+	uint64_t evictedBytes = 0; // freed by the residency policy since startup
+	uint64_t evictions = 0;
+};
+
+/*
+Every allocation the space can do without for a while is tracked here with the frame
+it was last used in. When a heap's usage climbs past the high watermark of its budget,
+the least recently used allocations are evicted until it is back under the low one:
+re-creatable ones (render targets, caches) are dropped, others move to host memory.
+Anything used in the current frame is never evicted.
+*/
+struct MemoryResidency {
+	using Id = uint64_t;
+	enum struct Eviction { Recreate, ToHost };
+
+	static constexpr double HighWatermark = 0.9;
+	static constexpr double LowWatermark = 0.8;
+
+	auto track(uint32_t heap, uint64_t size, Eviction eviction, std::function<void()> evict) -> Id {
+		std::lock_guard lock(this->mutex);
+		auto const id = ++this->nextId;
+		this->allocations.emplace(id, Allocation{heap, size, eviction, this->frame, std::move(evict)});
+		return id;
+	}
+
+	auto untrack(Id id) {
+		std::lock_guard lock(this->mutex);
+		this->allocations.erase(id);
+	}
+
+	auto touch(Id id) {
+		std::lock_guard lock(this->mutex);
+		if(auto const it = this->allocations.find(id); it != this->allocations.end())
+			it->second.lastUsed = this->frame;
+	}
+
+	auto beginFrame() {
+		std::lock_guard lock(this->mutex);
+		++this->frame;
+	}
+
+	auto tracked(uint32_t heap) -> uint64_t {
+		std::lock_guard lock(this->mutex);
+		uint64_t bytes = 0;
+		for(auto const &[id, allocation] : this->allocations)
+			if(allocation.heap==heap)
+				bytes += allocation.size;
+		return bytes;
+	}
+
+	// Evicts least recently used allocations of the heap until at least the given bytes are freed, returns the bytes freed
+	auto evict(uint32_t heap, uint64_t bytes) -> uint64_t {
+		std::vector<std::function<void()>> victims;
+		uint64_t freed = 0;
+		{
+			std::lock_guard lock(this->mutex);
+			std::vector<std::pair<uint64_t, Id>> candidates;
+			for(auto const &[id, allocation] : this->allocations)
+				if(allocation.heap==heap && allocation.lastUsed < this->frame)
+					candidates.emplace_back(allocation.lastUsed, id);
+			std::sort(candidates.begin(), candidates.end());
+			for(auto const &[lastUsed, id] : candidates) {
+				if(freed >= bytes)
+					break;
+				auto const it = this->allocations.find(id);
+				freed += it->second.size;
+				victims.push_back(std::move(it->second.evict));
+				this->allocations.erase(it);
+			}
+		}
+		// Outside the lock, evicting usually untracks or tracks something else
+		for(auto &victim : victims)
+			if(victim)
+				victim();
+		return freed;
+	}
+
+	// Applies the watermarks to every heap, the stats record what was evicted
+	auto enforce(MemoryStats &stats) -> uint64_t {
+		uint64_t freed = 0;
+		for(uint32_t heap = 0; heap < stats.heaps.size(); ++heap) {
+			auto const &budget = stats.heaps[heap];
+			if(budget.budget==0 || budget.usage <= budget.budget*HighWatermark)
+				continue;
+			auto const target = static_cast<uint64_t>(budget.budget*LowWatermark);
+			auto const bytes = this->evict(heap, budget.usage - target);
+			if(bytes > 0) {
+				freed += bytes;
+				++stats.evictions;
+			}
+		}
+		stats.evictedBytes += freed;
+		return freed;
+	}
+
+	// Called once per frame with fresh heap numbers, evicts as needed and keeps the numbers for readers
+	auto update(MemoryStats stats) -> uint64_t {
+		{
+			std::lock_guard lock(this->mutex);
+			stats.evictedBytes = this->published.evictedBytes;
+			stats.evictions	   = this->published.evictions;
+		}
+		auto const freed = this->enforce(stats);
+		std::lock_guard lock(this->mutex);
+		this->published = std::move(stats);
+		return freed;
+	}
+
+	auto stats() -> MemoryStats {
+		std::lock_guard lock(this->mutex);
+		return this->published;
+	}
+
+private:
+	struct Allocation {
+		uint32_t heap = 0;
+		uint64_t size = 0;
+		Eviction eviction = Eviction::Recreate;
+		uint64_t lastUsed = 0;
+		std::function<void()> evict;
+	};
+
+	std::mutex mutex;
+	Id nextId = 0;
+	uint64_t frame = 0;
+	std::map<Id, Allocation> allocations;
+	MemoryStats published;
+};
+}
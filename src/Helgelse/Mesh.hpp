@@ -0,0 +1,256 @@
+#pragma once
+#include "Helgelse/Culling.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+// The one vertex layout of the mesh arena, base vertex offsets only work when every mesh shares the stride
+struct MeshVertex {
+	std::array<float, 3> position{};
+	std::array<float, 3> normal{};
+	std::array<float, 2> uv{};
+};
+static_assert(sizeof(MeshVertex)==32);
+
+// Inserted at "/graphics/meshes/<name>", indices are relative to the mesh's own vertices
+struct Mesh {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+inline auto mesh_valid(Mesh const &mesh) -> bool {
+	if(mesh.vertices.empty() || mesh.indices.empty() || mesh.indices.size() % 3 != 0)
+		return false;
+	for(auto const index : mesh.indices)
+		if(index >= mesh.vertices.size())
+			return false;
+	return true;
+}
+
+// Where a mesh sits in the shared vertex and index buffers, in vertices and indices
+struct MeshRange {
+	uint32_t firstVertex = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+
+	auto operator==(MeshRange const&) const -> bool = default;
+};
+
+// The draw of a resident mesh with the arena's buffers bound, also what a CullInstance issues
+inline auto mesh_draw(MeshRange const &range, uint32_t instanceCount=1, uint32_t firstInstance=0) -> DrawIndexedIndirect {
+	return DrawIndexedIndirect{range.indexCount, instanceCount, range.firstIndex, static_cast<int32_t>(range.firstVertex), firstInstance};
+}
+
+enum struct MeshState { Uploading, Resident, Failed };
+
+// Read from "/graphics/meshes/<name>", a blocking read waits until the mesh is resident or failed
+struct MeshInfo {
+	MeshState state = MeshState::Uploading;
+	MeshRange range;
+};
+
+/*
+Offsets into a buffer of capacity elements. First fit over the free ranges kept sorted
+by offset, a freed range merges with free neighbours so the arena doesn't crumble into
+slivers no mesh fits in.
+*/
+struct ArenaAllocator {
+	ArenaAllocator() = default;
+	explicit ArenaAllocator(uint32_t capacity) { this->grow(capacity); }
+
+	auto allocate(uint32_t count) -> std::optional<uint32_t> {
+		if(count==0)
+			return std::nullopt;
+		for(auto it = this->ranges.begin(); it != this->ranges.end(); ++it) {
+			if(it->second < count)
+				continue;
+			auto const offset = it->first;
+			auto const rest	  = it->second - count;
+			this->ranges.erase(it);
+			if(rest > 0)
+				this->ranges.emplace(offset+count, rest);
+			this->usedCount += count;
+			return offset;
+		}
+		return std::nullopt;
+	}
+
+	auto free(uint32_t offset, uint32_t count) -> void {
+		if(count==0)
+			return;
+		this->usedCount -= count;
+		auto next = this->ranges.lower_bound(offset);
+		if(next != this->ranges.end() && offset+count==next->first) {
+			count += next->second;
+			next = this->ranges.erase(next);
+		}
+		if(next != this->ranges.begin()) {
+			auto const previous = std::prev(next);
+			if(previous->first+previous->second==offset) {
+				previous->second += count;
+				return;
+			}
+		}
+		this->ranges.emplace(offset, count);
+	}
+
+	// The new space starts at the old end, so everything allocated keeps its offset
+	auto grow(uint32_t capacity) -> void {
+		if(capacity <= this->total)
+			return;
+		auto const added = capacity - this->total;
+		auto const start = this->total;
+		this->total = capacity;
+		this->usedCount += added; // free takes it off again
+		this->free(start, added);
+	}
+
+	auto capacity() const -> uint32_t { return this->total; }
+	auto used() const -> uint32_t { return this->usedCount; }
+
+	// Highest offset in use plus one, what growing the buffer has to copy
+	auto extent() const -> uint32_t {
+		if(!this->ranges.empty()) {
+			auto const last = std::prev(this->ranges.end());
+			if(last->first+last->second==this->total)
+				return last->first;
+		}
+		return this->total;
+	}
+
+private:
+	std::map<uint32_t, uint32_t> ranges; // free ranges, offset to count
+	uint32_t total = 0;
+	uint32_t usedCount = 0;
+};
+
+struct PendingMesh {
+	std::string name;
+	uint64_t generation = 0;
+	std::shared_ptr<Mesh const> mesh;
+};
+
+/*
+The meshes inserted into the space, kept on the CPU so a lost device can upload them
+again. Inserts come from any thread, the frame loop takes pending meshes, uploads them
+into the arena and reports back where they went.
+*/
+struct MeshLibrary {
+	auto set(std::string const &name, Mesh mesh) -> bool {
+		if(!mesh_valid(mesh))
+			return false;
+		std::lock_guard lock(this->mutex);
+		auto &entry		 = this->entries[name];
+		entry.mesh		 = std::make_shared<Mesh const>(std::move(mesh));
+		entry.generation = ++this->generations;
+		entry.info		 = MeshInfo{};
+		this->pending.push_back(name);
+		return true;
+	}
+
+	auto remove(std::string const &name) -> std::shared_ptr<Mesh const> {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(name);
+		if(it==this->entries.end())
+			return nullptr;
+		auto mesh = it->second.mesh;
+		this->entries.erase(it);
+		this->removed.push_back(name);
+		this->changed.notify_all();
+		return mesh;
+	}
+
+	// Each mesh once even when it was replaced several times meanwhile
+	auto takePending() -> std::vector<PendingMesh> {
+		std::lock_guard lock(this->mutex);
+		std::vector<PendingMesh> taken;
+		for(auto const &name : this->pending) {
+			auto const it = this->entries.find(name);
+			if(it==this->entries.end() || it->second.info.state != MeshState::Uploading)
+				continue;
+			if(std::none_of(taken.begin(), taken.end(), [&](auto const &mesh) { return mesh.name==name; }))
+				taken.push_back(PendingMesh{name, it->second.generation, it->second.mesh});
+		}
+		this->pending.clear();
+		return taken;
+	}
+
+	auto takeRemoved() -> std::vector<std::string> {
+		std::lock_guard lock(this->mutex);
+		return std::exchange(this->removed, {});
+	}
+
+	// False when the mesh was replaced or removed since, its range is the uploader's to free
+	auto uploaded(std::string const &name, uint64_t generation, std::optional<MeshRange> range) -> bool {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(name);
+		if(it==this->entries.end() || it->second.generation != generation)
+			return false;
+		it->second.info = range ? MeshInfo{MeshState::Resident, *range} : MeshInfo{MeshState::Failed, {}};
+		this->changed.notify_all();
+		return range.has_value();
+	}
+
+	auto info(std::string_view name) const -> std::optional<MeshInfo> {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(name);
+		if(it==this->entries.end())
+			return std::nullopt;
+		return it->second.info;
+	}
+
+	auto wait(std::string_view name, std::chrono::steady_clock::duration timeout=std::chrono::hours(24)) const -> std::optional<MeshInfo> {
+		std::unique_lock lock(this->mutex);
+		std::optional<MeshInfo> info;
+		this->changed.wait_for(lock, timeout, [&] {
+			auto const it = this->entries.find(name);
+			if(it==this->entries.end()) {
+				info.reset();
+				return true;
+			}
+			info = it->second.info;
+			return info->state != MeshState::Uploading;
+		});
+		return info;
+	}
+
+	// After the arena was lost with the device, every mesh goes up again
+	auto reloadAll() {
+		std::lock_guard lock(this->mutex);
+		this->pending.clear();
+		this->removed.clear();
+		for(auto &[name, entry] : this->entries) {
+			entry.info = MeshInfo{};
+			this->pending.push_back(name);
+		}
+	}
+
+private:
+	struct Entry {
+		std::shared_ptr<Mesh const> mesh;
+		uint64_t generation = 0;
+		MeshInfo info;
+	};
+
+	mutable std::mutex mutex;
+	mutable std::condition_variable changed;
+	std::map<std::string, Entry, std::less<>> entries;
+	std::vector<std::string> pending;
+	std::vector<std::string> removed;
+	uint64_t generations = 0;
+};
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include "Helgelse/Shader.hpp"
+#include "Helgelse/PipelineCompiler.hpp"
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+/*
+Everything a pipeline is created from, two equal descriptions make interchangeable
+pipelines. Shaders are named by the hash of their SPIR-V rather than their id, so the
+same shader inserted twice, or culled with by several windows, shares one pipeline.
+Only compute pipelines go through the cache so far. The vertex layout, blend and depth
+state and attachment formats join the description together with the first graphics
+pipeline built here.
+*/
+struct PipelineDescription {
+	struct Stage {
+		ShaderStage stage = ShaderStage::Compute;
+		uint64_t spirvHash = 0;
+
+		auto operator<=>(Stage const&) const = default;
+	};
+	std::vector<Stage> shaders;
+	uint32_t storageBuffers = 0; // bindings 0..n-1 of set 0
+
+	auto operator<=>(PipelineDescription const&) const = default;
+};
+
+// FNV-1a over every field, lengths included so moving a value from one list to the next changes the hash
+inline auto pipeline_hash(PipelineDescription const &description) -> uint64_t {
+	uint64_t hash = 0xcbf29ce484222325;
+	auto const add = [&](uint64_t value) {
+		for(int shift = 0; shift < 64; shift += 8)
+			hash = (hash ^ ((value >> shift) & 0xff)) * 0x100000001b3;
+	};
+	add(description.shaders.size());
+	for(auto const &stage : description.shaders) {
+		add(static_cast<uint64_t>(stage.stage));
+		add(stage.spirvHash);
+	}
+	add(description.storageBuffers);
+	return hash;
+}
+
+struct PipelineDescriptionHash {
+	auto operator()(PipelineDescription const &description) const -> size_t {
+		return pipeline_hash(description);
+	}
+};
+
+// What compute jobs and culling build from a shader: storage buffers at bindings 0..count-1, push constants take the whole range
+inline auto compute_pipeline_description(Shader const &shader, size_t bufferCount) -> PipelineDescription {
+	return PipelineDescription{.shaders={{ShaderStage::Compute, shader.hash}}, .storageBuffers=static_cast<uint32_t>(bufferCount)};
+}
+
+// Frame loop iterations a pipeline built from a replaced or removed shader is kept for, in case something still falls back to it
+constexpr uint64_t PipelineUnusedTicks = 600;
+
+/*
+Pipelines by description, shared by every window and compute job. The builds run on a
+PipelineCompiler so the first use of a shader never stalls a frame for the driver's
+compiler. While a pipeline builds, get() returns nothing and the caller skips the work
+or keeps what it used before. A build that failed isn't retried, its description stays
+failed until it is evicted or the cache is reset. Pipelines are only handed back through
+evict() and reset(), whoever created them destroys them.
+*/
+template<typename Pipeline>
+struct PipelineCache {
+	explicit PipelineCache(std::function<void()> finished, size_t threads=0) : compiler(std::move(finished), threads) {}
+
+	// The pipeline once it's built, nullptr while it builds or when it failed. The first ask starts the build
+	auto get(PipelineDescription const &description, std::function<std::optional<Pipeline>()> create) -> Pipeline const* {
+		std::lock_guard lock(this->mutex);
+		auto &entry = this->entries[description];
+		entry.used	= this->ticks;
+		if(auto const *pipeline = this->collect(description, entry))
+			return pipeline;
+		// Descriptions never change, every one is built as version 1 of itself
+		if(!std::exchange(entry.asked, true))
+			this->compiler.build(description, 1, std::move(create));
+		return nullptr;
+	}
+
+	// Like get without starting a build, for keeping the previous pipeline while its replacement builds
+	auto find(PipelineDescription const &description) -> Pipeline const* {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(description);
+		if(it==this->entries.end())
+			return nullptr;
+		it->second.used = this->ticks;
+		return this->collect(description, it->second);
+	}
+
+	auto building(PipelineDescription const &description) -> bool {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(description);
+		return it != this->entries.end() && !this->collect(description, it->second) && this->compiler.building(description);
+	}
+
+	// How many builds finished since the last call, the frame loop redraws when any did
+	auto takeFinished() -> size_t {
+		return this->compiler.takeFinished();
+	}
+
+	// Blocks until every build asked for so far is done, for callers with no frame to keep going
+	auto wait() {
+		this->compiler.wait();
+	}
+
+	// Once per frame loop iteration, the clock evict() counts in
+	auto tick() {
+		std::lock_guard lock(this->mutex);
+		++this->ticks;
+	}
+
+	/*
+	Hands back the pipelines built from shaders that are gone, shaderHashes sorted, once
+	nothing asked for them for unusedTicks. Work recorded with them may still run, the
+	caller retires them.
+	*/
+	auto evict(std::vector<uint64_t> const &shaderHashes, uint64_t unusedTicks=PipelineUnusedTicks) -> std::vector<Pipeline> {
+		std::lock_guard lock(this->mutex);
+		std::vector<Pipeline> evicted;
+		for(auto it = this->entries.begin(); it != this->entries.end();) {
+			auto &[description, entry] = *it;
+			auto const current = std::all_of(description.shaders.begin(), description.shaders.end(), [&](auto const &stage) {
+				return std::binary_search(shaderHashes.begin(), shaderHashes.end(), stage.spirvHash);
+			});
+			if(current || entry.used+unusedTicks > this->ticks || (!this->collect(description, entry) && this->compiler.building(description))) {
+				++it;
+				continue;
+			}
+			if(entry.pipeline)
+				evicted.push_back(std::move(*entry.pipeline));
+			this->compiler.forget(description); // should the shader come back, its pipeline builds again
+			it = this->entries.erase(it);
+		}
+		return evicted;
+	}
+
+	// Before the device the pipelines were created on goes away: waits for running builds and hands back every pipeline
+	auto reset() -> std::vector<Pipeline> {
+		std::lock_guard lock(this->mutex);
+		auto pipelines = this->compiler.reset();
+		for(auto &[description, entry] : this->entries)
+			if(entry.pipeline)
+				pipelines.push_back(std::move(*entry.pipeline));
+		this->entries.clear();
+		return pipelines;
+	}
+
+	auto size() const -> size_t {
+		std::lock_guard lock(this->mutex);
+		return this->entries.size();
+	}
+
+private:
+	struct Entry {
+		std::optional<Pipeline> pipeline; // empty while building and when the build failed
+		bool asked = false;
+		uint64_t used = 0; // tick of the last get or find
+	};
+
+	// Takes over a build that finished since the last look, called with the mutex held
+	auto collect(PipelineDescription const &description, Entry &entry) -> Pipeline const* {
+		if(!entry.pipeline)
+			for(auto &pipeline : this->compiler.take(description))
+				entry.pipeline = std::move(pipeline); // one build per description, failed ones hand over nothing
+		return entry.pipeline ? &*entry.pipeline : nullptr;
+	}
+
+	mutable std::mutex mutex;
+	std::unordered_map<PipelineDescription, Entry, PipelineDescriptionHash> entries; // nodes stay put, handed out pointers survive rehashing
+	uint64_t ticks = 0;
+	PipelineCompiler<Pipeline, PipelineDescription> compiler; // declared last, its pool joins the workers before the rest goes away
+};
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "Helgelse/WorkerPool.hpp"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+/*
+Builds pipelines on a worker pool so the first use of a shader never stalls a frame for
+the driver's compiler. Whoever needs a pipeline asks for a build and keeps drawing with
+what it has, the previous version or nothing, until take() hands over the result. The
+version asked for last is remembered per key, a build that failed isn't retried until
+the version changes. Keys are shader ids for callers that track versions themselves, or
+anything ordered, the pipeline cache keys by description.
+*/
+template<typename Pipeline, typename Key=std::string>
+struct PipelineCompiler {
+	explicit PipelineCompiler(std::function<void()> finished, size_t threads=0) : finished(std::move(finished)), pool(threads) {}
+
+	// Queues create unless version is the one last asked for under key, true when it was queued
+	auto build(Key const &key, uint64_t version, std::function<std::optional<Pipeline>()> create) -> bool {
+		{
+			std::lock_guard lock(this->mutex);
+			auto &entry = this->entries[key];
+			if(entry.version==version)
+				return false;
+			entry.version = version;
+			++entry.running;
+		}
+		this->pool.submit([this, key, create = std::move(create)] {
+			auto pipeline = create();
+			{
+				std::lock_guard lock(this->mutex);
+				auto &entry = this->entries[key];
+				--entry.running;
+				if(pipeline)
+					entry.built.push_back(std::move(*pipeline));
+				++this->finishedCount;
+			}
+			if(this->finished)
+				this->finished();
+		});
+		return true;
+	}
+
+	// Builds of key that finished since the last call, oldest first, failed ones are left out
+	auto take(Key const &key) -> std::vector<Pipeline> {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(key);
+		if(it==this->entries.end())
+			return {};
+		return std::exchange(it->second.built, {});
+	}
+
+	// Queued, running, or done and not taken yet
+	auto building(Key const &key) const -> bool {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(key);
+		return it != this->entries.end() && (it->second.running > 0 || !it->second.built.empty());
+	}
+
+	// How many builds finished since the last call, the frame loop redraws when any did
+	auto takeFinished() -> size_t {
+		std::lock_guard lock(this->mutex);
+		return std::exchange(this->finishedCount, 0);
+	}
+
+	// Blocks until every build asked for so far is done, for callers with no frame to keep going
+	auto wait() {
+		this->pool.drain();
+	}
+
+	// Forgets the version asked for under key so the next build queues whatever it is, nothing of key may be running
+	auto forget(Key const &key) -> std::vector<Pipeline> {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->entries.find(key);
+		if(it==this->entries.end())
+			return {};
+		auto untaken = std::move(it->second.built);
+		this->entries.erase(it);
+		return untaken;
+	}
+
+	// Before the device the pipelines were created on goes away: hands back every pipeline nobody took and forgets the versions
+	auto reset() -> std::vector<Pipeline> {
+		this->pool.drain();
+		std::lock_guard lock(this->mutex);
+		std::vector<Pipeline> untaken;
+		for(auto &[key, entry] : this->entries)
+			for(auto &pipeline : entry.built)
+				untaken.push_back(std::move(pipeline));
+		this->entries.clear();
+		this->finishedCount = 0;
+		return untaken;
+	}
+
+private:
+	struct Entry {
+		uint64_t version = 0;
+		size_t running = 0;
+		std::vector<Pipeline> built;
+	};
+
+	std::function<void()> finished; // wakes the frame loop to pick the pipeline up
+	mutable std::mutex mutex;
+	std::map<Key, Entry, std::less<>> entries;
+	size_t finishedCount = 0;
+	WorkerPool pool; // declared last, its destructor joins the workers before the rest goes away
+};
+}
@@ -0,0 +1,387 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+struct RenderGraphContext; // what a pass records into, see VulkanRenderGraph.hpp
+
+enum struct Access {
+	ColorAttachment,
+	DepthAttachment,
+	DepthRead,
+	Sampled,
+	StorageRead,
+	StorageWrite,
+	TransferSrc,
+	TransferDst,
+	VertexBuffer,
+	IndexBuffer,
+	IndirectBuffer,
+	UniformBuffer,
+	Present
+};
+
+enum struct Layout {
+	Undefined,
+	General,
+	ColorAttachment,
+	DepthAttachment,
+	DepthReadOnly,
+	ShaderReadOnly,
+	TransferSrc,
+	TransferDst,
+	Present
+};
+
+constexpr auto is_write(Access access) -> bool {
+	switch(access) {
+		case Access::ColorAttachment:
+		case Access::DepthAttachment:
+		case Access::StorageWrite:
+		case Access::TransferDst:
+			return true;
+		default:
+			return false;
+	}
+}
+
+constexpr auto layout_of(Access access) -> Layout {
+	switch(access) {
+		case Access::ColorAttachment: return Layout::ColorAttachment;
+		case Access::DepthAttachment: return Layout::DepthAttachment;
+		case Access::DepthRead:		  return Layout::DepthReadOnly;
+		case Access::Sampled:		  return Layout::ShaderReadOnly;
+		case Access::StorageRead:
+		case Access::StorageWrite:	  return Layout::General;
+		case Access::TransferSrc:	  return Layout::TransferSrc;
+		case Access::TransferDst:	  return Layout::TransferDst;
+		case Access::Present:		  return Layout::Present;
+		default:					  return Layout::Undefined;
+	}
+}
+
+struct RenderGraphResource {
+	enum struct Kind { Image, Buffer };
+
+	std::string name;
+	Kind kind = Kind::Image;
+	bool imported = false;
+	std::optional<Access> initial;	// state an imported resource arrives in, nullopt when its contents don't matter
+	std::optional<Access> final;	// set for graph outputs, the state the resource must be left in
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t format = 0;			// VkFormat of transient images
+	uint64_t size = 0;				// bytes of transient buffers
+};
+
+struct RenderGraphPass {
+	std::string name;
+	std::vector<std::pair<uint32_t, Access>> uses;
+	std::function<void(RenderGraphContext&)> execute;
+	bool sideEffects = false;		// never culled, e.g. readbacks the graph can't see
+};
+
+struct RenderGraphBarrier {
+	uint32_t resource = 0;
+	std::vector<Access> after;		// accesses that must finish first, empty when nothing touched the resource yet
+	Access before = Access::Present;
+	Layout oldLayout = Layout::Undefined;
+	Layout newLayout = Layout::Undefined;
+};
+
+struct CompiledRenderGraph {
+	std::vector<uint32_t> order;						// live passes in execution order
+	std::vector<std::vector<RenderGraphBarrier>> barriers; // barriers[i] go right before order[i]
+	std::vector<RenderGraphBarrier> finalBarriers;		// put outputs in their final state
+	std::vector<std::pair<uint32_t, uint32_t>> lifetimes; // first and last step each resource is used in, UINT32_MAX when unused
+};
+
+// What a transient resource needs from memory, size 0 keeps it out of aliasing
+struct MemoryRequirement {
+	uint64_t size = 0;
+	uint64_t alignment = 1;
+	uint32_t memoryTypeBits = 0;
+};
+
+struct AliasPlacement {
+	uint32_t block = UINT32_MAX;
+	uint64_t offset = 0;
+};
+
+// Transients packed into shared memory blocks, resources whose lifetimes don't overlap may share bytes
+struct AliasPlan {
+	struct Block {
+		uint64_t size = 0;
+		uint32_t memoryTypeBits = 0;
+	};
+
+	std::vector<AliasPlacement> placements; // indexed like the graph's resources
+	std::vector<Block> blocks;
+};
+
+/*
+Passes declare what they read and write, the graph works out the rest: passes whose
+results never reach an output are culled, the survivors are ordered by dependency
+level so independent work sits together, and each resource is tracked through the
+frame so barriers and layout transitions are emitted only where an access actually
+conflicts with the previous one. Writes are treated as read-modify-write, attachments
+loaded by a later pass keep the pass that filled them alive.
+*/
+struct RenderGraph {
+	auto importImage(std::string name, std::optional<Access> initial) -> uint32_t {
+		return this->addResource(RenderGraphResource{.name=std::move(name), .kind=RenderGraphResource::Kind::Image, .imported=true, .initial=initial});
+	}
+
+	auto importBuffer(std::string name, std::optional<Access> initial) -> uint32_t {
+		return this->addResource(RenderGraphResource{.name=std::move(name), .kind=RenderGraphResource::Kind::Buffer, .imported=true, .initial=initial});
+	}
+
+	auto createImage(std::string name, uint32_t width, uint32_t height, uint32_t format) -> uint32_t {
+		return this->addResource(RenderGraphResource{.name=std::move(name), .kind=RenderGraphResource::Kind::Image, .width=width, .height=height, .format=format});
+	}
+
+	auto createBuffer(std::string name, uint64_t size) -> uint32_t {
+		return this->addResource(RenderGraphResource{.name=std::move(name), .kind=RenderGraphResource::Kind::Buffer, .size=size});
+	}
+
+	auto addPass(std::string name, std::vector<std::pair<uint32_t, Access>> uses, std::function<void(RenderGraphContext&)> execute, bool sideEffects=false) -> uint32_t {
+		this->passList.push_back(RenderGraphPass{std::move(name), std::move(uses), std::move(execute), sideEffects});
+		return static_cast<uint32_t>(this->passList.size()-1);
+	}
+
+	auto markOutput(uint32_t resource, Access final) {
+		this->resourceList[resource].final = final;
+	}
+
+	auto resources() const -> std::vector<RenderGraphResource> const& { return this->resourceList; }
+	auto passes() const -> std::vector<RenderGraphPass> const& { return this->passList; }
+
+	auto compile() const -> CompiledRenderGraph {
+		CompiledRenderGraph compiled;
+		auto const live = this->livePasses();
+
+		// Dependency level of every live pass, edges come from read-after-write, write-after-read and write-after-write
+		std::vector<uint32_t> level(this->passList.size(), 0);
+		std::vector<std::optional<uint32_t>> lastWriter(this->resourceList.size());
+		std::vector<std::vector<uint32_t>> readers(this->resourceList.size());
+		for(uint32_t pass = 0; pass < this->passList.size(); ++pass) {
+			if(!live[pass])
+				continue;
+			for(auto const &[resource, access] : this->passList[pass].uses) {
+				if(lastWriter[resource])
+					level[pass] = std::max(level[pass], level[*lastWriter[resource]]+1);
+				if(is_write(access))
+					for(auto const reader : readers[resource])
+						if(reader != pass)
+							level[pass] = std::max(level[pass], level[reader]+1);
+			}
+			for(auto const &[resource, access] : this->passList[pass].uses) {
+				if(is_write(access)) {
+					lastWriter[resource] = pass;
+					readers[resource].clear();
+				}
+				else
+					readers[resource].push_back(pass);
+			}
+		}
+		for(uint32_t pass = 0; pass < this->passList.size(); ++pass)
+			if(live[pass])
+				compiled.order.push_back(pass);
+		std::stable_sort(compiled.order.begin(), compiled.order.end(), [&level](auto lhs, auto rhs) { return level[lhs] < level[rhs]; });
+
+		std::vector<ResourceState> states;
+		for(auto const &resource : this->resourceList) {
+			ResourceState state;
+			if(resource.initial) {
+				state.layout = layout_of(*resource.initial);
+				state.lastWrite = resource.initial;
+			}
+			states.push_back(state);
+		}
+		compiled.lifetimes.assign(this->resourceList.size(), {UINT32_MAX, UINT32_MAX});
+		for(uint32_t step = 0; step < compiled.order.size(); ++step) {
+			auto &barriers = compiled.barriers.emplace_back();
+			for(auto const &[resource, access] : this->passList[compiled.order[step]].uses) {
+				this->transition(resource, access, states[resource], barriers);
+				auto &lifetime = compiled.lifetimes[resource];
+				if(lifetime.first==UINT32_MAX)
+					lifetime.first = step;
+				lifetime.second = step;
+			}
+		}
+		for(uint32_t resource = 0; resource < this->resourceList.size(); ++resource)
+			if(auto const final = this->resourceList[resource].final)
+				this->transition(resource, *final, states[resource], compiled.finalBarriers);
+		return compiled;
+	}
+
+	/*
+	Places the transients of a compiled graph into as few memory blocks as possible. The
+	largest go first, each into the lowest offset of a compatible block where it doesn't
+	collide with anything alive during the same steps, growing the block if it must. Whoever used the bytes before a
+	resource, earlier in this frame or at the end of the previous one, has to finish
+	before it is first touched, so its first barrier is extended to wait for them.
+	*/
+	auto alias(CompiledRenderGraph &compiled, std::vector<MemoryRequirement> const &requirements) const -> AliasPlan {
+		AliasPlan plan;
+		plan.placements.resize(this->resourceList.size());
+		std::vector<uint32_t> candidates;
+		for(uint32_t resource = 0; resource < this->resourceList.size(); ++resource)
+			if(resource < requirements.size() && requirements[resource].size > 0 && !this->resourceList[resource].imported &&
+			   compiled.lifetimes[resource].first != UINT32_MAX)
+				candidates.push_back(resource);
+		std::stable_sort(candidates.begin(), candidates.end(), [&requirements](auto lhs, auto rhs) { return requirements[lhs].size > requirements[rhs].size; });
+
+		std::vector<std::vector<uint32_t>> residents;
+		for(auto const resource : candidates) {
+			auto const &requirement = requirements[resource];
+			auto const &lifetime = compiled.lifetimes[resource];
+			auto placed = false;
+			for(uint32_t block = 0; block < plan.blocks.size() && !placed; ++block) {
+				if((plan.blocks[block].memoryTypeBits & requirement.memoryTypeBits)==0)
+					continue;
+				// Candidate offsets are the start of the block and the end of every resident alive at the same time
+				std::vector<uint64_t> offsets{0};
+				for(auto const other : residents[block])
+					if(overlaps(lifetime, compiled.lifetimes[other]))
+						offsets.push_back(plan.placements[other].offset + requirements[other].size);
+				std::sort(offsets.begin(), offsets.end());
+				for(auto offset : offsets) {
+					offset = (offset + requirement.alignment-1) / requirement.alignment * requirement.alignment;
+					auto const collides = std::any_of(residents[block].begin(), residents[block].end(), [&](auto other) {
+						auto const otherOffset = plan.placements[other].offset;
+						return overlaps(lifetime, compiled.lifetimes[other]) &&
+							   offset < otherOffset + requirements[other].size && otherOffset < offset + requirement.size;
+					});
+					if(!collides) {
+						plan.placements[resource] = AliasPlacement{block, offset};
+						plan.blocks[block].size = std::max(plan.blocks[block].size, offset + requirement.size);
+						plan.blocks[block].memoryTypeBits &= requirement.memoryTypeBits;
+						residents[block].push_back(resource);
+						placed = true;
+						break;
+					}
+				}
+			}
+			if(!placed) {
+				plan.placements[resource] = AliasPlacement{static_cast<uint32_t>(plan.blocks.size()), 0};
+				plan.blocks.push_back(AliasPlan::Block{requirement.size, requirement.memoryTypeBits});
+				residents.push_back({resource});
+			}
+		}
+
+		for(uint32_t block = 0; block < residents.size(); ++block)
+			for(auto const resource : residents[block])
+				this->waitForPreviousOccupants(compiled, requirements, plan, residents[block], resource);
+		return plan;
+	}
+
+private:
+	struct ResourceState {
+		Layout layout = Layout::Undefined;
+		std::optional<Access> lastWrite;
+		std::vector<Access> readers; // reads since the last write, a new write has to wait for them
+	};
+
+	auto addResource(RenderGraphResource resource) -> uint32_t {
+		this->resourceList.push_back(std::move(resource));
+		return static_cast<uint32_t>(this->resourceList.size()-1);
+	}
+
+	// Walk backwards from the outputs, a pass lives if it writes something a later live pass or an output needs
+	auto livePasses() const -> std::vector<bool> {
+		std::vector<bool> live(this->passList.size(), false);
+		std::vector<bool> needed(this->resourceList.size(), false);
+		for(uint32_t resource = 0; resource < this->resourceList.size(); ++resource)
+			needed[resource] = this->resourceList[resource].final.has_value();
+		for(auto pass = this->passList.size(); pass-- > 0;) {
+			auto const &uses = this->passList[pass].uses;
+			live[pass] = this->passList[pass].sideEffects ||
+						 std::any_of(uses.begin(), uses.end(), [&needed](auto const &use) { return is_write(use.second) && needed[use.first]; });
+			if(live[pass])
+				for(auto const &[resource, access] : uses)
+					needed[resource] = true;
+		}
+		return live;
+	}
+
+	static auto overlaps(std::pair<uint32_t, uint32_t> const &lhs, std::pair<uint32_t, uint32_t> const &rhs) -> bool {
+		return lhs.first <= rhs.second && rhs.first <= lhs.second;
+	}
+
+	auto accessesAt(uint32_t resource, uint32_t pass) const -> std::vector<Access> {
+		std::vector<Access> accesses;
+		for(auto const &[used, access] : this->passList[pass].uses)
+			if(used==resource)
+				accesses.push_back(access);
+		return accesses;
+	}
+
+	auto waitForPreviousOccupants(CompiledRenderGraph &compiled, std::vector<MemoryRequirement> const &requirements, AliasPlan const &plan, std::vector<uint32_t> const &residents, uint32_t resource) const -> void {
+		auto const &placement = plan.placements[resource];
+		auto const first = compiled.lifetimes[resource].first;
+		std::vector<Access> after;
+		for(auto const other : residents) {
+			auto const &otherPlacement = plan.placements[other];
+			if(placement.offset >= otherPlacement.offset + requirements[other].size || otherPlacement.offset >= placement.offset + requirements[resource].size)
+				continue;
+			for(auto const access : this->accessesAt(other, compiled.order[compiled.lifetimes[other].second]))
+				if(std::find(after.begin(), after.end(), access)==after.end())
+					after.push_back(access);
+		}
+
+		auto &barriers = compiled.barriers[first];
+		auto const it = std::find_if(barriers.begin(), barriers.end(), [resource](auto const &barrier) { return barrier.resource==resource; });
+		if(it != barriers.end()) {
+			for(auto const access : after)
+				if(std::find(it->after.begin(), it->after.end(), access)==it->after.end())
+					it->after.push_back(access);
+			return;
+		}
+		// Buffers written first get no barrier of their own, the aliasing one is new
+		auto const access = this->accessesAt(resource, compiled.order[first]).front();
+		auto const isImage = this->resourceList[resource].kind==RenderGraphResource::Kind::Image;
+		barriers.push_back(RenderGraphBarrier{resource, std::move(after), access, Layout::Undefined, isImage ? layout_of(access) : Layout::Undefined});
+	}
+
+	auto transition(uint32_t resource, Access access, ResourceState &state, std::vector<RenderGraphBarrier> &barriers) const -> void {
+		auto const isImage = this->resourceList[resource].kind==RenderGraphResource::Kind::Image;
+		auto const newLayout = isImage ? layout_of(access) : Layout::Undefined;
+		auto const layoutChange = isImage && state.layout != newLayout;
+		auto const barrier = [&](std::vector<Access> after) {
+			barriers.push_back(RenderGraphBarrier{resource, std::move(after), access, state.layout, newLayout});
+		};
+
+		if(is_write(access) || layoutChange) {
+			if(!state.readers.empty())
+				barrier(state.readers);
+			else if(state.lastWrite)
+				barrier({*state.lastWrite});
+			else if(layoutChange)
+				barrier({});
+			state.layout = newLayout;
+			if(is_write(access)) {
+				state.lastWrite = access;
+				state.readers.clear();
+			}
+			else
+				state.readers = {access};
+			return;
+		}
+		// Reads in the same layout only wait for the last write, and only once per kind of read
+		if(std::find(state.readers.begin(), state.readers.end(), access) != state.readers.end())
+			return;
+		if(state.lastWrite && is_write(*state.lastWrite))
+			barrier({*state.lastWrite});
+		state.readers.push_back(access);
+	}
+
+	std::vector<RenderGraphResource> resourceList;
+	std::vector<RenderGraphPass> passList;
+};
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+// What a path matched: the segments that filled "*" and whatever "**" swallowed
+struct RouteMatch {
+	static constexpr size_t MaxCaptures = 4;
+
+	auto capture(size_t i) const -> std::string_view { return i < this->captureCount ? this->captures[i] : std::string_view{}; }
+
+	// The rest of the path behind capture i with its leading '/', what a space mounted at the captured segment sees
+	auto after(size_t i) const -> std::string_view {
+		if(i >= this->captureCount)
+			return {};
+		auto const end = this->captures[i].data() + this->captures[i].size();
+		return this->path.substr(static_cast<size_t>(end - this->path.data()));
+	}
+
+	std::array<std::string_view, MaxCaptures> captures{};
+	size_t captureCount = 0;
+	std::string_view remainder;
+	std::string_view path; // the whole matched path, without leading or trailing '/'
+};
+
+/*
+Trie over path segments built once up front. Patterns are "/"-separated, "*" matches
+one segment and a trailing "**" matches the rest of the path. A lookup walks the
+path comparing string_views against each node's sorted children, backing up to the
+wildcard or a "**" where a literal branch has no handler, and never allocates. Each node keeps its handlers in a vector indexed
+by a per-type slot, with an optional handler for any type. Callers that know the
+type at compile time get the slot without touching RTTI.
+*/
+template<typename Handler>
+struct RouteTable {
+	static constexpr uint32_t None = UINT32_MAX;
+
+	template<typename T>
+	static auto typeSlot() -> uint32_t {
+		static uint32_t const slot = nextSlot++;
+		return slot;
+	}
+
+	template<typename T>
+	auto add(std::string_view pattern, Handler handler) -> void {
+		auto const slot = typeSlot<T>();
+		if(this->slotOf(std::type_index(typeid(T)))==None)
+			this->slots.emplace_back(std::type_index(typeid(T)), slot);
+		auto &typed = this->nodes[this->addPattern(pattern)].typed;
+		if(typed.size() <= slot)
+			typed.resize(slot+1);
+		typed[slot] = std::move(handler);
+	}
+
+	// Handles every type that has no handler of its own on the same pattern
+	auto add(std::string_view pattern, Handler handler) -> void {
+		this->nodes[this->addPattern(pattern)].any = std::move(handler);
+	}
+
+	// Slot of a type only known at runtime, None if no handler was registered for it
+	auto slotOf(std::type_index type) const -> uint32_t {
+		for(auto const &[slotType, slot] : this->slots)
+			if(slotType==type)
+				return slot;
+		return None;
+	}
+
+	auto find(std::string_view path, std::type_index type) const -> std::optional<std::pair<Handler const*, RouteMatch>> {
+		return this->find(path, this->slotOf(type));
+	}
+
+	auto find(std::string_view path, uint32_t slot) const -> std::optional<std::pair<Handler const*, RouteMatch>> {
+		RouteMatch match;
+		match.path = trim(path);
+		return this->walk(0, match.path, slot, match);
+	}
+
+private:
+	/*
+	Depth first from node over what is left of the path: a literal child before the
+	wildcard before "**", so a captured name that happens to equal a literal segment
+	still reaches the route behind the wildcard when the literal one has no handler.
+	*/
+	auto walk(uint32_t node, std::string_view remaining, uint32_t slot, RouteMatch &match) const -> std::optional<std::pair<Handler const*, RouteMatch>> {
+		auto const &current = this->nodes[node];
+		if(remaining.empty()) {
+			if(auto const handler = current.handler(slot))
+				return std::make_pair(handler, match);
+			return std::nullopt;
+		}
+		auto const slash = remaining.find('/');
+		auto const segment = remaining.substr(0, slash);
+		auto const rest = slash==std::string_view::npos ? std::string_view{} : remaining.substr(slash+1);
+
+		auto const it = std::lower_bound(current.children.begin(), current.children.end(), segment, [](auto const &child, auto const &name) { return child.first < name; });
+		if(it != current.children.end() && it->first==segment)
+			if(auto found = this->walk(it->second, rest, slot, match))
+				return found;
+		if(current.wildcard != None && match.captureCount < RouteMatch::MaxCaptures) {
+			match.captures[match.captureCount++] = segment;
+			if(auto found = this->walk(current.wildcard, rest, slot, match))
+				return found;
+			match.captures[--match.captureCount] = {};
+		}
+		if(current.rest != None)
+			if(auto const handler = this->nodes[current.rest].handler(slot)) {
+				auto found = match;
+				found.remainder = remaining;
+				return std::make_pair(handler, found);
+			}
+		return std::nullopt;
+	}
+
+	auto addPattern(std::string_view pattern) -> uint32_t {
+		uint32_t node = 0;
+		for(auto segment : split(pattern)) {
+			if(segment=="**") {
+				if(this->nodes[node].rest==None)
+					this->nodes[node].rest = this->addNode();
+				node = this->nodes[node].rest;
+				break;
+			}
+			if(segment=="*") {
+				if(this->nodes[node].wildcard==None)
+					this->nodes[node].wildcard = this->addNode();
+				node = this->nodes[node].wildcard;
+				continue;
+			}
+			auto const &children = this->nodes[node].children;
+			auto const it = std::lower_bound(children.begin(), children.end(), segment, [](auto const &child, auto const &name) { return child.first < name; });
+			if(it != children.end() && it->first==segment) {
+				node = it->second;
+				continue;
+			}
+			auto const position = it - children.begin();
+			auto const child = this->addNode(); // may reallocate the nodes, so insert by position
+			this->nodes[node].children.emplace(this->nodes[node].children.begin() + position, std::string(segment), child);
+			node = child;
+		}
+		return node;
+	}
+
+	struct Node {
+		auto handler(uint32_t slot) const -> Handler const* {
+			if(slot < this->typed.size() && this->typed[slot])
+				return &*this->typed[slot];
+			return this->any ? &*this->any : nullptr;
+		}
+
+		std::vector<std::pair<std::string, uint32_t>> children; // sorted by name
+		uint32_t wildcard = None;
+		uint32_t rest = None;
+		std::vector<std::optional<Handler>> typed; // indexed by type slot
+		std::optional<Handler> any;
+	};
+
+	static auto trim(std::string_view path) -> std::string_view {
+		while(!path.empty() && path.front()=='/')
+			path.remove_prefix(1);
+		while(!path.empty() && path.back()=='/')
+			path.remove_suffix(1);
+		return path;
+	}
+
+	static auto split(std::string_view pattern) -> std::vector<std::string_view> {
+		std::vector<std::string_view> segments;
+		pattern = trim(pattern);
+		while(!pattern.empty()) {
+			auto const slash = pattern.find('/');
+			segments.push_back(pattern.substr(0, slash));
+			pattern = slash==std::string_view::npos ? std::string_view{} : pattern.substr(slash+1);
+		}
+		return segments;
+	}
+
+	auto addNode() -> uint32_t {
+		this->nodes.emplace_back();
+		return static_cast<uint32_t>(this->nodes.size()-1);
+	}
+
+	static inline std::atomic<uint32_t> nextSlot = 0;
+	std::vector<std::pair<std::type_index, uint32_t>> slots;
+	std::vector<Node> nodes = std::vector<Node>(1);
+};
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Set by the build together with the library, see HELGELSE_WITH_SHADERC in CMakeLists.txt
+#ifdef HELGELSE_WITH_SHADERC
+#include <shaderc/shaderc.hpp>
+#endif
+
+namespace Helgelse {
+constexpr uint32_t SpirvMagic = 0x07230203;
+
+// Only checks what would otherwise crash the driver: the header is there and the words are whole
+inline auto spirv_valid(std::span<uint32_t const> words) -> bool {
+	return words.size() >= 5 && words[0]==SpirvMagic;
+}
+
+inline auto shader_read_spirv(std::string const &path) -> std::optional<std::vector<uint32_t>> {
+	std::ifstream file(path, std::ios::binary);
+	if(!file)
+		return std::nullopt;
+	std::vector<char> const bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+	if(bytes.size() % 4 != 0)
+		return std::nullopt;
+	std::vector<uint32_t> words(bytes.size()/4);
+	std::memcpy(words.data(), bytes.data(), bytes.size());
+	if(!spirv_valid(words))
+		return std::nullopt;
+	return words;
+}
+
+enum struct ShaderStage { Vertex, Fragment, Compute };
+
+// From the name, "blur.comp", "blur.comp.glsl" and "blur.comp.hlsl" are all compute shaders
+inline auto shader_stage_from_path(std::string_view path) -> std::optional<ShaderStage> {
+	if(path.ends_with(".glsl") || path.ends_with(".hlsl"))
+		path.remove_suffix(5);
+	if(path.ends_with(".vert"))
+		return ShaderStage::Vertex;
+	if(path.ends_with(".frag"))
+		return ShaderStage::Fragment;
+	if(path.ends_with(".comp"))
+		return ShaderStage::Compute;
+	return std::nullopt;
+}
+
+// Sources are named after their stage and compiled, anything else (.spv, .spirv, .bin) is taken as SPIR-V
+inline auto shader_is_source(std::string_view path) -> bool {
+	return shader_stage_from_path(path).has_value();
+}
+
+// Empty SPIR-V when compilation failed, the log says why
+struct ShaderCompileResult {
+	std::vector<uint32_t> spirv;
+	std::string log;
+};
+
+using ShaderCompile = std::function<ShaderCompileResult(std::string const &source, std::string const &path)>;
+
+inline auto shader_compile(std::string const &source, std::string const &path) -> ShaderCompileResult {
+#ifdef HELGELSE_WITH_SHADERC
+	auto const stage = shader_stage_from_path(path);
+	if(!stage)
+		return {{}, path + ": unknown stage, name the file .vert, .frag or .comp"};
+	shaderc::Compiler compiler;
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	if(path.ends_with(".hlsl"))
+		options.SetSourceLanguage(shaderc_source_language_hlsl);
+	auto const kind = *stage==ShaderStage::Vertex ? shaderc_vertex_shader : *stage==ShaderStage::Fragment ? shaderc_fragment_shader : shaderc_compute_shader;
+	auto const result = compiler.CompileGlslToSpv(source, kind, path.c_str(), "main", options);
+	if(result.GetCompilationStatus() != shaderc_compilation_status_success)
+		return {{}, result.GetErrorMessage()};
+	return {{result.cbegin(), result.cend()}, result.GetErrorMessage()};
+#else
+	return {{}, path + ": built without shaderc, only SPIR-V shaders can be loaded"};
+#endif
+}
+
+// FNV-1a over the words, what pipeline descriptions name a shader by
+inline auto spirv_hash(std::span<uint32_t const> words) -> uint64_t {
+	uint64_t hash = 0xcbf29ce484222325;
+	for(auto const word : words)
+		for(int shift = 0; shift < 32; shift += 8)
+			hash = (hash ^ ((word >> shift) & 0xff)) * 0x100000001b3;
+	return hash;
+}
+
+struct Shader {
+	std::vector<uint32_t> spirv;
+	uint64_t version = 0; // bumped by every set, pipelines built from an older version are stale
+	uint64_t hash = 0;	  // of the SPIR-V, equal shaders under different ids share their pipelines
+};
+
+/*
+The shaders inserted into the space under "/shaders/<id>", as SPIR-V. Pipelines refer
+to them by id and compare versions, so replacing a shader rebuilds whatever uses it
+the next time it is used. Inserts come from any thread, the frame loop reads.
+Recompiled shaders are staged instead and only show up with the next commit, which
+the frame loop does between frames, so every window of a frame sees the same set.
+*/
+struct ShaderLibrary {
+	auto set(std::string const &id, std::vector<uint32_t> spirv) -> bool {
+		if(!spirv_valid(spirv))
+			return false;
+		std::lock_guard lock(this->mutex);
+		this->staged.erase(id); // an insert wins over a recompile that hasn't shown up yet
+		auto const hash = spirv_hash(spirv);
+		this->shaders[id] = Shader{std::move(spirv), ++this->versions, hash};
+		return true;
+	}
+
+	auto stage(std::string const &id, std::vector<uint32_t> spirv) -> bool {
+		if(!spirv_valid(spirv))
+			return false;
+		std::lock_guard lock(this->mutex);
+		this->staged[id] = std::move(spirv);
+		return true;
+	}
+
+	// Returns whether anything changed, pipelines built from the replaced versions are rebuilt on their next use
+	auto commit() -> bool {
+		std::lock_guard lock(this->mutex);
+		for(auto &[id, spirv] : this->staged) {
+			auto const hash = spirv_hash(spirv);
+			this->shaders[id] = Shader{std::move(spirv), ++this->versions, hash};
+		}
+		return !std::exchange(this->staged, {}).empty();
+	}
+
+	auto get(std::string const &id) const -> std::optional<Shader> {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->shaders.find(id);
+		if(it==this->shaders.end())
+			return std::nullopt;
+		return it->second;
+	}
+
+	auto version(std::string const &id) const -> uint64_t {
+		std::lock_guard lock(this->mutex);
+		auto const it = this->shaders.find(id);
+		return it==this->shaders.end() ? 0 : it->second.version;
+	}
+
+	auto remove(std::string const &id) -> bool {
+		std::lock_guard lock(this->mutex);
+		this->staged.erase(id);
+		return this->shaders.erase(id) > 0;
+	}
+
+	// Of every shader in the library, pipelines built from anything else can't be asked for anymore
+	auto hashes() const -> std::vector<uint64_t> {
+		std::lock_guard lock(this->mutex);
+		std::vector<uint64_t> hashes;
+		for(auto const &[id, shader] : this->shaders)
+			hashes.push_back(shader.hash);
+		std::sort(hashes.begin(), hashes.end());
+		return hashes;
+	}
+
+private:
+	mutable std::mutex mutex;
+	std::map<std::string, Shader, std::less<>> shaders;
+	std::map<std::string, std::vector<uint32_t>, std::less<>> staged;
+	uint64_t versions = 0;
+};
+}
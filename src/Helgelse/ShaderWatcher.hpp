@@ -0,0 +1,137 @@
+#pragma once
+#include "Helgelse/Shader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+/*
+Keeps shader sources on disk compiled into the library. Every watched file is compiled
+when it is added and again whenever its modification time or size changes, on the
+watcher's own thread so neither the inserting thread nor the frame loop waits for the
+compiler. Results are staged in the library and show up with its next commit, a
+source that fails to compile leaves the last good SPIR-V, and the pipelines built from
+it, in place. An interval of zero starts no thread, poll() is then called by hand.
+*/
+struct ShaderWatcher {
+	ShaderWatcher(std::shared_ptr<ShaderLibrary> library, ShaderCompile compile, std::function<void()> compiled,
+				  std::chrono::milliseconds interval=std::chrono::milliseconds(250))
+		: library(std::move(library)), compile(std::move(compile)), compiled(std::move(compiled)), interval(interval) {}
+	ShaderWatcher(ShaderWatcher const&) = delete;
+	auto operator=(ShaderWatcher const&) -> ShaderWatcher& = delete;
+
+	~ShaderWatcher() {
+		{
+			std::lock_guard lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wake.notify_all();
+		if(this->thread.joinable())
+			this->thread.join();
+	}
+
+	auto watch(std::string const &id, std::string const &path) {
+		{
+			std::lock_guard lock(this->mutex);
+			this->files[id] = File{path, ++this->generations};
+			if(!this->thread.joinable() && this->interval.count() > 0)
+				this->thread = std::thread([this] { this->run(); });
+		}
+		this->wake.notify_all();
+	}
+
+	auto unwatch(std::string const &id) -> bool {
+		std::lock_guard lock(this->mutex);
+		return this->files.erase(id) > 0;
+	}
+
+	// Compiles every file that changed since the last look, returns how many were staged
+	auto poll() -> size_t {
+		std::vector<std::pair<std::string, File>> changed;
+		{
+			std::lock_guard lock(this->mutex);
+			for(auto &[id, file] : this->files) {
+				file.added = false;
+				std::error_code error;
+				auto const time = std::filesystem::last_write_time(file.path, error);
+				auto const size = error ? 0 : std::filesystem::file_size(file.path, error);
+				if(error || (file.time==time && file.size==size))
+					continue;
+				file.time = time;
+				file.size = size;
+				changed.emplace_back(id, file);
+			}
+		}
+		size_t staged = 0;
+		for(auto const &[id, file] : changed) {
+			std::ifstream stream(file.path, std::ios::binary);
+			std::string const source{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+			auto result = this->compile(source, file.path);
+			if(result.spirv.empty()) {
+				std::cout << "Error compiling shader " << id << ", keeping the last good version:\n" << result.log << std::endl;
+				continue;
+			}
+			// Unwatched or watched anew while compiling, an insert already set what the id holds now
+			std::lock_guard lock(this->mutex);
+			auto const current = this->files.find(id);
+			if(current==this->files.end() || current->second.generation != file.generation)
+				continue;
+			if(!this->library->stage(id, std::move(result.spirv))) {
+				std::cout << "Error compiling shader " << id << ", it produced invalid SPIR-V:\n" << result.log << std::endl;
+				continue;
+			}
+			++staged;
+		}
+		if(staged > 0 && this->compiled)
+			this->compiled();
+		return staged;
+	}
+
+private:
+	struct File {
+		std::string path;
+		uint64_t generation = 0; // which watch() this is, a later one for the same id supersedes it
+		std::optional<std::filesystem::file_time_type> time; // as of the last compile
+		uintmax_t size = 0;
+		bool added = true; // not looked at yet, the watcher thread does that right away
+	};
+
+	auto run() -> void {
+		std::unique_lock lock(this->mutex);
+		while(!this->stopping) {
+			lock.unlock();
+			this->poll();
+			lock.lock();
+			this->wake.wait_for(lock, this->interval, [this] {
+				return this->stopping || std::any_of(this->files.begin(), this->files.end(), [](auto const &file) { return file.second.added; });
+			});
+		}
+	}
+
+	std::shared_ptr<ShaderLibrary> library;
+	ShaderCompile compile;
+	std::function<void()> compiled; // wakes the frame loop to commit
+	std::chrono::milliseconds interval;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::map<std::string, File, std::less<>> files;
+	uint64_t generations = 0;
+	bool stopping = false;
+	std::thread thread;
+};
+}
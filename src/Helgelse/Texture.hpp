@@ -0,0 +1,429 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Each set by the build together with the include path and library, see the HELGELSE_WITH_* options in CMakeLists.txt
+#ifdef HELGELSE_WITH_STB_IMAGE
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#endif
+
+#ifdef HELGELSE_WITH_BASISU
+#include <basisu_transcoder.h>
+#endif
+
+#ifdef HELGELSE_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace Helgelse {
+enum struct TextureFormat {
+	RGBA8, RGBA8_SRGB,
+	BC1, BC1_SRGB, BC3, BC3_SRGB, BC4, BC5, BC7, BC7_SRGB,
+	ETC2_RGB8, ETC2_RGB8_SRGB, ETC2_RGBA8, ETC2_RGBA8_SRGB,
+	ASTC_4x4, ASTC_4x4_SRGB,
+	Count
+};
+
+// vkFormat is the VkFormat value, which is also what KTX2 files store
+struct TextureFormatInfo {
+	uint32_t vkFormat = 0;
+	uint32_t blockWidth = 1;
+	uint32_t blockHeight = 1;
+	uint32_t blockBytes = 4;
+	bool srgb = false;
+	bool compressed = false;
+};
+
+inline auto texture_format_info(TextureFormat format) -> TextureFormatInfo {
+	static constexpr TextureFormatInfo table[] {
+		{37, 1, 1, 4, false, false}, {43, 1, 1, 4, true, false},
+		{131, 4, 4, 8, false, true}, {132, 4, 4, 8, true, true}, {137, 4, 4, 16, false, true}, {138, 4, 4, 16, true, true},
+		{139, 4, 4, 8, false, true}, {141, 4, 4, 16, false, true}, {145, 4, 4, 16, false, true}, {146, 4, 4, 16, true, true},
+		{147, 4, 4, 8, false, true}, {148, 4, 4, 8, true, true}, {151, 4, 4, 16, false, true}, {152, 4, 4, 16, true, true},
+		{157, 4, 4, 16, false, true}, {158, 4, 4, 16, true, true},
+	};
+	static_assert(std::size(table)==size_t(TextureFormat::Count));
+	return table[static_cast<size_t>(format)];
+}
+
+inline auto texture_format_from_vk(uint32_t vkFormat) -> std::optional<TextureFormat> {
+	for(size_t i = 0; i < size_t(TextureFormat::Count); ++i)
+		if(texture_format_info(TextureFormat(i)).vkFormat==vkFormat)
+			return TextureFormat(i);
+	return std::nullopt;
+}
+
+inline auto texture_level_size(TextureFormat format, uint32_t width, uint32_t height) -> size_t {
+	auto const info = texture_format_info(format);
+	return size_t((width+info.blockWidth-1)/info.blockWidth)*((height+info.blockHeight-1)/info.blockHeight)*info.blockBytes;
+}
+
+// The formats a device can sample, handed to decoders so they only produce what will upload
+struct TextureFormats {
+	auto add(TextureFormat format) -> TextureFormats& {
+		this->bits |= 1u << static_cast<uint32_t>(format);
+		return *this;
+	}
+	auto has(TextureFormat format) const -> bool { return (this->bits >> static_cast<uint32_t>(format)) & 1u; }
+	auto operator==(TextureFormats const&) const -> bool = default;
+
+	// Every device samples these, also all that's known before a device exists
+	static auto uncompressed() -> TextureFormats { return TextureFormats{}.add(TextureFormat::RGBA8).add(TextureFormat::RGBA8_SRGB); }
+
+	uint32_t bits = 0;
+};
+
+/*
+Where a Basis Universal texture goes on this device: ASTC and BC7 keep nearly all of
+the quality in 1 byte per texel, ETC2 and BC1/BC3 trade some of it for wide support,
+RGBA8 is the last resort at 4 bytes per texel.
+*/
+inline auto texture_transcode_target(TextureFormats const &supported, bool alpha, bool srgb) -> TextureFormat {
+	auto const pick = [&](TextureFormat linear, TextureFormat encoded) { return srgb ? encoded : linear; };
+	for(auto const format : {pick(TextureFormat::ASTC_4x4, TextureFormat::ASTC_4x4_SRGB), pick(TextureFormat::BC7, TextureFormat::BC7_SRGB),
+							 alpha ? pick(TextureFormat::ETC2_RGBA8, TextureFormat::ETC2_RGBA8_SRGB) : pick(TextureFormat::ETC2_RGB8, TextureFormat::ETC2_RGB8_SRGB),
+							 alpha ? pick(TextureFormat::BC3, TextureFormat::BC3_SRGB) : pick(TextureFormat::BC1, TextureFormat::BC1_SRGB)})
+		if(supported.has(format))
+			return format;
+	return pick(TextureFormat::RGBA8, TextureFormat::RGBA8_SRGB);
+}
+
+struct TextureLevel {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	size_t offset = 0; // into TextureData::bytes
+	size_t size = 0;
+};
+
+// Decoded pixels or blocks of every mip level in one allocation, level 0 is the full size
+struct TextureData {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	TextureFormat format = TextureFormat::RGBA8;
+	std::vector<TextureLevel> levels;
+	std::vector<uint8_t> bytes;
+	uint32_t firstLevel = 0; // levels of the full texture dropped from the top, levels[0] is that one
+	bool transcoded = false; // the format was picked from the supported ones, a different device may get a better one
+};
+
+inline auto texture_level_count(uint32_t width, uint32_t height) -> uint32_t {
+	uint32_t count = 1;
+	while(std::max(width, height) >> count)
+		++count;
+	return count;
+}
+
+// The most detailed level whose larger side fits in size texels
+inline auto texture_level_fitting(uint32_t width, uint32_t height, uint32_t size) -> uint32_t {
+	uint32_t level = 0;
+	while(std::max(width, height) >> level > size)
+		++level;
+	return level;
+}
+
+/*
+The most detailed level worth having for a texture covering screenWidth x screenHeight
+pixels: each level halves the texels, a level with fewer texels than pixels would blur.
+*/
+inline auto texture_wanted_level(uint32_t width, uint32_t height, uint32_t screenWidth, uint32_t screenHeight) -> uint32_t {
+	uint32_t level = 0;
+	while((width >> (level+1)) >= std::max(1u, screenWidth) && (height >> (level+1)) >= std::max(1u, screenHeight))
+		++level;
+	return level;
+}
+
+// Keeps the levels from first down, what a streamed texture uploads instead of the whole chain
+inline auto texture_drop_levels(TextureData &texture, uint32_t first) {
+	first = std::min<uint32_t>(first, texture.levels.empty() ? 0 : texture.levels.size()-1);
+	if(first==0)
+		return;
+	auto const offset = texture.levels[first].offset;
+	texture.bytes.erase(texture.bytes.begin(), texture.bytes.begin()+offset);
+	texture.levels.erase(texture.levels.begin(), texture.levels.begin()+first);
+	for(auto &level : texture.levels)
+		level.offset -= offset;
+	texture.width	   = texture.levels[0].width;
+	texture.height	   = texture.levels[0].height;
+	texture.firstLevel += first;
+}
+
+/*
+Fills in every level below the first with a 2x2 box filter, odd edges repeat their last
+texel. sRGB texels are averaged in linear space, averaging the encoded values would
+darken every level a little more.
+*/
+inline auto texture_generate_mips(TextureData &texture) -> bool {
+	if(texture.levels.empty() || texture_format_info(texture.format).compressed)
+		return false;
+	auto const srgb = texture.format==TextureFormat::RGBA8_SRGB;
+	static auto const toLinear = [] {
+		std::array<float, 256> table{};
+		for(int i = 0; i < 256; ++i) {
+			auto const c = i/255.0f;
+			table[i] = c <= 0.04045f ? c/12.92f : std::pow((c+0.055f)/1.055f, 2.4f);
+		}
+		return table;
+	}();
+	auto const toEncoded = [](float linear) -> uint8_t {
+		auto const c = linear <= 0.0031308f ? linear*12.92f : 1.055f*std::pow(linear, 1.0f/2.4f)-0.055f;
+		return static_cast<uint8_t>(std::clamp(c*255.0f+0.5f, 0.0f, 255.0f));
+	};
+
+	texture.levels.resize(1);
+	auto const count = texture_level_count(texture.width, texture.height);
+	size_t total = texture.levels[0].size;
+	for(uint32_t level = 1; level < count; ++level) {
+		auto const width  = std::max(1u, texture.width >> level);
+		auto const height = std::max(1u, texture.height >> level);
+		texture.levels.push_back(TextureLevel{width, height, total, texture_level_size(texture.format, width, height)});
+		total += texture.levels.back().size;
+	}
+	texture.bytes.resize(total);
+
+	for(uint32_t level = 1; level < count; ++level) {
+		auto const &source = texture.levels[level-1];
+		auto const &target = texture.levels[level];
+		auto const *in = texture.bytes.data()+source.offset;
+		auto *out	   = texture.bytes.data()+target.offset;
+		for(uint32_t y = 0; y < target.height; ++y)
+			for(uint32_t x = 0; x < target.width; ++x) {
+				uint32_t const x0 = std::min(2*x, source.width-1), x1 = std::min(2*x+1, source.width-1);
+				uint32_t const y0 = std::min(2*y, source.height-1), y1 = std::min(2*y+1, source.height-1);
+				for(int c = 0; c < 4; ++c) {
+					auto const texel = [&](uint32_t sx, uint32_t sy) { return in[(size_t(sy)*source.width+sx)*4+c]; };
+					// Alpha is linear in both formats
+					if(srgb && c < 3) {
+						auto const sum = toLinear[texel(x0, y0)]+toLinear[texel(x1, y0)]+toLinear[texel(x0, y1)]+toLinear[texel(x1, y1)];
+						out[(size_t(y)*target.width+x)*4+c] = toEncoded(sum/4.0f);
+					}
+					else
+						out[(size_t(y)*target.width+x)*4+c] = static_cast<uint8_t>((texel(x0, y0)+texel(x1, y0)+texel(x0, y1)+texel(x1, y1)+2)/4);
+				}
+			}
+	}
+	return true;
+}
+
+namespace ktx2 {
+constexpr std::array<uint8_t, 12> Identifier{0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr size_t HeaderSize = 80; // identifier, nine uint32 header fields and the data format, key/value and supercompression index
+constexpr uint32_t VkFormatRGBA8Unorm = 37;
+constexpr uint32_t VkFormatRGBA8Srgb = 43;
+
+inline auto read32(std::span<uint8_t const> bytes, size_t offset) -> uint32_t {
+	uint32_t value = 0;
+	std::memcpy(&value, bytes.data()+offset, 4);
+	return value;
+}
+
+inline auto read64(std::span<uint8_t const> bytes, size_t offset) -> uint64_t {
+	uint64_t value = 0;
+	std::memcpy(&value, bytes.data()+offset, 8);
+	return value;
+}
+
+constexpr uint32_t SupercompressionNone = 0;
+constexpr uint32_t SupercompressionBasisLZ = 1;
+constexpr uint32_t SupercompressionZstd = 2;
+}
+
+#ifdef HELGELSE_WITH_BASISU
+/*
+Basis Universal payloads (ETC1S or UASTC) are transcoded on the worker to whatever the
+device samples best, so the upload is already in the GPU's own block format.
+*/
+inline auto texture_transcode_basis(std::span<uint8_t const> bytes, TextureFormats const &supported) -> std::optional<TextureData> {
+	static bool const initialized = [] { basist::basisu_transcoder_init(); return true; }();
+	(void)initialized;
+	basist::ktx2_transcoder transcoder;
+	if(!transcoder.init(bytes.data(), static_cast<uint32_t>(bytes.size())) || !transcoder.start_transcoding())
+		return std::nullopt;
+
+	TextureData texture;
+	texture.width	   = transcoder.get_width();
+	texture.height	   = transcoder.get_height();
+	texture.format	   = texture_transcode_target(supported, transcoder.get_has_alpha(), transcoder.get_dfd_transfer_func()==basist::KTX2_KHR_DF_TRANSFER_SRGB);
+	texture.transcoded = true;
+	auto const target = [&] {
+		switch(texture.format) {
+			case TextureFormat::ASTC_4x4: case TextureFormat::ASTC_4x4_SRGB: return basist::transcoder_texture_format::cTFASTC_4x4_RGBA;
+			case TextureFormat::BC7: case TextureFormat::BC7_SRGB: return basist::transcoder_texture_format::cTFBC7_RGBA;
+			case TextureFormat::ETC2_RGBA8: case TextureFormat::ETC2_RGBA8_SRGB: return basist::transcoder_texture_format::cTFETC2_RGBA;
+			case TextureFormat::ETC2_RGB8: case TextureFormat::ETC2_RGB8_SRGB: return basist::transcoder_texture_format::cTFETC1_RGB; // ETC1 is a subset of ETC2
+			case TextureFormat::BC3: case TextureFormat::BC3_SRGB: return basist::transcoder_texture_format::cTFBC3_RGBA;
+			case TextureFormat::BC1: case TextureFormat::BC1_SRGB: return basist::transcoder_texture_format::cTFBC1_RGB;
+			default: return basist::transcoder_texture_format::cTFRGBA32;
+		}
+	}();
+	auto const info = texture_format_info(texture.format);
+	for(uint32_t level = 0; level < transcoder.get_levels(); ++level) {
+		basist::ktx2_image_level_info level_info;
+		if(!transcoder.get_image_level_info(level_info, level, 0, 0))
+			return std::nullopt;
+		auto const size = texture_level_size(texture.format, level_info.m_orig_width, level_info.m_orig_height);
+		texture.levels.push_back(TextureLevel{level_info.m_orig_width, level_info.m_orig_height, texture.bytes.size(), size});
+		texture.bytes.resize(texture.bytes.size()+size);
+		// The output size is counted in blocks for block formats and in pixels for RGBA32
+		auto const units = static_cast<uint32_t>(info.compressed ? size/info.blockBytes : size/4);
+		if(!transcoder.transcode_image_level(level, 0, 0, texture.bytes.data()+texture.levels.back().offset, units, target))
+			return std::nullopt;
+	}
+	if(texture.levels.size()==1)
+		texture_generate_mips(texture);
+	return texture;
+}
+#endif
+
+/*
+KTX2 2D textures. Levels stored in any format the device samples go up as they are,
+BCn, ETC2 and ASTC included, Zstd supercompressed ones with HELGELSE_WITH_ZSTD. The
+file orders levels by size and pads them, they are repacked from the largest down. A
+level count of 0 asks for generated mips, which only works for uncompressed formats.
+Basis Universal files (VK_FORMAT_UNDEFINED) are transcoded with HELGELSE_WITH_BASISU.
+*/
+inline auto texture_decode_ktx2(std::span<uint8_t const> bytes, TextureFormats const &supported) -> std::optional<TextureData> {
+	if(bytes.size() < ktx2::HeaderSize || !std::equal(ktx2::Identifier.begin(), ktx2::Identifier.end(), bytes.begin()))
+		return std::nullopt;
+	auto const vkFormat			= ktx2::read32(bytes, 12);
+	auto const width			= ktx2::read32(bytes, 20);
+	auto const height			= ktx2::read32(bytes, 24);
+	auto const depth			= ktx2::read32(bytes, 28);
+	auto const layers			= ktx2::read32(bytes, 32);
+	auto const faces			= ktx2::read32(bytes, 36);
+	auto const levelCount		= ktx2::read32(bytes, 40);
+	auto const supercompression = ktx2::read32(bytes, 44);
+	// 2D textures only, no arrays or cubes
+	if(width==0 || height==0 || depth > 1 || layers > 1 || faces != 1)
+		return std::nullopt;
+	if(vkFormat==0 || supercompression==ktx2::SupercompressionBasisLZ) {
+#ifdef HELGELSE_WITH_BASISU
+		return texture_transcode_basis(bytes, supported);
+#else
+		return std::nullopt;
+#endif
+	}
+#ifdef HELGELSE_WITH_ZSTD
+	if(supercompression != ktx2::SupercompressionNone && supercompression != ktx2::SupercompressionZstd)
+		return std::nullopt;
+#else
+	if(supercompression != ktx2::SupercompressionNone)
+		return std::nullopt;
+#endif
+
+	auto const format = texture_format_from_vk(vkFormat);
+	if(!format || !supported.has(*format))
+		return std::nullopt;
+	TextureData texture;
+	texture.width  = width;
+	texture.height = height;
+	texture.format = *format;
+
+	auto const stored = std::max(1u, levelCount);
+	if(stored > texture_level_count(width, height) || bytes.size() < ktx2::HeaderSize+size_t(stored)*24)
+		return std::nullopt;
+	for(uint32_t level = 0; level < stored; ++level) {
+		auto const offset	   = ktx2::read64(bytes, ktx2::HeaderSize+level*24);
+		auto const length	   = ktx2::read64(bytes, ktx2::HeaderSize+level*24+8);
+		auto const levelWidth  = std::max(1u, width >> level);
+		auto const levelHeight = std::max(1u, height >> level);
+		auto const expected	   = texture_level_size(texture.format, levelWidth, levelHeight);
+		if(offset > bytes.size() || bytes.size()-offset < length)
+			return std::nullopt;
+		texture.levels.push_back(TextureLevel{levelWidth, levelHeight, texture.bytes.size(), expected});
+#ifdef HELGELSE_WITH_ZSTD
+		if(supercompression==ktx2::SupercompressionZstd) {
+			texture.bytes.resize(texture.bytes.size()+expected);
+			auto const written = ZSTD_decompress(texture.bytes.data()+texture.levels.back().offset, expected, bytes.data()+offset, length);
+			if(ZSTD_isError(written) || written != expected)
+				return std::nullopt;
+			continue;
+		}
+#endif
+		if(length < expected)
+			return std::nullopt;
+		texture.bytes.insert(texture.bytes.end(), bytes.begin()+offset, bytes.begin()+offset+expected);
+	}
+	if(levelCount==0)
+		texture_generate_mips(texture);
+	return texture;
+}
+
+#ifdef HELGELSE_WITH_STB_IMAGE
+// PNG, JPEG and whatever else stb_image reads, always expanded to RGBA and treated as sRGB color
+inline auto texture_decode_stb(std::span<uint8_t const> bytes, TextureFormats const&) -> std::optional<TextureData> {
+	int width = 0, height = 0, channels = 0;
+	auto *pixels = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, &channels, 4);
+	if(!pixels)
+		return std::nullopt;
+	TextureData texture;
+	texture.width  = static_cast<uint32_t>(width);
+	texture.height = static_cast<uint32_t>(height);
+	texture.format = TextureFormat::RGBA8_SRGB;
+	texture.bytes.assign(pixels, pixels+size_t(width)*height*4);
+	texture.levels.push_back(TextureLevel{texture.width, texture.height, 0, texture.bytes.size()});
+	stbi_image_free(pixels);
+	texture_generate_mips(texture);
+	return texture;
+}
+#endif
+
+/*
+Decoders are picked by the magic bytes at the start of the file, not by its extension.
+KTX2 is always available, PNG and JPEG when built with HELGELSE_WITH_STB_IMAGE, more
+can be added for formats the space doesn't know. Each gets the formats the device can
+sample and must only produce one of them.
+*/
+struct TextureDecoders {
+	using Decoder = std::function<std::optional<TextureData>(std::span<uint8_t const>, TextureFormats const&)>;
+
+	auto add(std::vector<uint8_t> magic, Decoder decoder) -> TextureDecoders& {
+		this->decoders.emplace_back(std::move(magic), std::move(decoder));
+		return *this;
+	}
+
+	auto decode(std::span<uint8_t const> bytes, TextureFormats const &supported=TextureFormats::uncompressed()) const -> std::optional<TextureData> {
+		for(auto const &[magic, decoder] : this->decoders)
+			if(bytes.size() >= magic.size() && std::equal(magic.begin(), magic.end(), bytes.begin()))
+				return decoder(bytes, supported);
+		return std::nullopt;
+	}
+
+	auto supports(std::span<uint8_t const> bytes) const -> bool {
+		return std::any_of(this->decoders.begin(), this->decoders.end(), [bytes](auto const &entry) {
+			return bytes.size() >= entry.first.size() && std::equal(entry.first.begin(), entry.first.end(), bytes.begin());
+		});
+	}
+
+private:
+	std::vector<std::pair<std::vector<uint8_t>, Decoder>> decoders;
+};
+
+inline auto texture_default_decoders() -> TextureDecoders {
+	TextureDecoders decoders;
+	decoders.add({ktx2::Identifier.begin(), ktx2::Identifier.end()}, texture_decode_ktx2);
+#ifdef HELGELSE_WITH_STB_IMAGE
+	decoders.add({0x89, 'P', 'N', 'G'}, texture_decode_stb);
+	decoders.add({0xFF, 0xD8, 0xFF}, texture_decode_stb);
+#endif
+	return decoders;
+}
+
+inline auto texture_read_file(std::string const &path) -> std::optional<std::vector<uint8_t>> {
+	std::ifstream file(path, std::ios::binary);
+	if(!file)
+		return std::nullopt;
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+}
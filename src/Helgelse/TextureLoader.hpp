@@ -0,0 +1,336 @@
+#pragma once
+#include "Helgelse/Texture.hpp"
+#include "Helgelse/WorkerPool.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+enum struct TextureState { Loading, Uploading, Resident, Failed };
+
+// What read("/graphics/textures/<name>") returns, a blocking read only returns once the texture is resident or failed
+struct TextureInfo {
+	TextureState state = TextureState::Loading;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipLevels = 0;
+	TextureFormat format = TextureFormat::RGBA8;
+	uint32_t residentLevel = 0; // most detailed level on the GPU, streaming moves it while the texture stays resident
+};
+
+// Inserted at "/graphics/textures/<name>" each frame the texture is drawn, roughly how many pixels it covers on screen
+struct TextureUsage {
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Handed from the workers to the frame loop, which owns the device and does the upload
+struct DecodedTexture {
+	std::string name;
+	uint64_t generation = 0;
+	TextureData data;
+};
+
+/*
+Tracks every texture inserted into the space from its file path to residency. Reading
+and decoding run on the worker pool, so insert returns right away. Decoded textures wait
+for the frame loop to take them, which uploads them and reports back. Inserting the same
+name again supersedes whatever is still in flight: each load gets a generation and only
+the newest one is allowed to reach residency.
+
+Textures stream by mip level. The first load only uploads the levels up to TailSize, so
+something shows within a frame or two, then the chain grows to full size. Once usage is
+reported for a texture it only gets the levels its on-screen size needs, and falls back
+to its tail when it hasn't been drawn for UnusedFrames or its memory is evicted. A level
+change is just another load, the image on the GPU is replaced once the new one is up.
+*/
+struct TextureLoader {
+	static constexpr uint32_t TailSize = 64;
+	static constexpr uint64_t UnusedFrames = 120;
+	static constexpr size_t StreamingLoads = 8; // level changes in flight at once, inserts aren't limited
+
+	explicit TextureLoader(TextureDecoders decoders=texture_default_decoders(), std::function<void()> decoded={}, size_t threads=0)
+		: state(std::make_shared<Shared>()), pool(threads) {
+		this->state->decoders = std::move(decoders);
+		this->state->decoded  = std::move(decoded);
+	}
+
+	auto load(std::string const &name, std::string const &path) -> uint64_t {
+		uint64_t generation = 0;
+		{
+			std::lock_guard lock(this->state->mutex);
+			auto &entry		 = this->state->entries[name];
+			entry			 = Entry{path};
+			entry.generation = ++this->state->generations;
+			entry.loading	 = true;
+			generation		 = entry.generation;
+		}
+		this->submit(name, path, generation, std::nullopt);
+		return generation;
+	}
+
+	// Everything decoded since the last call that hasn't been superseded
+	auto takeDecoded() -> std::vector<DecodedTexture> {
+		std::lock_guard lock(this->state->mutex);
+		std::vector<DecodedTexture> decoded;
+		for(auto &texture : this->state->ready)
+			if(auto const it = this->state->entries.find(texture.name); it != this->state->entries.end() && it->second.generation==texture.generation)
+				decoded.push_back(std::move(texture));
+		this->state->ready.clear();
+		return decoded;
+	}
+
+	// Blocks until every read and decode started so far is done, what they produced waits in takeDecoded
+	auto drain() {
+		this->pool.drain();
+	}
+
+	// Returns false when the load was superseded meanwhile, the caller should drop what it uploaded
+	auto uploaded(std::string const &name, uint64_t generation, bool succeeded) -> bool {
+		{
+			std::lock_guard lock(this->state->mutex);
+			auto const it = this->state->entries.find(name);
+			if(it==this->state->entries.end() || it->second.generation != generation)
+				return false;
+			auto &entry	  = it->second;
+			entry.loading = false;
+			if(succeeded) {
+				entry.info.state		 = TextureState::Resident;
+				entry.info.residentLevel = entry.loadingLevel;
+			}
+			// A level change that didn't make it leaves the texture resident as it was
+			else if(entry.info.state != TextureState::Resident)
+				entry.info.state = TextureState::Failed;
+		}
+		this->state->changed.notify_all();
+		return succeeded;
+	}
+
+	auto remove(std::string const &name) -> bool {
+		{
+			std::lock_guard lock(this->state->mutex);
+			if(this->state->entries.erase(name)==0)
+				return false;
+			this->state->removed.push_back(name);
+		}
+		this->state->changed.notify_all();
+		return true;
+	}
+
+	// Removed since the last call, the frame loop frees what it uploaded for them
+	auto takeRemoved() -> std::vector<std::string> {
+		std::lock_guard lock(this->state->mutex);
+		return std::exchange(this->state->removed, {});
+	}
+
+	auto info(std::string_view name) -> std::optional<TextureInfo> {
+		std::lock_guard lock(this->state->mutex);
+		auto const it = this->state->entries.find(name);
+		if(it==this->state->entries.end())
+			return std::nullopt;
+		return it->second.info;
+	}
+
+	// Feedback from drawing, several reports in one frame keep the largest
+	auto used(std::string_view name, TextureUsage usage) -> bool {
+		std::lock_guard lock(this->state->mutex);
+		auto const it = this->state->entries.find(name);
+		if(it==this->state->entries.end())
+			return false;
+		auto &entry		  = it->second;
+		auto const wanted = std::min(texture_wanted_level(entry.info.width, entry.info.height, usage.width, usage.height), std::max(1u, entry.info.mipLevels)-1);
+		entry.wanted	  = entry.streamed && entry.lastUsed==this->state->frame ? std::min(entry.wanted, wanted) : wanted;
+		entry.lastUsed	  = this->state->frame;
+		entry.streamed	  = true;
+		entry.evicted	  = false;
+		return true;
+	}
+
+	// The memory of the texture is needed elsewhere, it drops to its tail until it is used again
+	auto evict(std::string const &name) {
+		std::lock_guard lock(this->state->mutex);
+		if(auto const it = this->state->entries.find(name); it != this->state->entries.end())
+			it->second.evicted = true;
+	}
+
+	/*
+	Called once per frame by the frame loop: starts the level changes the last frame's
+	usage asks for, those freeing memory first, then upgrades of the most recently used.
+	Returns the textures used since the last call.
+	*/
+	auto stream() -> std::vector<std::string> {
+		std::vector<std::string> used;
+		std::vector<std::tuple<std::string, std::string, uint64_t, uint32_t>> changes;
+		{
+			std::lock_guard lock(this->state->mutex);
+			auto const frame = this->state->frame++;
+			size_t inFlight = 0;
+			std::vector<std::tuple<bool, uint64_t, Entry*, std::string const*>> candidates;
+			for(auto &[name, entry] : this->state->entries) {
+				if(entry.streamed && entry.lastUsed==frame)
+					used.push_back(name);
+				if(entry.loading)
+					++inFlight;
+				else if(entry.info.state==TextureState::Resident) {
+					auto const target = this->target(entry, frame);
+					if(target != entry.info.residentLevel)
+						candidates.emplace_back(target < entry.info.residentLevel, ~entry.lastUsed, &entry, &name);
+				}
+			}
+			std::sort(candidates.begin(), candidates.end(), [](auto const &a, auto const &b) { return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b)); });
+			for(auto const &[upgrade, recency, entry, name] : candidates) {
+				if(inFlight++ >= StreamingLoads)
+					break;
+				entry->generation = ++this->state->generations;
+				entry->loading	  = true;
+				changes.emplace_back(*name, entry->path, entry->generation, this->target(*entry, frame));
+			}
+		}
+		for(auto const &[name, path, generation, level] : changes)
+			this->submit(name, path, generation, level);
+		return used;
+	}
+
+	// Blocks until the texture is resident or failed, nullopt when it doesn't exist or is removed meanwhile
+	auto wait(std::string_view name, std::chrono::steady_clock::duration timeout=std::chrono::hours(24)) -> std::optional<TextureInfo> {
+		std::unique_lock lock(this->state->mutex);
+		std::optional<TextureInfo> info;
+		this->state->changed.wait_for(lock, timeout, [&] {
+			auto const it = this->state->entries.find(name);
+			if(it==this->state->entries.end()) {
+				info.reset();
+				return true;
+			}
+			info = it->second.info;
+			return info->state==TextureState::Resident || info->state==TextureState::Failed;
+		});
+		return info;
+	}
+
+	// Loads everything again from the paths it came from, e.g. after the device holding the textures was lost
+	auto reloadAll() {
+		this->reload([](Entry const&) { return true; });
+	}
+
+	/*
+	The formats the device samples, decoders only produce these. Textures that were
+	transcoded for the previous set (or before any device existed) are loaded again,
+	the new device may take a smaller or better format.
+	*/
+	auto setSupportedFormats(TextureFormats supported) {
+		{
+			std::lock_guard lock(this->state->mutex);
+			if(this->state->supported==supported)
+				return;
+			this->state->supported = supported;
+		}
+		this->reload([](Entry const &entry) { return entry.transcoded; });
+	}
+
+private:
+	struct Entry {
+		std::string path;
+		uint64_t generation = 0;
+		TextureInfo info;
+		bool transcoded = false;
+		bool loading = false;
+		uint32_t loadingLevel = 0; // first level of the load in flight
+		// Streaming, from the usage reports
+		uint32_t wanted = 0;
+		uint64_t lastUsed = 0;
+		bool streamed = false; // usage was reported, before that the texture goes to full size
+		bool evicted = false;
+	};
+
+	// Starts over from the tail like an insert, but keeps what usage was reported
+	auto reload(std::function<bool(Entry const&)> const &which) -> void {
+		std::vector<std::tuple<std::string, std::string, uint64_t>> loads;
+		{
+			std::lock_guard lock(this->state->mutex);
+			for(auto &[name, entry] : this->state->entries)
+				if(which(entry)) {
+					entry.generation = ++this->state->generations;
+					entry.loading	 = true;
+					entry.info		 = TextureInfo{};
+					loads.emplace_back(name, entry.path, entry.generation);
+				}
+		}
+		for(auto const &[name, path, generation] : loads)
+			this->submit(name, path, generation, std::nullopt);
+	}
+
+	// Where streaming takes the texture next, used textures only drop levels once they need a quarter of the texels
+	auto target(Entry const &entry, uint64_t frame) const -> uint32_t {
+		auto const tail = std::min(texture_level_fitting(entry.info.width, entry.info.height, TailSize), std::max(1u, entry.info.mipLevels)-1);
+		if(entry.evicted || (entry.streamed && frame-entry.lastUsed > UnusedFrames))
+			return std::max(entry.wanted, tail);
+		if(!entry.streamed)
+			return 0;
+		auto const resident = entry.info.residentLevel;
+		return entry.wanted >= resident+2 ? entry.wanted : std::min(entry.wanted, resident);
+	}
+
+	// The job only holds the shared state, it may outlive the loader while the pool shuts down
+	auto submit(std::string const &name, std::string const &path, uint64_t generation, std::optional<uint32_t> firstLevel) -> void {
+		this->pool.submit([state = this->state, name, path, generation, firstLevel] {
+			auto const supported = [&] { std::lock_guard lock(state->mutex); return state->supported; }();
+			auto const bytes	 = texture_read_file(path);
+			auto texture		 = bytes ? state->decoders.decode(*bytes, supported) : std::nullopt;
+			{
+				std::lock_guard lock(state->mutex);
+				auto const it = state->entries.find(name);
+				if(it==state->entries.end() || it->second.generation != generation)
+					return;
+				auto &entry = it->second;
+				if(!texture) {
+					std::cout << "Error loading texture " << name << " from " << path << (bytes ? ": unsupported or corrupt file" : ": can't read file") << std::endl;
+					entry.loading = false;
+					if(entry.info.state != TextureState::Resident)
+						entry.info.state = TextureState::Failed;
+				}
+				else {
+					auto const levels = static_cast<uint32_t>(texture->levels.size());
+					auto const first  = std::min(firstLevel.value_or(texture_level_fitting(texture->width, texture->height, TailSize)), levels-1);
+					auto const resident = entry.info.state==TextureState::Resident;
+					entry.info		 = TextureInfo{resident ? TextureState::Resident : TextureState::Uploading, texture->width, texture->height, levels, texture->format,
+												   resident ? entry.info.residentLevel : first};
+					entry.loadingLevel = first;
+					entry.transcoded = texture->transcoded;
+					texture_drop_levels(*texture, first);
+					state->ready.push_back(DecodedTexture{name, generation, std::move(*texture)});
+				}
+			}
+			state->changed.notify_all();
+			if(texture && state->decoded)
+				state->decoded();
+		});
+	}
+
+	struct Shared {
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::map<std::string, Entry, std::less<>> entries;
+		std::vector<DecodedTexture> ready;
+		std::vector<std::string> removed;
+		uint64_t generations = 0;
+		TextureDecoders decoders;
+		TextureFormats supported = TextureFormats::uncompressed();
+		uint64_t frame = 0;
+		std::function<void()> decoded; // wakes the frame loop
+	};
+
+	std::shared_ptr<Shared> state;
+	WorkerPool pool; // declared last, its destructor joins the workers before the rest goes away
+};
+}
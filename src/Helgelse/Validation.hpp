@@ -0,0 +1,38 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Helgelse {
+enum struct Validation {
+	None,			 // no layers, no debug extensions, nothing loaded
+	Standard,		 // Khronos validation layer with debug utils messages, object names and labels
+	Synchronization, // plus synchronization validation
+	GPUAssisted		 // plus GPU-assisted validation of shader accesses
+};
+}
+
+inline auto validation_from_string(std::string_view text) -> std::optional<Helgelse::Validation> {
+	std::string name(text);
+	std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+	if(name=="none" || name=="off" || name=="0")
+		return Helgelse::Validation::None;
+	if(name=="validation" || name=="standard" || name=="on" || name=="1")
+		return Helgelse::Validation::Standard;
+	if(name=="sync" || name=="synchronization")
+		return Helgelse::Validation::Synchronization;
+	if(name=="gpu" || name=="gpu-assisted")
+		return Helgelse::Validation::GPUAssisted;
+	return std::nullopt;
+}
+
+// HELGELSE_VALIDATION overrides what the program asked for, so a repro can turn validation on without a rebuild
+inline auto validation_from_environment(Helgelse::Validation requested) -> Helgelse::Validation {
+	if(auto const value = std::getenv("HELGELSE_VALIDATION"))
+		if(auto const validation = validation_from_string(value))
+			return *validation;
+	return requested;
+}
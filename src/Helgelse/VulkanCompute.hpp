@@ -0,0 +1,338 @@
+#pragma once
+#include "Helgelse/Compute.hpp"
+#include "Helgelse/PipelineCache.hpp"
+#include "Helgelse/Shader.hpp"
+#include "Helgelse/VulkanContext.hpp"
+
+#include <magic_enum.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+// Built per shader and buffer count, owned by the space's pipeline cache
+struct VulkanComputePipeline {
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+};
+
+// The buffers are host visible, results are read straight from them once the timeline says the dispatch is done
+struct VulkanComputeJob {
+	struct Buffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void *mapped = nullptr;
+		VkDeviceSize size = 0;
+	};
+	std::vector<Buffer> buffers;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	uint64_t value = 0; // compute timeline value signaled once the dispatch is done, or right away when it failed
+	bool failed = false;
+};
+
+struct VulkanCompute {
+	// Evicted from the cache while frames and jobs up to the values may still use it
+	struct StalePipeline {
+		uint64_t frameValue = 0;
+		uint64_t jobValue = 0;
+		VulkanComputePipeline pipeline;
+	};
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<StalePipeline> stale;
+};
+}
+
+auto vulkan_destroy_compute_pipeline(auto const &context, Helgelse::VulkanComputePipeline &pipeline) {
+	if(pipeline.pipeline != VK_NULL_HANDLE)
+		vkDestroyPipeline(context.device, pipeline.pipeline, nullptr);
+	if(pipeline.layout != VK_NULL_HANDLE)
+		vkDestroyPipelineLayout(context.device, pipeline.layout, nullptr);
+	if(pipeline.setLayout != VK_NULL_HANDLE)
+		vkDestroyDescriptorSetLayout(context.device, pipeline.setLayout, nullptr);
+	pipeline = Helgelse::VulkanComputePipeline{};
+}
+
+// Buffers go to bindings 0..count-1 of set 0, push constants take the whole guaranteed range
+auto vulkan_create_compute_pipeline(auto const &context, Helgelse::Shader const &shader, size_t bufferCount, std::string const &name) -> std::optional<Helgelse::VulkanComputePipeline> {
+	Helgelse::VulkanComputePipeline pipeline;
+	std::vector<VkDescriptorSetLayoutBinding> bindings(bufferCount);
+	for(uint32_t i = 0; i < bindings.size(); ++i) {
+		bindings[i].binding			= i;
+		bindings[i].descriptorType	= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags		= VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo set_layout_create_info{};
+	set_layout_create_info.sType		= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set_layout_create_info.bindingCount = bindings.size();
+	set_layout_create_info.pBindings	= bindings.data();
+	if(auto const result = vkCreateDescriptorSetLayout(context.device, &set_layout_create_info, nullptr, &pipeline.setLayout); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateDescriptorSetLayout: " << magic_enum::enum_name(result) << std::endl;
+		return std::nullopt;
+	}
+
+	VkPushConstantRange push_constants{VK_SHADER_STAGE_COMPUTE_BIT, 0, Helgelse::ComputePushConstantBytes};
+	VkPipelineLayoutCreateInfo layout_create_info{};
+	layout_create_info.sType				  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layout_create_info.setLayoutCount		  = 1;
+	layout_create_info.pSetLayouts			  = &pipeline.setLayout;
+	layout_create_info.pushConstantRangeCount = 1;
+	layout_create_info.pPushConstantRanges	  = &push_constants;
+	if(auto const result = vkCreatePipelineLayout(context.device, &layout_create_info, nullptr, &pipeline.layout); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreatePipelineLayout: " << magic_enum::enum_name(result) << std::endl;
+		vulkan_destroy_compute_pipeline(context, pipeline);
+		return std::nullopt;
+	}
+
+	// The module is only needed while the pipeline is created
+	VkShaderModuleCreateInfo module_create_info{};
+	module_create_info.sType	= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	module_create_info.codeSize = shader.spirv.size()*sizeof(uint32_t);
+	module_create_info.pCode	= shader.spirv.data();
+	VkShaderModule module = VK_NULL_HANDLE;
+	if(auto const result = vkCreateShaderModule(context.device, &module_create_info, nullptr, &module); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateShaderModule: " << magic_enum::enum_name(result) << std::endl;
+		vulkan_destroy_compute_pipeline(context, pipeline);
+		return std::nullopt;
+	}
+	VkComputePipelineCreateInfo pipeline_create_info{};
+	pipeline_create_info.sType		  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeline_create_info.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeline_create_info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeline_create_info.stage.module = module;
+	pipeline_create_info.stage.pName  = "main";
+	pipeline_create_info.layout		  = pipeline.layout;
+	auto const result = vkCreateComputePipelines(context.device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &pipeline.pipeline);
+	vkDestroyShaderModule(context.device, module, nullptr);
+	if(result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateComputePipelines: " << magic_enum::enum_name(result) << std::endl;
+		vulkan_destroy_compute_pipeline(context, pipeline);
+		return std::nullopt;
+	}
+	vulkan_name_object(context, VK_OBJECT_TYPE_PIPELINE, pipeline.pipeline, name.c_str());
+	return pipeline;
+}
+
+// The shared pipeline for the shader once it's built, nullptr while it builds or when the build failed
+auto vulkan_cached_compute_pipeline(auto const &context, Helgelse::PipelineCache<Helgelse::VulkanComputePipeline> &cache, Helgelse::Shader const &shader,
+									size_t bufferCount, std::string const &name) -> Helgelse::VulkanComputePipeline const* {
+	return cache.get(Helgelse::compute_pipeline_description(shader, bufferCount), [context, shader, bufferCount, name] {
+		return vulkan_create_compute_pipeline(context, shader, bufferCount, name);
+	});
+}
+
+// The pipeline for the shader as it is now, nullptr until it's built
+auto vulkan_compute_pipeline(auto const &context, Helgelse::PipelineCache<Helgelse::VulkanComputePipeline> &cache, Helgelse::ShaderLibrary const &shaders,
+							 std::string const &id, size_t bufferCount) -> Helgelse::VulkanComputePipeline const* {
+	auto const shader = shaders.get(id);
+	if(!shader)
+		return nullptr;
+	return vulkan_cached_compute_pipeline(context, cache, *shader, bufferCount, id);
+}
+
+// True while the job's pipeline is being built, submitting it now would fail it for no reason
+auto vulkan_compute_job_waiting(auto const &context, Helgelse::PipelineCache<Helgelse::VulkanComputePipeline> &cache, Helgelse::ShaderLibrary const &shaders,
+								Helgelse::ComputeJob const &job) -> bool {
+	if(vulkan_compute_pipeline(context, cache, shaders, job.shader, job.buffers.size()))
+		return false;
+	auto const shader = shaders.get(job.shader);
+	return shader && cache.building(Helgelse::compute_pipeline_description(*shader, job.buffers.size()));
+}
+
+// Dropped from the cache, destroyed once neither frames nor jobs recorded with it can still run
+auto vulkan_retire_compute_pipeline(auto const &context, Helgelse::VulkanCompute &compute, Helgelse::VulkanComputePipeline const &pipeline) {
+	compute.stale.push_back(Helgelse::VulkanCompute::StalePipeline{context.timeline->last(), context.compute->last(), pipeline});
+}
+
+auto vulkan_destroy_compute_job(auto const &context, Helgelse::VulkanCompute &compute, Helgelse::VulkanComputeJob &job) {
+	for(auto &buffer : job.buffers) {
+		if(buffer.buffer != VK_NULL_HANDLE)
+			vkDestroyBuffer(context.device, buffer.buffer, nullptr);
+		if(buffer.memory != VK_NULL_HANDLE)
+			vkFreeMemory(context.device, buffer.memory, nullptr); // unmaps as well
+	}
+	job.buffers.clear();
+	if(job.commandBuffer != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(context.device, compute.commandPool, 1, &job.commandBuffer);
+	if(job.descriptorPool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(context.device, job.descriptorPool, nullptr);
+	job.commandBuffer  = VK_NULL_HANDLE;
+	job.descriptorPool = VK_NULL_HANDLE;
+}
+
+// A job that never reaches the GPU still signals its value, whoever waits for it wakes up and finds it failed
+auto vulkan_signal_compute(auto const &context, uint64_t value) -> VkResult {
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+	timeline_submit_info.sType					   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_submit_info.signalSemaphoreValueCount = 1;
+	timeline_submit_info.pSignalSemaphoreValues	   = &value;
+	VkSubmitInfo submit_info{};
+	submit_info.sType				 = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext				 = &timeline_submit_info;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores	 = &context.compute->semaphore;
+	return vulkan_check_device(context, vkQueueSubmit(context.computeQueue, 1, &submit_info, VK_NULL_HANDLE));
+}
+
+/*
+Creates the job's buffers with their initial contents, records the dispatch and submits
+it on the compute queue signaling value. Values are handed out in insert order and jobs
+are submitted in that order, so the timeline only ever moves forward. The pipeline has
+to be built already, see vulkan_compute_job_waiting.
+*/
+auto vulkan_submit_compute_job(auto const &context, Helgelse::VulkanCompute &compute, Helgelse::PipelineCache<Helgelse::VulkanComputePipeline> &cache,
+							   Helgelse::ShaderLibrary const &shaders, std::string const &name, Helgelse::ComputeJob const &description, uint64_t value) -> Helgelse::VulkanComputeJob {
+	Helgelse::VulkanComputeJob job;
+	job.value = value;
+	auto const fail = [&](char const *reason) {
+		std::cout << "Compute job " << name << " failed: " << reason << std::endl;
+		vulkan_destroy_compute_job(context, compute, job);
+		job.failed = true;
+		vulkan_signal_compute(context, value);
+		return job;
+	};
+	auto const *pipeline = vulkan_compute_pipeline(context, cache, shaders, description.shader, description.buffers.size());
+	if(!pipeline)
+		return fail("no usable shader");
+
+	for(auto const &source : description.buffers) {
+		auto &buffer = job.buffers.emplace_back();
+		buffer.size	 = Helgelse::compute_buffer_size(source);
+		VkBufferCreateInfo buffer_create_info{};
+		buffer_create_info.sType	   = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.size		   = buffer.size;
+		buffer_create_info.usage	   = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if(vkCreateBuffer(context.device, &buffer_create_info, nullptr, &buffer.buffer) != VK_SUCCESS)
+			return fail("can't create buffer");
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(context.device, buffer.buffer, &requirements);
+		buffer.memory = vulkan_allocate_memory(context, requirements.size, vulkan_find_memory_type(context.gpu, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+		if(buffer.memory==VK_NULL_HANDLE || vkBindBufferMemory(context.device, buffer.buffer, buffer.memory, 0) != VK_SUCCESS ||
+		   vkMapMemory(context.device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped) != VK_SUCCESS)
+			return fail("out of host visible memory");
+		std::memcpy(buffer.mapped, source.data.data(), source.data.size());
+		std::memset(static_cast<uint8_t*>(buffer.mapped)+source.data.size(), 0, buffer.size-source.data.size());
+	}
+
+	VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(job.buffers.size())};
+	VkDescriptorPoolCreateInfo pool_create_info{};
+	pool_create_info.sType		   = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets	   = 1;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes	   = &pool_size;
+	if(vkCreateDescriptorPool(context.device, &pool_create_info, nullptr, &job.descriptorPool) != VK_SUCCESS)
+		return fail("can't allocate descriptors");
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkDescriptorSetAllocateInfo set_allocate_info{};
+	set_allocate_info.sType				 = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_allocate_info.descriptorPool	 = job.descriptorPool;
+	set_allocate_info.descriptorSetCount = 1;
+	set_allocate_info.pSetLayouts		 = &pipeline->setLayout;
+	if(vkAllocateDescriptorSets(context.device, &set_allocate_info, &set) != VK_SUCCESS)
+		return fail("can't allocate descriptors");
+	std::vector<VkDescriptorBufferInfo> buffer_infos;
+	std::vector<VkWriteDescriptorSet> writes(job.buffers.size());
+	for(auto const &buffer : job.buffers)
+		buffer_infos.push_back(VkDescriptorBufferInfo{buffer.buffer, 0, VK_WHOLE_SIZE});
+	for(uint32_t i = 0; i < writes.size(); ++i) {
+		writes[i].sType			  = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet		  = set;
+		writes[i].dstBinding	  = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo	  = &buffer_infos[i];
+	}
+	vkUpdateDescriptorSets(context.device, writes.size(), writes.data(), 0, nullptr);
+
+	VkCommandBufferAllocateInfo allocate_info{};
+	allocate_info.sType				 = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocate_info.commandPool		 = compute.commandPool;
+	allocate_info.level				 = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocate_info.commandBufferCount = 1;
+	if(vkAllocateCommandBuffers(context.device, &allocate_info, &job.commandBuffer) != VK_SUCCESS)
+		return fail("can't allocate a command buffer");
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(job.commandBuffer, &begin_info);
+	vulkan_begin_label(context, job.commandBuffer, name.c_str());
+	vkCmdBindPipeline(job.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline);
+	vkCmdBindDescriptorSets(job.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->layout, 0, 1, &set, 0, nullptr);
+	if(!description.pushConstants.empty())
+		vkCmdPushConstants(job.commandBuffer, pipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, description.pushConstants.size(), description.pushConstants.data());
+	vkCmdDispatch(job.commandBuffer, description.groups[0], description.groups[1], description.groups[2]);
+	// The semaphore wait makes device writes available, the host still needs them made visible to it
+	VkMemoryBarrier barrier{};
+	barrier.sType		  = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(job.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	vulkan_end_label(context, job.commandBuffer);
+	vkEndCommandBuffer(job.commandBuffer);
+
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+	timeline_submit_info.sType					   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_submit_info.signalSemaphoreValueCount = 1;
+	timeline_submit_info.pSignalSemaphoreValues	   = &job.value;
+	VkSubmitInfo submit_info{};
+	submit_info.sType				 = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext				 = &timeline_submit_info;
+	submit_info.commandBufferCount	 = 1;
+	submit_info.pCommandBuffers		 = &job.commandBuffer;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores	 = &context.compute->semaphore;
+	if(auto const result = vulkan_check_device(context, vkQueueSubmit(context.computeQueue, 1, &submit_info, VK_NULL_HANDLE)); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkQueueSubmit: " << magic_enum::enum_name(result) << std::endl;
+		return fail("submit failed");
+	}
+	return job;
+}
+
+// Only once the job's value is reached
+inline auto vulkan_read_compute_job(Helgelse::VulkanComputeJob const &job) -> Helgelse::ComputeResult {
+	Helgelse::ComputeResult result;
+	for(auto const &buffer : job.buffers) {
+		auto const *bytes = static_cast<uint8_t const*>(buffer.mapped);
+		result.buffers.emplace_back(bytes, bytes+buffer.size);
+	}
+	return result;
+}
+
+// Frees evicted pipelines once no frame or job can use them anymore
+auto vulkan_collect_compute(auto const &context, Helgelse::VulkanCompute &compute) {
+	auto const frameProgress = context.timeline->progress();
+	auto const jobProgress	 = context.compute->progress();
+	std::erase_if(compute.stale, [&](auto &entry) {
+		if(entry.frameValue > frameProgress || entry.jobValue > jobProgress)
+			return false;
+		vulkan_destroy_compute_pipeline(context, entry.pipeline);
+		return true;
+	});
+}
+
+// Only for a device that is idle or lost, jobs are destroyed by their owner first
+auto vulkan_destroy_compute(auto const &context, Helgelse::VulkanCompute &compute) {
+	for(auto &entry : compute.stale)
+		vulkan_destroy_compute_pipeline(context, entry.pipeline);
+	if(compute.commandPool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(context.device, compute.commandPool, nullptr);
+	compute = Helgelse::VulkanCompute{};
+}
+
+auto vulkan_create_compute(auto const &context) -> std::optional<Helgelse::VulkanCompute> {
+	Helgelse::VulkanCompute compute;
+	VkCommandPoolCreateInfo pool_create_info{};
+	pool_create_info.sType			  = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags			  = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_info.queueFamilyIndex = context.computeQueueFamily;
+	if(vkCreateCommandPool(context.device, &pool_create_info, nullptr, &compute.commandPool) != VK_SUCCESS)
+		return std::nullopt;
+	return compute;
+}
@@ -0,0 +1,274 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "Helgelse/DeletionQueue.hpp"
+#include "Helgelse/MemoryBudget.hpp"
+#include "Helgelse/Texture.hpp"
+#include "Helgelse/Validation.hpp"
+
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Helgelse {
+/*
+One timeline semaphore shared by every submit on the device. Each submit signals the
+next value, so the counter is how far the GPU has come and any CPU thread can wait for
+a specific submit without a fence of its own.
+*/
+struct GPUTimeline {
+	auto next() -> uint64_t { return ++this->submitted; }
+	/*
+	The value the next submit signals without handing it out yet, for the thread that owns
+	a queue: it calls next() once vkQueueSubmit succeeded, so a failed submit leaves no
+	value behind that nothing will ever signal.
+	*/
+	auto upcoming() const -> uint64_t { return this->submitted+1; }
+	auto last() const -> uint64_t { return this->submitted; }
+
+	auto progress() const -> uint64_t {
+		Waiter const waiter(*this);
+		uint64_t value = 0;
+		if(!this->lost && vkGetSemaphoreCounterValue(this->device, this->semaphore, &value)==VK_ERROR_DEVICE_LOST)
+			this->lost = true;
+		return value;
+	}
+
+	auto reached(uint64_t value) const -> bool { return this->progress() >= value; }
+
+	/*
+	Returns false on timeout or device loss. Waits in slices and looks at lost between
+	them, so a reader blocked here lets go soon after the device is given up even when
+	the driver never reports it lost.
+	*/
+	auto wait(uint64_t value, uint64_t timeout=UINT64_MAX) const -> bool {
+		Waiter const waiter(*this);
+		VkSemaphoreWaitInfo wait_info{};
+		wait_info.sType			 = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores	 = &this->semaphore;
+		wait_info.pValues		 = &value;
+		while(!this->lost) {
+			auto const slice  = std::min(timeout, TimelineWaitSlice);
+			auto const result = vkWaitSemaphores(this->device, &wait_info, slice);
+			if(result==VK_ERROR_DEVICE_LOST)
+				this->lost = true;
+			if(result != VK_TIMEOUT || slice==timeout)
+				return result==VK_SUCCESS;
+			if(timeout != UINT64_MAX)
+				timeout -= slice;
+		}
+		return false;
+	}
+
+	// Marks the timeline lost and returns once no thread is inside a call on its semaphore, before the device goes away
+	auto abandon() const {
+		this->lost = true;
+		for(auto count = this->waiters.load(); count != 0; count = this->waiters.load())
+			this->waiters.wait(count);
+	}
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	std::atomic<uint64_t> submitted = 0; // value the latest submit signals once it completes
+	mutable std::atomic<bool> lost = false; // the device stopped, the frame loop replaces it along with this timeline
+
+private:
+	static constexpr uint64_t TimelineWaitSlice = 10'000'000; // nanoseconds
+
+	// Counts the threads using the semaphore, registered before they look at lost so abandon() can't miss one
+	struct Waiter {
+		explicit Waiter(GPUTimeline const &timeline) : timeline(timeline) { ++timeline.waiters; }
+		~Waiter() {
+			if(--this->timeline.waiters==0)
+				this->timeline.waiters.notify_all();
+		}
+		GPUTimeline const &timeline;
+	};
+	mutable std::atomic<uint32_t> waiters = 0;
+};
+
+struct VulkanContext {
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice gpu = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t graphicsQueueFamily = UINT32_MAX;
+	VkQueue graphicsQueue = VK_NULL_HANDLE;
+	std::vector<char const*> deviceExtensions; // required ones, the optional extensions below are probed per device
+	std::shared_ptr<GPUTimeline> timeline; // shared so readers outside the frame loop can wait on it
+	uint32_t transferQueueFamily = UINT32_MAX; // a dedicated copy family when the device has one, otherwise the graphics family
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	std::shared_ptr<GPUTimeline> transfers; // uploads, separate because the two queues complete out of order
+	uint32_t computeQueueFamily = UINT32_MAX; // a compute family without graphics when the device has one, otherwise the graphics family
+	VkQueue computeQueue = VK_NULL_HANDLE;
+	std::shared_ptr<GPUTimeline> compute; // compute jobs, readers grabbing results wait on it
+	std::shared_ptr<DeletionQueue> deletions = std::make_shared<DeletionQueue>();
+	std::shared_ptr<MemoryResidency> residency = std::make_shared<MemoryResidency>();
+	uint64_t deviceResets = 0; // devices lost and rebuilt since startup
+
+	// VK_EXT_memory_budget, real per-process heap usage and a budget that reflects other applications
+	bool hasMemoryBudget = false;
+
+	// VK_KHR_present_id + VK_KHR_present_wait, lets the frame pacer see when a frame actually hit the display
+	bool hasPresentWait = false;
+	PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+
+	// VK_KHR_incremental_present, lets a present describe which rects changed
+	bool hasIncrementalPresent = false;
+
+	// VK_EXT_debug_utils, only loaded when validation is on, so in release runs every use is a null check
+	Validation validation = Validation::None;
+	VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+	PFN_vkSetDebugUtilsObjectNameEXT setObjectName = nullptr;
+	PFN_vkCmdBeginDebugUtilsLabelEXT beginLabel = nullptr;
+	PFN_vkCmdEndDebugUtilsLabelEXT endLabel = nullptr;
+
+	// VK_KHR_dynamic_rendering, renders straight into image views without render pass and framebuffer objects
+	bool hasDynamicRendering = false;
+	PFN_vkCmdBeginRenderingKHR beginRendering = nullptr;
+	PFN_vkCmdEndRenderingKHR endRendering = nullptr;
+
+	// drawIndirectCount of Vulkan 1.2, lets culling on the GPU decide how many indirect draws run
+	bool hasDrawIndirectCount = false;
+
+	// multiDrawIndirect, lets one indirect draw call issue more than one draw
+	bool hasMultiDrawIndirect = false;
+
+	// Texture formats the GPU samples with the compression features that were enabled, what decoders may produce
+	TextureFormats textureFormats = TextureFormats::uncompressed();
+};
+}
+
+auto vulkan_supports_device_extension(auto const &gpu, char const *name) -> bool {
+	uint32_t extension_count = 0;
+	vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extension_count, nullptr);
+	std::vector<VkExtensionProperties> extensions(extension_count);
+	vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extension_count, extensions.data());
+	for(auto const &extension : extensions)
+		if(std::strcmp(extension.extensionName, name)==0)
+			return true;
+	return false;
+}
+
+auto vulkan_find_memory_type(auto const &gpu, uint32_t typeBits, VkMemoryPropertyFlags properties) -> std::optional<uint32_t> {
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(gpu, &memory_properties);
+	for(uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i)
+		if((typeBits & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties)==properties)
+			return i;
+	return std::nullopt;
+}
+
+auto vulkan_allocate_memory(auto const &vulkan, VkDeviceSize size, std::optional<uint32_t> memoryType) -> VkDeviceMemory {
+	if(!memoryType)
+		return VK_NULL_HANDLE;
+	VkMemoryAllocateInfo allocate_info{};
+	allocate_info.sType			  = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize  = size;
+	allocate_info.memoryTypeIndex = *memoryType;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	if(auto const result = vkAllocateMemory(vulkan.device, &allocate_info, nullptr, &memory); result != VK_SUCCESS)
+		std::cout << "Error from Vulkan during vkAllocateMemory: " << magic_enum::enum_name(result) << std::endl;
+	return memory;
+}
+
+// A timeline replacing one of a lost device starts where the old one was, so values readers hold stay meaningful
+inline auto vulkan_create_timeline(VkDevice device, uint64_t initialValue=0) -> std::shared_ptr<Helgelse::GPUTimeline> {
+	VkSemaphoreTypeCreateInfo type_create_info{};
+	type_create_info.sType		   = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	type_create_info.initialValue  = initialValue;
+	VkSemaphoreCreateInfo semaphore_create_info{};
+	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_create_info.pNext = &type_create_info;
+
+	auto timeline = std::make_shared<Helgelse::GPUTimeline>();
+	timeline->device	= device;
+	timeline->submitted = initialValue;
+	if(auto const result = vkCreateSemaphore(device, &semaphore_create_info, nullptr, &timeline->semaphore); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateSemaphore: " << magic_enum::enum_name(result) << std::endl;
+		return nullptr;
+	}
+	return timeline;
+}
+
+// Results that can report a lost device pass through here, the frame loop rebuilds the device once the timeline says so
+auto vulkan_check_device(auto const &context, VkResult result) -> VkResult {
+	if(result==VK_ERROR_DEVICE_LOST && context.timeline)
+		context.timeline->lost = true;
+	return result;
+}
+
+auto vulkan_device_lost(auto const &context) -> bool {
+	return (context.timeline && context.timeline->lost) || (context.transfers && context.transfers->lost) || (context.compute && context.compute->lost);
+}
+
+// Destroy once every submit made so far has completed, without waiting for it here
+auto vulkan_retire(auto const &context, std::function<void()> destroy) {
+	context.deletions->retire(context.timeline ? context.timeline->last() : 0, std::move(destroy));
+}
+
+auto vulkan_collect_garbage(auto const &context) -> size_t {
+	return context.deletions->collect(context.timeline ? context.timeline->progress() : UINT64_MAX);
+}
+
+auto vulkan_name_object(auto const &context, VkObjectType type, auto handle, char const *name) {
+	if(!context.setObjectName || handle==VK_NULL_HANDLE)
+		return;
+	VkDebugUtilsObjectNameInfoEXT name_info{};
+	name_info.sType		   = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+	name_info.objectType   = type;
+	name_info.objectHandle = (uint64_t)handle; // dispatchable handles are pointers, the others integers on 32-bit
+	name_info.pObjectName  = name;
+	context.setObjectName(context.device, &name_info);
+}
+
+auto vulkan_begin_label(auto const &context, VkCommandBuffer commandBuffer, char const *name) {
+	if(!context.beginLabel)
+		return;
+	VkDebugUtilsLabelEXT label{};
+	label.sType		 = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+	label.pLabelName = name;
+	context.beginLabel(commandBuffer, &label);
+}
+
+auto vulkan_end_label(auto const &context, VkCommandBuffer commandBuffer) {
+	if(context.endLabel)
+		context.endLabel(commandBuffer);
+}
+
+auto vulkan_memory_heap(auto const &gpu, uint32_t memoryType) -> uint32_t {
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(gpu, &memory_properties);
+	return memory_properties.memoryTypes[memoryType].heapIndex;
+}
+
+// Without the extension the budget is the heap size and the usage is whatever we track ourselves
+auto vulkan_query_memory_budget(auto const &context) -> Helgelse::MemoryStats {
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+	budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2 memory_properties{};
+	memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memory_properties.pNext = context.hasMemoryBudget ? &budget_properties : nullptr;
+	vkGetPhysicalDeviceMemoryProperties2(context.gpu, &memory_properties);
+
+	Helgelse::MemoryStats stats;
+	for(uint32_t heap = 0; heap < memory_properties.memoryProperties.memoryHeapCount; ++heap) {
+		auto const &properties = memory_properties.memoryProperties.memoryHeaps[heap];
+		Helgelse::HeapBudget budget;
+		budget.size		   = properties.size;
+		budget.deviceLocal = (properties.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		budget.usage	   = context.hasMemoryBudget ? budget_properties.heapUsage[heap] : context.residency->tracked(heap);
+		budget.budget	   = context.hasMemoryBudget ? budget_properties.heapBudget[heap] : properties.size;
+		stats.heaps.push_back(budget);
+	}
+	return stats;
+}
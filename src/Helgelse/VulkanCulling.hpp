@@ -0,0 +1,403 @@
+#pragma once
+#include "Helgelse/Culling.hpp"
+#include "Helgelse/RenderGraph.hpp"
+#include "Helgelse/Shader.hpp"
+#include "Helgelse/VulkanCompute.hpp"
+#include "Helgelse/VulkanContext.hpp"
+#include "Helgelse/VulkanMeshes.hpp"
+#include "Helgelse/VulkanRenderGraph.hpp"
+
+#include <magic_enum.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+// A cull set of a window as the space holds it, the GPU side is rebuilt from it whenever the generation moves
+struct CullSetState {
+	CullSet set;
+	CullView view;
+	Frustum frustum = frustum_planes(CullView{}.viewProjection);
+	uint64_t generation = 0;
+};
+
+// Brings the frame loop's copy in line with the inserted sets, a set whose generation didn't move only takes the new view
+inline auto cull_sets_update(std::map<std::string, CullSetState, std::less<>> &drawn, std::map<std::string, CullSetState, std::less<>> const &inserted) {
+	std::erase_if(drawn, [&](auto const &set) { return !inserted.contains(set.first); });
+	for(auto const &[name, state] : inserted) {
+		auto &copy = drawn[name];
+		if(copy.generation==state.generation) {
+			copy.view = state.view;
+			copy.frustum = state.frustum;
+		}
+		else
+			copy = state;
+	}
+}
+
+/*
+The instances stay on the GPU between frames, only the frustum goes up with each
+dispatch. Commands and count are rewritten every frame the window draws, the staging
+buffer lives until the frame after the one that copied it.
+*/
+struct VulkanCullSet {
+	struct Buffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+	};
+	Buffer instances;
+	Buffer commands;
+	Buffer count;
+	Buffer staging;
+	bool uploadRecorded = false;
+	bool culled = false; // commands and count hold last frame's draws, whatever reads them must finish before they are rewritten
+	uint32_t instanceCount = 0;
+	uint64_t generation = 0;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+};
+
+// The graph resources a draw pass declares as IndirectBuffer to draw what survived culling
+struct CulledDraws {
+	uint32_t commands = 0;
+	uint32_t count = 0;
+};
+
+// Draws the culled commands into a window, built from a set's shaders for the window's format
+struct VulkanCulledDrawPipeline {
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE; // null when the build failed, tried again once a shader or the format changes
+	uint64_t vertexVersion = 0;
+	uint64_t fragmentVersion = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+};
+}
+
+// Compacted draws need the count the GPU wrote and a call that issues more than one draw
+auto vulkan_culling_compacts(auto const &context) -> bool {
+	return context.hasDrawIndirectCount && context.hasMultiDrawIndirect;
+}
+
+auto vulkan_destroy_cull_buffer(auto const &context, Helgelse::VulkanCullSet::Buffer &buffer) {
+	if(buffer.buffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(context.device, buffer.buffer, nullptr);
+	if(buffer.memory != VK_NULL_HANDLE)
+		vkFreeMemory(context.device, buffer.memory, nullptr);
+	buffer = Helgelse::VulkanCullSet::Buffer{};
+}
+
+auto vulkan_create_cull_buffer(auto const &context, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) -> std::optional<Helgelse::VulkanCullSet::Buffer> {
+	Helgelse::VulkanCullSet::Buffer buffer;
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType	   = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size		   = size;
+	buffer_create_info.usage	   = usage;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if(auto const result = vkCreateBuffer(context.device, &buffer_create_info, nullptr, &buffer.buffer); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateBuffer: " << magic_enum::enum_name(result) << std::endl;
+		return std::nullopt;
+	}
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(context.device, buffer.buffer, &requirements);
+	buffer.memory = vulkan_allocate_memory(context, requirements.size, vulkan_find_memory_type(context.gpu, requirements.memoryTypeBits, properties));
+	if(buffer.memory==VK_NULL_HANDLE || vkBindBufferMemory(context.device, buffer.buffer, buffer.memory, 0) != VK_SUCCESS) {
+		vulkan_destroy_cull_buffer(context, buffer);
+		return std::nullopt;
+	}
+	return buffer;
+}
+
+// Only once no frame uses the set anymore
+auto vulkan_destroy_cull_set(auto const &context, Helgelse::VulkanCullSet &set) {
+	for(auto *buffer : {&set.instances, &set.commands, &set.count, &set.staging})
+		vulkan_destroy_cull_buffer(context, *buffer);
+	if(set.descriptorPool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(context.device, set.descriptorPool, nullptr);
+	set = Helgelse::VulkanCullSet{};
+}
+
+// Sets allocated with one version's layout stay compatible with every later one, all of them declare the same three bindings
+auto vulkan_create_cull_set(auto const &context, Helgelse::CullSetState const &state, VkDescriptorSetLayout setLayout, std::string const &name) -> std::optional<Helgelse::VulkanCullSet> {
+	Helgelse::VulkanCullSet set;
+	set.instanceCount = state.set.instances.size();
+	set.generation	  = state.generation;
+	auto const instances_size = VkDeviceSize(set.instanceCount)*sizeof(Helgelse::CullInstance);
+	auto const commands_size  = VkDeviceSize(set.instanceCount)*sizeof(Helgelse::DrawIndexedIndirect);
+	auto const fail = [&] {
+		std::cout << "Could not create the buffers of cull set " << name << std::endl;
+		vulkan_destroy_cull_set(context, set);
+		return std::nullopt;
+	};
+	auto instances = vulkan_create_cull_buffer(context, instances_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	auto commands  = vulkan_create_cull_buffer(context, commands_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	auto count	   = vulkan_create_cull_buffer(context, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	auto staging   = vulkan_create_cull_buffer(context, instances_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	set.instances = instances.value_or(Helgelse::VulkanCullSet::Buffer{});
+	set.commands  = commands.value_or(Helgelse::VulkanCullSet::Buffer{});
+	set.count	  = count.value_or(Helgelse::VulkanCullSet::Buffer{});
+	set.staging	  = staging.value_or(Helgelse::VulkanCullSet::Buffer{});
+	if(!instances || !commands || !count || !staging)
+		return fail();
+	void *mapped = nullptr;
+	if(vkMapMemory(context.device, set.staging.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		return fail();
+	std::memcpy(mapped, state.set.instances.data(), instances_size);
+	vkUnmapMemory(context.device, set.staging.memory);
+
+	VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3};
+	VkDescriptorPoolCreateInfo pool_create_info{};
+	pool_create_info.sType		   = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_create_info.maxSets	   = 1;
+	pool_create_info.poolSizeCount = 1;
+	pool_create_info.pPoolSizes	   = &pool_size;
+	if(vkCreateDescriptorPool(context.device, &pool_create_info, nullptr, &set.descriptorPool) != VK_SUCCESS)
+		return fail();
+	VkDescriptorSetAllocateInfo set_allocate_info{};
+	set_allocate_info.sType				 = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	set_allocate_info.descriptorPool	 = set.descriptorPool;
+	set_allocate_info.descriptorSetCount = 1;
+	set_allocate_info.pSetLayouts		 = &setLayout;
+	if(vkAllocateDescriptorSets(context.device, &set_allocate_info, &set.descriptorSet) != VK_SUCCESS)
+		return fail();
+	VkDescriptorBufferInfo const buffer_infos[] {{set.instances.buffer, 0, VK_WHOLE_SIZE}, {set.commands.buffer, 0, VK_WHOLE_SIZE}, {set.count.buffer, 0, VK_WHOLE_SIZE}};
+	VkWriteDescriptorSet writes[3]{};
+	for(uint32_t i = 0; i < 3; ++i) {
+		writes[i].sType			  = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet		  = set.descriptorSet;
+		writes[i].dstBinding	  = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo	  = &buffer_infos[i];
+	}
+	vkUpdateDescriptorSets(context.device, 3, writes, 0, nullptr);
+	vulkan_name_object(context, VK_OBJECT_TYPE_BUFFER, set.instances.buffer, name.c_str());
+	return set;
+}
+
+/*
+Shared with every other window culling with the same shader and built in the background.
+Until the first build is done there is nothing to cull with, after that the window keeps
+the pipeline it last culled with, in built, until the replaced shader's one is ready.
+*/
+auto vulkan_cull_pipeline(auto const &context, std::map<std::string, Helgelse::PipelineDescription, std::less<>> &built, Helgelse::PipelineCache<Helgelse::VulkanComputePipeline> &cache,
+						  Helgelse::ShaderLibrary const &shaders, std::string const &id) -> Helgelse::VulkanComputePipeline const* {
+	auto const shader = shaders.get(id);
+	if(!shader)
+		return nullptr;
+	if(auto const *pipeline = vulkan_cached_compute_pipeline(context, cache, *shader, 3, id)) {
+		built.insert_or_assign(id, Helgelse::compute_pipeline_description(*shader, 3));
+		return pipeline;
+	}
+	auto const previous = built.find(id);
+	return previous != built.end() ? cache.find(previous->second) : nullptr;
+}
+
+/*
+Adds the passes that fill the set's command and count buffers: the one-time upload of
+the instances, clearing the count and the dispatch. Nothing marks the outputs, the
+draw pass that declares them as IndirectBuffer keeps the passes alive and is ordered
+after the dispatch. Without compaction every instance keeps its slot and culled ones
+draw nothing. The buffers are imported, imports pairs each with its resource for the
+graph context.
+*/
+auto vulkan_add_culling(auto const &context, Helgelse::RenderGraph &graph, Helgelse::VulkanCullSet &set, Helgelse::VulkanComputePipeline const &pipeline,
+						Helgelse::Frustum const &frustum, std::string const &name, std::vector<std::pair<uint32_t, VkBuffer>> &imports) -> Helgelse::CulledDraws {
+	using Helgelse::Access;
+	// The frame that copied the instances was submitted, whatever comes later reads them after it
+	if(set.uploadRecorded && set.staging.buffer != VK_NULL_HANDLE) {
+		vulkan_retire(context, [context, staging = set.staging]() mutable { vulkan_destroy_cull_buffer(context, staging); });
+		set.staging = Helgelse::VulkanCullSet::Buffer{};
+	}
+	auto const upload	 = set.staging.buffer != VK_NULL_HANDLE;
+	auto const previous	 = set.culled ? std::optional(Access::IndirectBuffer) : std::nullopt;
+	auto const instances = graph.importBuffer(name + " instances", upload ? std::nullopt : std::optional(Access::StorageRead));
+	auto const commands	 = graph.importBuffer(name + " commands", previous);
+	auto const count	 = graph.importBuffer(name + " count", previous);
+	imports.emplace_back(instances, set.instances.buffer);
+	imports.emplace_back(commands, set.commands.buffer);
+	imports.emplace_back(count, set.count.buffer);
+
+	if(upload)
+		graph.addPass(name + " upload", {{instances, Access::TransferDst}}, [&set](Helgelse::RenderGraphContext &pass) {
+			VkBufferCopy const region{0, 0, VkDeviceSize(set.instanceCount)*sizeof(Helgelse::CullInstance)};
+			vkCmdCopyBuffer(pass.commandBuffer, set.staging.buffer, set.instances.buffer, 1, &region);
+			set.uploadRecorded = true;
+		});
+	graph.addPass(name + " reset", {{count, Access::TransferDst}}, [&set](Helgelse::RenderGraphContext &pass) {
+		vkCmdFillBuffer(pass.commandBuffer, set.count.buffer, 0, sizeof(uint32_t), 0);
+	});
+	Helgelse::CullPushConstants push_constants{frustum, set.instanceCount, vulkan_culling_compacts(context) ? 1u : 0u};
+	graph.addPass(name + " cull", {{instances, Access::StorageRead}, {commands, Access::StorageWrite}, {count, Access::StorageWrite}},
+				  [&set, &pipeline, push_constants](Helgelse::RenderGraphContext &pass) {
+		vkCmdBindPipeline(pass.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+		vkCmdBindDescriptorSets(pass.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &set.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(pass.commandBuffer, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+		vkCmdDispatch(pass.commandBuffer, Helgelse::cull_groups(set.instanceCount), 1, 1);
+		set.culled = true;
+	});
+	return Helgelse::CulledDraws{commands, count};
+}
+
+auto vulkan_destroy_culled_draw_pipeline(auto const &context, Helgelse::VulkanCulledDrawPipeline &pipeline) {
+	if(pipeline.pipeline != VK_NULL_HANDLE)
+		vkDestroyPipeline(context.device, pipeline.pipeline, nullptr);
+	if(pipeline.layout != VK_NULL_HANDLE)
+		vkDestroyPipelineLayout(context.device, pipeline.layout, nullptr);
+	pipeline = Helgelse::VulkanCulledDrawPipeline{};
+}
+
+/*
+Mesh arena vertices in, one color attachment out, viewport and scissor are set while
+drawing. With dynamic rendering the format is all the pipeline needs, the render pass
+fallback builds against a render pass of the window, which every other one with the
+same format is compatible with.
+*/
+auto vulkan_create_culled_draw_pipeline(auto const &context, Helgelse::Shader const &vertexShader, Helgelse::Shader const &fragmentShader, VkFormat format,
+										VkRenderPass renderPass, std::string const &name) -> std::optional<Helgelse::VulkanCulledDrawPipeline> {
+	Helgelse::VulkanCulledDrawPipeline pipeline;
+	pipeline.vertexVersion	 = vertexShader.version;
+	pipeline.fragmentVersion = fragmentShader.version;
+	pipeline.format			 = format;
+	VkPushConstantRange push_constants{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Helgelse::CulledDrawPushConstants)};
+	VkPipelineLayoutCreateInfo layout_create_info{};
+	layout_create_info.sType				  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layout_create_info.pushConstantRangeCount = 1;
+	layout_create_info.pPushConstantRanges	  = &push_constants;
+	if(auto const result = vkCreatePipelineLayout(context.device, &layout_create_info, nullptr, &pipeline.layout); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreatePipelineLayout: " << magic_enum::enum_name(result) << std::endl;
+		return std::nullopt;
+	}
+
+	// The modules are only needed while the pipeline is created
+	VkShaderModule modules[2]{VK_NULL_HANDLE, VK_NULL_HANDLE};
+	Helgelse::Shader const *shaders[2]{&vertexShader, &fragmentShader};
+	for(int i = 0; i < 2; ++i) {
+		VkShaderModuleCreateInfo module_create_info{};
+		module_create_info.sType	= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		module_create_info.codeSize = shaders[i]->spirv.size()*sizeof(uint32_t);
+		module_create_info.pCode	= shaders[i]->spirv.data();
+		if(auto const result = vkCreateShaderModule(context.device, &module_create_info, nullptr, &modules[i]); result != VK_SUCCESS) {
+			std::cout << "Error from Vulkan during vkCreateShaderModule: " << magic_enum::enum_name(result) << std::endl;
+			for(auto module : modules)
+				if(module != VK_NULL_HANDLE)
+					vkDestroyShaderModule(context.device, module, nullptr);
+			vulkan_destroy_culled_draw_pipeline(context, pipeline);
+			return std::nullopt;
+		}
+	}
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	for(int i = 0; i < 2; ++i) {
+		stages[i].sType	 = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[i].stage	 = i==0 ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+		stages[i].module = modules[i];
+		stages[i].pName	 = "main";
+	}
+
+	auto const [binding, attributes] = vulkan_mesh_vertex_input();
+	VkPipelineVertexInputStateCreateInfo vertex_input{};
+	vertex_input.sType							 = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertex_input.vertexBindingDescriptionCount	 = 1;
+	vertex_input.pVertexBindingDescriptions		 = &binding;
+	vertex_input.vertexAttributeDescriptionCount = attributes.size();
+	vertex_input.pVertexAttributeDescriptions	 = attributes.data();
+	VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+	input_assembly.sType	= VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPipelineViewportStateCreateInfo viewport_state{};
+	viewport_state.sType		 = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewport_state.viewportCount = 1;
+	viewport_state.scissorCount	 = 1;
+	VkPipelineRasterizationStateCreateInfo rasterization{};
+	rasterization.sType		  = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterization.cullMode	  = VK_CULL_MODE_BACK_BIT;
+	rasterization.frontFace	  = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterization.lineWidth	  = 1.0f;
+	VkPipelineMultisampleStateCreateInfo multisample{};
+	multisample.sType				 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	VkPipelineColorBlendAttachmentState blend_attachment{};
+	blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	VkPipelineColorBlendStateCreateInfo color_blend{};
+	color_blend.sType			= VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	color_blend.attachmentCount = 1;
+	color_blend.pAttachments	= &blend_attachment;
+	VkDynamicState const dynamic_states[] {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamic_state{};
+	dynamic_state.sType				= VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic_state.dynamicStateCount = 2;
+	dynamic_state.pDynamicStates	= dynamic_states;
+	VkPipelineRenderingCreateInfoKHR rendering_create_info{};
+	rendering_create_info.sType					  = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	rendering_create_info.colorAttachmentCount	  = 1;
+	rendering_create_info.pColorAttachmentFormats = &format;
+
+	VkGraphicsPipelineCreateInfo pipeline_create_info{};
+	pipeline_create_info.sType				 = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipeline_create_info.pNext				 = context.hasDynamicRendering ? &rendering_create_info : nullptr;
+	pipeline_create_info.stageCount			 = 2;
+	pipeline_create_info.pStages			 = stages;
+	pipeline_create_info.pVertexInputState	 = &vertex_input;
+	pipeline_create_info.pInputAssemblyState = &input_assembly;
+	pipeline_create_info.pViewportState		 = &viewport_state;
+	pipeline_create_info.pRasterizationState = &rasterization;
+	pipeline_create_info.pMultisampleState	 = &multisample;
+	pipeline_create_info.pColorBlendState	 = &color_blend;
+	pipeline_create_info.pDynamicState		 = &dynamic_state;
+	pipeline_create_info.layout				 = pipeline.layout;
+	pipeline_create_info.renderPass			 = context.hasDynamicRendering ? VK_NULL_HANDLE : renderPass;
+	auto const result = vkCreateGraphicsPipelines(context.device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &pipeline.pipeline);
+	for(auto module : modules)
+		vkDestroyShaderModule(context.device, module, nullptr);
+	if(result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateGraphicsPipelines: " << magic_enum::enum_name(result) << std::endl;
+		vulkan_destroy_culled_draw_pipeline(context, pipeline);
+		return std::nullopt;
+	}
+	vulkan_name_object(context, VK_OBJECT_TYPE_PIPELINE, pipeline.pipeline, name.c_str());
+	return pipeline;
+}
+
+/*
+Built right on the frame loop the first time a set draws with the shaders, the cache
+only builds compute pipelines so far. A replaced shader or a swapchain with another
+format builds it again, the old one is retired with the frames that drew with it.
+*/
+auto vulkan_culled_draw_pipeline(auto const &context, std::map<std::string, Helgelse::VulkanCulledDrawPipeline, std::less<>> &built, Helgelse::ShaderLibrary const &shaders,
+								 Helgelse::CullSet const &set, VkFormat format, VkRenderPass renderPass) -> Helgelse::VulkanCulledDrawPipeline const* {
+	auto const vertex_shader = shaders.get(set.vertexShader);
+	auto const fragment_shader = shaders.get(set.fragmentShader);
+	if(!vertex_shader || !fragment_shader)
+		return nullptr;
+	auto const key = set.vertexShader + " " + set.fragmentShader;
+	auto it = built.find(key);
+	if(it != built.end() && (it->second.vertexVersion != vertex_shader->version || it->second.fragmentVersion != fragment_shader->version || it->second.format != format)) {
+		vulkan_retire(context, [context, pipeline = it->second]() mutable { vulkan_destroy_culled_draw_pipeline(context, pipeline); });
+		built.erase(it);
+		it = built.end();
+	}
+	if(it==built.end()) {
+		auto created = vulkan_create_culled_draw_pipeline(context, *vertex_shader, *fragment_shader, format, renderPass, key);
+		// A failed build is remembered so it isn't tried again every frame
+		it = built.emplace(key, created.value_or(Helgelse::VulkanCulledDrawPipeline{VK_NULL_HANDLE, VK_NULL_HANDLE, vertex_shader->version, fragment_shader->version, format})).first;
+	}
+	return it->second.pipeline != VK_NULL_HANDLE ? &it->second : nullptr;
+}
+
+// Inside rendering, with the draw's pipeline and the mesh arena bound
+auto vulkan_draw_culled(auto const &context, VkCommandBuffer commandBuffer, Helgelse::VulkanCullSet const &set) {
+	auto const stride = uint32_t(sizeof(Helgelse::DrawIndexedIndirect));
+	if(vulkan_culling_compacts(context))
+		vkCmdDrawIndexedIndirectCount(commandBuffer, set.commands.buffer, 0, set.count.buffer, 0, set.instanceCount, stride);
+	else if(context.hasMultiDrawIndirect)
+		vkCmdDrawIndexedIndirect(commandBuffer, set.commands.buffer, 0, set.instanceCount, stride);
+	else
+		// A draw count above one needs multiDrawIndirect, every slot goes on its own
+		for(uint32_t i = 0; i < set.instanceCount; ++i)
+			vkCmdDrawIndexedIndirect(commandBuffer, set.commands.buffer, VkDeviceSize(i)*stride, 1, stride);
+}
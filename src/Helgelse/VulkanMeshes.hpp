@@ -0,0 +1,397 @@
+#pragma once
+#include "Helgelse/Mesh.hpp"
+#include "Helgelse/VulkanContext.hpp"
+
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+struct VulkanMeshBuffer {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	uint32_t capacity = 0; // in vertices or indices
+};
+
+// Meshes copied in one submit on the transfer queue, with the grown arena buffers when they didn't fit anymore
+struct VulkanMeshUpload {
+	struct Entry {
+		std::string name;
+		uint64_t generation = 0;
+		MeshRange range;
+	};
+	std::vector<Entry> meshes;
+	std::optional<VulkanMeshBuffer> vertices;
+	std::optional<VulkanMeshBuffer> indices;
+	VkBuffer staging = VK_NULL_HANDLE;
+	VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	uint64_t value = 0; // transfer timeline value signaled once the copies are complete
+};
+
+/*
+Every mesh lives in one device local vertex buffer and one index buffer, so a frame
+binds them once and draws any mesh with its first index and base vertex. A mesh that
+doesn't fit grows the buffers: the new ones are filled from the old ones on the
+transfer queue and replace them once the copy is done, offsets stay the same. Ranges
+of replaced and removed meshes are only reused once no frame draws from them.
+*/
+struct VulkanMeshes {
+	static constexpr uint32_t InitialVertices = 1 << 16;
+	static constexpr uint32_t InitialIndices = 1 << 18;
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VulkanMeshBuffer vertices;
+	VulkanMeshBuffer indices;
+	ArenaAllocator vertexSpace;
+	ArenaAllocator indexSpace;
+	std::map<std::string, MeshRange, std::less<>> resident;
+	std::deque<PendingMesh> queued;
+	std::optional<VulkanMeshUpload> upload; // one at a time, a growing upload copies whatever the ones before wrote
+	std::vector<std::pair<uint64_t, MeshRange>> freed; // frame timeline value after which the range can be handed out again
+};
+}
+
+// Binding 0 per vertex, position, normal and uv at locations 0, 1 and 2
+inline auto vulkan_mesh_vertex_input() -> std::pair<VkVertexInputBindingDescription, std::array<VkVertexInputAttributeDescription, 3>> {
+	return {VkVertexInputBindingDescription{0, sizeof(Helgelse::MeshVertex), VK_VERTEX_INPUT_RATE_VERTEX},
+			{VkVertexInputAttributeDescription{0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Helgelse::MeshVertex, position)},
+			 VkVertexInputAttributeDescription{1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Helgelse::MeshVertex, normal)},
+			 VkVertexInputAttributeDescription{2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Helgelse::MeshVertex, uv)}}};
+}
+
+auto vulkan_destroy_mesh_buffer(auto const &context, Helgelse::VulkanMeshBuffer &buffer) {
+	if(buffer.buffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(context.device, buffer.buffer, nullptr);
+	if(buffer.memory != VK_NULL_HANDLE)
+		vkFreeMemory(context.device, buffer.memory, nullptr);
+	buffer = Helgelse::VulkanMeshBuffer{};
+}
+
+// Written by the transfer queue and read by the graphics queue, shared between the two when they are different families
+auto vulkan_create_mesh_buffer(auto const &context, uint32_t capacity, VkDeviceSize elementSize, VkBufferUsageFlags usage, char const *name) -> std::optional<Helgelse::VulkanMeshBuffer> {
+	Helgelse::VulkanMeshBuffer buffer;
+	buffer.capacity = capacity;
+	uint32_t const families[] {context.graphicsQueueFamily, context.transferQueueFamily};
+	auto const shared = context.graphicsQueueFamily != context.transferQueueFamily;
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType				 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size					 = capacity*elementSize;
+	buffer_create_info.usage				 = usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_create_info.sharingMode			 = shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	buffer_create_info.queueFamilyIndexCount = shared ? 2 : 0;
+	buffer_create_info.pQueueFamilyIndices	 = shared ? families : nullptr;
+	if(auto const result = vkCreateBuffer(context.device, &buffer_create_info, nullptr, &buffer.buffer); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateBuffer: " << magic_enum::enum_name(result) << std::endl;
+		return std::nullopt;
+	}
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(context.device, buffer.buffer, &requirements);
+	buffer.memory = vulkan_allocate_memory(context, requirements.size, vulkan_find_memory_type(context.gpu, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+	if(buffer.memory==VK_NULL_HANDLE || vkBindBufferMemory(context.device, buffer.buffer, buffer.memory, 0) != VK_SUCCESS) {
+		vulkan_destroy_mesh_buffer(context, buffer);
+		return std::nullopt;
+	}
+	vulkan_name_object(context, VK_OBJECT_TYPE_BUFFER, buffer.buffer, name);
+	return buffer;
+}
+
+auto vulkan_destroy_mesh_upload(auto const &context, Helgelse::VulkanMeshes &meshes, Helgelse::VulkanMeshUpload &upload) {
+	if(upload.commandBuffer != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(context.device, meshes.commandPool, 1, &upload.commandBuffer);
+	if(upload.staging != VK_NULL_HANDLE)
+		vkDestroyBuffer(context.device, upload.staging, nullptr);
+	if(upload.stagingMemory != VK_NULL_HANDLE)
+		vkFreeMemory(context.device, upload.stagingMemory, nullptr);
+	upload.commandBuffer = VK_NULL_HANDLE;
+	upload.staging		 = VK_NULL_HANDLE;
+	upload.stagingMemory = VK_NULL_HANDLE;
+}
+
+// Doubles the capacity until count more elements fit, the allocator hands out the new space right away
+inline auto vulkan_mesh_capacity(Helgelse::ArenaAllocator const &space, uint32_t count) -> uint32_t {
+	auto capacity = std::max(space.capacity(), 1u);
+	while(capacity - space.extent() < count)
+		capacity *= 2;
+	return capacity;
+}
+
+/*
+Places the meshes in the arena, growing it when they don't fit, packs vertices and
+indices into one staging buffer and submits the copies. Meshes that can't be placed are
+left out, nothing changes in the arena unless the submit went through.
+*/
+auto vulkan_submit_mesh_upload(auto const &context, Helgelse::VulkanMeshes &meshes, std::vector<Helgelse::PendingMesh> const &pending) -> std::optional<Helgelse::VulkanMeshUpload> {
+	Helgelse::VulkanMeshUpload upload;
+	// Placed in copies of the allocators, they only take over once the upload is submitted
+	auto vertex_space = meshes.vertexSpace;
+	auto index_space  = meshes.indexSpace;
+	auto const place = [&](Helgelse::Mesh const &mesh) -> std::optional<Helgelse::MeshRange> {
+		auto const first_vertex = vertex_space.allocate(mesh.vertices.size());
+		auto const first_index	= index_space.allocate(mesh.indices.size());
+		if(first_vertex && first_index)
+			return Helgelse::MeshRange{*first_vertex, static_cast<uint32_t>(mesh.vertices.size()), *first_index, static_cast<uint32_t>(mesh.indices.size())};
+		if(first_vertex)
+			vertex_space.free(*first_vertex, mesh.vertices.size());
+		if(first_index)
+			index_space.free(*first_index, mesh.indices.size());
+		return std::nullopt;
+	};
+	for(auto const &entry : pending) {
+		auto range = place(*entry.mesh);
+		if(!range) {
+			vertex_space.grow(vulkan_mesh_capacity(vertex_space, entry.mesh->vertices.size()));
+			index_space.grow(vulkan_mesh_capacity(index_space, entry.mesh->indices.size()));
+			range = place(*entry.mesh);
+		}
+		if(range)
+			upload.meshes.push_back(Helgelse::VulkanMeshUpload::Entry{entry.name, entry.generation, *range});
+	}
+	if(upload.meshes.empty())
+		return std::nullopt;
+	auto const fail = [&]() -> std::optional<Helgelse::VulkanMeshUpload> {
+		if(upload.vertices)
+			vulkan_destroy_mesh_buffer(context, *upload.vertices);
+		if(upload.indices)
+			vulkan_destroy_mesh_buffer(context, *upload.indices);
+		vulkan_destroy_mesh_upload(context, meshes, upload);
+		return std::nullopt;
+	};
+	if(vertex_space.capacity() != meshes.vertexSpace.capacity() &&
+	   !(upload.vertices = vulkan_create_mesh_buffer(context, vertex_space.capacity(), sizeof(Helgelse::MeshVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, "mesh vertices")))
+		return fail();
+	if(index_space.capacity() != meshes.indexSpace.capacity() &&
+	   !(upload.indices = vulkan_create_mesh_buffer(context, index_space.capacity(), sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, "mesh indices")))
+		return fail();
+	auto const copy_vertices = meshes.vertexSpace.extent();
+	auto const copy_indices	 = meshes.indexSpace.extent();
+	auto const vertex_buffer = upload.vertices ? upload.vertices->buffer : meshes.vertices.buffer;
+	auto const index_buffer	 = upload.indices ? upload.indices->buffer : meshes.indices.buffer;
+
+	VkDeviceSize total = 0;
+	for(auto const &entry : upload.meshes)
+		total += VkDeviceSize(entry.range.vertexCount)*sizeof(Helgelse::MeshVertex) + VkDeviceSize(entry.range.indexCount)*sizeof(uint32_t);
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType	   = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size		   = total;
+	buffer_create_info.usage	   = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if(auto const result = vkCreateBuffer(context.device, &buffer_create_info, nullptr, &upload.staging); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateBuffer: " << magic_enum::enum_name(result) << std::endl;
+		return fail();
+	}
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(context.device, upload.staging, &requirements);
+	upload.stagingMemory = vulkan_allocate_memory(context, requirements.size, vulkan_find_memory_type(context.gpu, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+	void *mapped = nullptr;
+	if(upload.stagingMemory==VK_NULL_HANDLE || vkBindBufferMemory(context.device, upload.staging, upload.stagingMemory, 0) != VK_SUCCESS ||
+	   vkMapMemory(context.device, upload.stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		return fail();
+	std::vector<VkBufferCopy> vertex_copies;
+	std::vector<VkBufferCopy> index_copies;
+	VkDeviceSize offset = 0;
+	for(size_t i = 0, m = 0; i < pending.size() && m < upload.meshes.size(); ++i) {
+		auto const &entry = upload.meshes[m];
+		if(pending[i].name != entry.name || pending[i].generation != entry.generation)
+			continue;
+		auto const &mesh = *pending[i].mesh;
+		auto const vertex_bytes = mesh.vertices.size()*sizeof(Helgelse::MeshVertex);
+		auto const index_bytes	= mesh.indices.size()*sizeof(uint32_t);
+		std::memcpy(static_cast<uint8_t*>(mapped)+offset, mesh.vertices.data(), vertex_bytes);
+		vertex_copies.push_back(VkBufferCopy{offset, VkDeviceSize(entry.range.firstVertex)*sizeof(Helgelse::MeshVertex), vertex_bytes});
+		offset += vertex_bytes;
+		std::memcpy(static_cast<uint8_t*>(mapped)+offset, mesh.indices.data(), index_bytes);
+		index_copies.push_back(VkBufferCopy{offset, VkDeviceSize(entry.range.firstIndex)*sizeof(uint32_t), index_bytes});
+		offset += index_bytes;
+		++m;
+	}
+	vkUnmapMemory(context.device, upload.stagingMemory);
+
+	VkCommandBufferAllocateInfo allocate_info{};
+	allocate_info.sType				 = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocate_info.commandPool		 = meshes.commandPool;
+	allocate_info.level				 = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocate_info.commandBufferCount = 1;
+	if(vkAllocateCommandBuffers(context.device, &allocate_info, &upload.commandBuffer) != VK_SUCCESS)
+		return fail();
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(upload.commandBuffer, &begin_info);
+	// Grown buffers start as a copy of the old ones, which earlier uploads on this queue wrote
+	if((upload.vertices && copy_vertices > 0) || (upload.indices && copy_indices > 0)) {
+		VkMemoryBarrier barrier{};
+		barrier.sType		  = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	if(upload.vertices && copy_vertices > 0) {
+		VkBufferCopy const region{0, 0, VkDeviceSize(copy_vertices)*sizeof(Helgelse::MeshVertex)};
+		vkCmdCopyBuffer(upload.commandBuffer, meshes.vertices.buffer, vertex_buffer, 1, &region);
+	}
+	if(upload.indices && copy_indices > 0) {
+		VkBufferCopy const region{0, 0, VkDeviceSize(copy_indices)*sizeof(uint32_t)};
+		vkCmdCopyBuffer(upload.commandBuffer, meshes.indices.buffer, index_buffer, 1, &region);
+	}
+	// The new meshes may land in ranges freed below the old extent, their copies must come after the grow copies
+	if((upload.vertices && copy_vertices > 0) || (upload.indices && copy_indices > 0)) {
+		VkMemoryBarrier barrier{};
+		barrier.sType		  = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	vkCmdCopyBuffer(upload.commandBuffer, upload.staging, vertex_buffer, vertex_copies.size(), vertex_copies.data());
+	vkCmdCopyBuffer(upload.commandBuffer, upload.staging, index_buffer, index_copies.size(), index_copies.data());
+	vkEndCommandBuffer(upload.commandBuffer);
+
+	upload.value = context.transfers->upcoming();
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+	timeline_submit_info.sType					   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_submit_info.signalSemaphoreValueCount = 1;
+	timeline_submit_info.pSignalSemaphoreValues	   = &upload.value;
+	VkSubmitInfo submit_info{};
+	submit_info.sType				 = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext				 = &timeline_submit_info;
+	submit_info.commandBufferCount	 = 1;
+	submit_info.pCommandBuffers		 = &upload.commandBuffer;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores	 = &context.transfers->semaphore;
+	if(auto const result = vulkan_check_device(context, vkQueueSubmit(context.transferQueue, 1, &submit_info, VK_NULL_HANDLE)); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkQueueSubmit: " << magic_enum::enum_name(result) << std::endl;
+		return fail();
+	}
+	context.transfers->next();
+	meshes.vertexSpace = std::move(vertex_space);
+	meshes.indexSpace  = std::move(index_space);
+	return upload;
+}
+
+// Only for a device that is idle or lost
+auto vulkan_destroy_meshes(auto const &context, Helgelse::VulkanMeshes &meshes) {
+	if(meshes.upload) {
+		if(meshes.upload->vertices)
+			vulkan_destroy_mesh_buffer(context, *meshes.upload->vertices);
+		if(meshes.upload->indices)
+			vulkan_destroy_mesh_buffer(context, *meshes.upload->indices);
+		vulkan_destroy_mesh_upload(context, meshes, *meshes.upload);
+	}
+	vulkan_destroy_mesh_buffer(context, meshes.vertices);
+	vulkan_destroy_mesh_buffer(context, meshes.indices);
+	if(meshes.commandPool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(context.device, meshes.commandPool, nullptr);
+	meshes = Helgelse::VulkanMeshes{};
+}
+
+auto vulkan_create_meshes(auto const &context) -> std::optional<Helgelse::VulkanMeshes> {
+	Helgelse::VulkanMeshes meshes;
+	VkCommandPoolCreateInfo pool_create_info{};
+	pool_create_info.sType			  = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags			  = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_info.queueFamilyIndex = context.transferQueueFamily;
+	if(vkCreateCommandPool(context.device, &pool_create_info, nullptr, &meshes.commandPool) != VK_SUCCESS)
+		return std::nullopt;
+	auto vertices = vulkan_create_mesh_buffer(context, Helgelse::VulkanMeshes::InitialVertices, sizeof(Helgelse::MeshVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, "mesh vertices");
+	auto indices  = vulkan_create_mesh_buffer(context, Helgelse::VulkanMeshes::InitialIndices, sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, "mesh indices");
+	meshes.vertices = vertices.value_or(Helgelse::VulkanMeshBuffer{});
+	meshes.indices	= indices.value_or(Helgelse::VulkanMeshBuffer{});
+	if(!vertices || !indices) {
+		vulkan_destroy_meshes(context, meshes);
+		return std::nullopt;
+	}
+	meshes.vertexSpace = Helgelse::ArenaAllocator(Helgelse::VulkanMeshes::InitialVertices);
+	meshes.indexSpace  = Helgelse::ArenaAllocator(Helgelse::VulkanMeshes::InitialIndices);
+	return meshes;
+}
+
+auto vulkan_free_mesh_range(auto const &context, Helgelse::VulkanMeshes &meshes, Helgelse::MeshRange const &range) {
+	meshes.freed.emplace_back(context.timeline->last(), range);
+}
+
+/*
+Called by the frame loop once per frame, like vulkan_update_textures: takes a finished
+upload, switching to grown buffers and retiring the old ones on the frame timeline,
+releases ranges no frame draws from anymore and submits the next upload. Returns whether
+a mesh became resident.
+*/
+auto vulkan_update_meshes(auto const &context, Helgelse::VulkanMeshes &meshes, Helgelse::MeshLibrary &library) -> bool {
+	auto became_resident = false;
+	if(meshes.upload && context.transfers->reached(meshes.upload->value)) {
+		auto &upload = *meshes.upload;
+		// Frames recorded so far bind the old buffers
+		if(upload.vertices) {
+			vulkan_retire(context, [context, retired = meshes.vertices]() mutable { vulkan_destroy_mesh_buffer(context, retired); });
+			meshes.vertices = *upload.vertices;
+		}
+		if(upload.indices) {
+			vulkan_retire(context, [context, retired = meshes.indices]() mutable { vulkan_destroy_mesh_buffer(context, retired); });
+			meshes.indices = *upload.indices;
+		}
+		for(auto const &entry : upload.meshes) {
+			// Superseded while in flight, no frame has seen it
+			if(!library.uploaded(entry.name, entry.generation, entry.range)) {
+				meshes.vertexSpace.free(entry.range.firstVertex, entry.range.vertexCount);
+				meshes.indexSpace.free(entry.range.firstIndex, entry.range.indexCount);
+				continue;
+			}
+			if(auto const old = meshes.resident.find(entry.name); old != meshes.resident.end())
+				vulkan_free_mesh_range(context, meshes, old->second);
+			meshes.resident[entry.name] = entry.range;
+			became_resident = true;
+		}
+		vulkan_destroy_mesh_upload(context, meshes, upload);
+		meshes.upload.reset();
+	}
+
+	for(auto const &name : library.takeRemoved())
+		if(auto const it = meshes.resident.find(name); it != meshes.resident.end()) {
+			vulkan_free_mesh_range(context, meshes, it->second);
+			meshes.resident.erase(it);
+		}
+	auto const progress = context.timeline->progress();
+	std::erase_if(meshes.freed, [&](auto const &entry) {
+		if(entry.first > progress)
+			return false;
+		meshes.vertexSpace.free(entry.second.firstVertex, entry.second.vertexCount);
+		meshes.indexSpace.free(entry.second.firstIndex, entry.second.indexCount);
+		return true;
+	});
+
+	for(auto &mesh : library.takePending())
+		meshes.queued.push_back(std::move(mesh));
+	if(meshes.upload || meshes.queued.empty())
+		return became_resident;
+	std::vector<Helgelse::PendingMesh> batch(std::make_move_iterator(meshes.queued.begin()), std::make_move_iterator(meshes.queued.end()));
+	meshes.queued.clear();
+	meshes.upload = vulkan_submit_mesh_upload(context, meshes, batch);
+	// Whatever didn't make it into the submit failed for good
+	for(auto const &mesh : batch)
+		if(!meshes.upload || std::none_of(meshes.upload->meshes.begin(), meshes.upload->meshes.end(), [&](auto const &entry) { return entry.name==mesh.name && entry.generation==mesh.generation; }))
+			library.uploaded(mesh.name, mesh.generation, std::nullopt);
+	return became_resident;
+}
+
+// Once per command buffer, every resident mesh is then drawn with mesh_draw of its range
+inline auto vulkan_bind_meshes(VkCommandBuffer commandBuffer, Helgelse::VulkanMeshes const &meshes) {
+	VkDeviceSize const offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &meshes.vertices.buffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, meshes.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+inline auto vulkan_mesh_range(Helgelse::VulkanMeshes const &meshes, std::string_view name) -> std::optional<Helgelse::MeshRange> {
+	if(auto const it = meshes.resident.find(name); it != meshes.resident.end())
+		return it->second;
+	return std::nullopt;
+}
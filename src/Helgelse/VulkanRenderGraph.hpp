@@ -0,0 +1,402 @@
+#pragma once
+#include "Helgelse/RenderGraph.hpp"
+#include "Helgelse/VulkanContext.hpp"
+
+#include <magic_enum.hpp>
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Helgelse {
+// Physical resources for one execution, indexed like RenderGraph::resources()
+struct RenderGraphContext {
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkExtent2D extent{};
+	std::vector<VkImage> images;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkBuffer> buffers;
+	// Textures inserted into the space by name, the placeholder until one is resident. Unset without a device to sample on
+	std::function<VkImageView(std::string_view name)> texture;
+	VkSampler sampler = VK_NULL_HANDLE; // what every texture is sampled with
+};
+
+struct VulkanAccess {
+	VkPipelineStageFlags stage = 0;
+	VkAccessFlags access = 0;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+struct RenderGraphImage {
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE; // only lazily allocated attachments have memory of their own
+};
+
+// Transients kept across frames, indexed like the graph's resources, aliased into shared blocks
+struct RenderGraphCache {
+	std::string signature;
+	std::vector<RenderGraphImage> images;
+	std::vector<VkBuffer> buffers;
+	std::vector<MemoryRequirement> requirements;
+	std::vector<VkDeviceMemory> blocks;
+	uint32_t heap = 0; // heap of the largest block, what the residency tracker charges the cache to
+	MemoryResidency::Id residencyId = 0;
+};
+}
+
+constexpr auto vulkan_access(Helgelse::Access access) -> Helgelse::VulkanAccess {
+	using Helgelse::Access;
+	switch(access) {
+		case Access::ColorAttachment: return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+		case Access::DepthAttachment: return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+		case Access::DepthRead:		  return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+		case Access::Sampled:		  return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		case Access::StorageRead:	  return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL};
+		case Access::StorageWrite:	  return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL};
+		case Access::TransferSrc:	  return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+		case Access::TransferDst:	  return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+		case Access::VertexBuffer:	  return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case Access::IndexBuffer:	  return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case Access::IndirectBuffer:  return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case Access::UniformBuffer:	  return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case Access::Present:		  return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+	}
+	return {};
+}
+
+constexpr auto vulkan_image_layout(Helgelse::Layout layout) -> VkImageLayout {
+	using Helgelse::Layout;
+	switch(layout) {
+		case Layout::Undefined:		  return VK_IMAGE_LAYOUT_UNDEFINED;
+		case Layout::General:		  return VK_IMAGE_LAYOUT_GENERAL;
+		case Layout::ColorAttachment: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		case Layout::DepthAttachment: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		case Layout::DepthReadOnly:	  return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		case Layout::ShaderReadOnly:  return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		case Layout::TransferSrc:	  return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		case Layout::TransferDst:	  return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		case Layout::Present:		  return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	}
+	return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+constexpr auto vulkan_is_depth_access(Helgelse::Access access) -> bool {
+	return access==Helgelse::Access::DepthAttachment || access==Helgelse::Access::DepthRead;
+}
+
+// All barriers before a pass go into one vkCmdPipelineBarrier with the union of their stages
+auto vulkan_record_barriers(auto const &graph, auto const &barriers, Helgelse::RenderGraphContext &context) {
+	if(barriers.empty())
+		return;
+	VkPipelineStageFlags src_stages = 0;
+	VkPipelineStageFlags dst_stages = 0;
+	std::vector<VkImageMemoryBarrier> image_barriers;
+	std::vector<VkBufferMemoryBarrier> buffer_barriers;
+	for(auto const &barrier : barriers) {
+		auto const dst = vulkan_access(barrier.before);
+		VkPipelineStageFlags src_stage = 0;
+		VkAccessFlags src_access = 0;
+		for(auto const access : barrier.after) {
+			// Only writes have anything to make available, reads just need to finish
+			if(Helgelse::is_write(access))
+				src_access |= vulkan_access(access).access;
+			if(access != Helgelse::Access::Present)
+				src_stage |= vulkan_access(access).stage;
+		}
+		// Nothing to wait for inside the frame, chain onto the stage the acquire semaphore waits at
+		if(src_stage==0)
+			src_stage = dst.stage;
+		src_stages |= src_stage;
+		dst_stages |= dst.stage;
+
+		if(graph.resources()[barrier.resource].kind==Helgelse::RenderGraphResource::Kind::Buffer) {
+			VkBufferMemoryBarrier buffer_barrier{};
+			buffer_barrier.sType			   = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			buffer_barrier.srcAccessMask	   = src_access;
+			buffer_barrier.dstAccessMask	   = dst.access;
+			buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			buffer_barrier.buffer			   = context.buffers[barrier.resource];
+			buffer_barrier.offset			   = 0;
+			buffer_barrier.size				   = VK_WHOLE_SIZE;
+			buffer_barriers.push_back(buffer_barrier);
+			continue;
+		}
+		auto const depth = vulkan_is_depth_access(barrier.before) ||
+						   std::any_of(barrier.after.begin(), barrier.after.end(), [](auto access) { return vulkan_is_depth_access(access); });
+		VkImageMemoryBarrier image_barrier{};
+		image_barrier.sType				  = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_barrier.srcAccessMask		  = src_access;
+		image_barrier.dstAccessMask		  = dst.access;
+		image_barrier.oldLayout			  = vulkan_image_layout(barrier.oldLayout);
+		image_barrier.newLayout			  = vulkan_image_layout(barrier.newLayout);
+		image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barrier.image				  = context.images[barrier.resource];
+		image_barrier.subresourceRange	  = {VkImageAspectFlags(depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+		image_barriers.push_back(image_barrier);
+	}
+	vkCmdPipelineBarrier(context.commandBuffer, src_stages, dst_stages, 0, 0, nullptr,
+						 buffer_barriers.size(), buffer_barriers.data(), image_barriers.size(), image_barriers.data());
+}
+
+auto vulkan_execute_render_graph(auto const &vulkan, auto const &graph, auto const &compiled, Helgelse::RenderGraphContext &context) {
+	for(size_t step = 0; step < compiled.order.size(); ++step) {
+		auto const &pass = graph.passes()[compiled.order[step]];
+		vulkan_record_barriers(graph, compiled.barriers[step], context);
+		vulkan_begin_label(vulkan, context.commandBuffer, pass.name.c_str());
+		if(pass.execute)
+			pass.execute(context);
+		vulkan_end_label(vulkan, context.commandBuffer);
+	}
+	vulkan_record_barriers(graph, compiled.finalBarriers, context);
+}
+
+// Usage flags a transient resource needs for every way the graph touches it
+auto vulkan_render_graph_usage(auto const &graph, uint32_t resource) -> std::pair<VkImageUsageFlags, VkBufferUsageFlags> {
+	using Helgelse::Access;
+	VkImageUsageFlags image_usage = 0;
+	VkBufferUsageFlags buffer_usage = 0;
+	for(auto const &pass : graph.passes())
+		for(auto const &[used, access] : pass.uses) {
+			if(used != resource)
+				continue;
+			switch(access) {
+				case Access::ColorAttachment: image_usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+				case Access::DepthAttachment:
+				case Access::DepthRead:		  image_usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+				case Access::Sampled:		  image_usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+				case Access::StorageRead:
+				case Access::StorageWrite:	  image_usage |= VK_IMAGE_USAGE_STORAGE_BIT; buffer_usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT; break;
+				case Access::TransferSrc:	  image_usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; buffer_usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT; break;
+				case Access::TransferDst:	  image_usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; buffer_usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT; break;
+				case Access::VertexBuffer:	  buffer_usage |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT; break;
+				case Access::IndexBuffer:	  buffer_usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT; break;
+				case Access::IndirectBuffer:  buffer_usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT; break;
+				case Access::UniformBuffer:	  buffer_usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT; break;
+				case Access::Present:		  break;
+			}
+		}
+	return {image_usage, buffer_usage};
+}
+
+auto vulkan_device_local_types(auto const &gpu) -> uint32_t {
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(gpu, &memory_properties);
+	uint32_t types = 0;
+	for(uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i)
+		if(memory_properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+			types |= 1u << i;
+	return types;
+}
+
+// Describes the transients and their lifetimes, the cached allocations only fit a graph with the same signature
+auto vulkan_render_graph_signature(auto const &graph, auto const &compiled) -> std::string {
+	std::string signature;
+	for(uint32_t i = 0; i < graph.resources().size(); ++i) {
+		auto const &resource = graph.resources()[i];
+		if(resource.imported)
+			continue;
+		auto const [image_usage, buffer_usage] = vulkan_render_graph_usage(graph, i);
+		signature += resource.name + ":" + std::to_string(static_cast<int>(resource.kind)) + ":" + std::to_string(resource.width) + "x" + std::to_string(resource.height) + ":" +
+					 std::to_string(resource.format) + ":" + std::to_string(resource.size) + ":" + std::to_string(image_usage | buffer_usage) + ":" +
+					 std::to_string(compiled.lifetimes[i].first) + "-" + std::to_string(compiled.lifetimes[i].second) + ";";
+	}
+	return signature;
+}
+
+auto vulkan_create_render_graph_view(auto const &vulkan, auto const &resource, Helgelse::RenderGraphImage &image, VkImageUsageFlags usage) -> bool {
+	auto const depth = (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0;
+	VkImageViewCreateInfo view_create_info{};
+	view_create_info.sType			  = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image			  = image.image;
+	view_create_info.viewType		  = VK_IMAGE_VIEW_TYPE_2D;
+	view_create_info.format			  = static_cast<VkFormat>(resource.format);
+	view_create_info.subresourceRange = {VkImageAspectFlags(depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1};
+	return vkCreateImageView(vulkan.device, &view_create_info, nullptr, &image.view)==VK_SUCCESS;
+}
+
+auto vulkan_create_render_graph_image(auto const &vulkan, auto const &resource, VkImageUsageFlags usage) -> VkImage {
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType		= VK_IMAGE_TYPE_2D;
+	image_create_info.format		= static_cast<VkFormat>(resource.format);
+	image_create_info.extent		= {resource.width, resource.height, 1};
+	image_create_info.mipLevels		= 1;
+	image_create_info.arrayLayers	= 1;
+	image_create_info.samples		= VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling		= VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage			= usage;
+	image_create_info.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkImage image = VK_NULL_HANDLE;
+	if(auto const result = vkCreateImage(vulkan.device, &image_create_info, nullptr, &image); result != VK_SUCCESS)
+		std::cout << "Error from Vulkan during vkCreateImage: " << magic_enum::enum_name(result) << std::endl;
+	return image;
+}
+
+auto vulkan_create_render_graph_buffer(auto const &vulkan, auto const &resource, VkBufferUsageFlags usage) -> VkBuffer {
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType	   = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size		   = resource.size;
+	buffer_create_info.usage	   = usage;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	if(auto const result = vkCreateBuffer(vulkan.device, &buffer_create_info, nullptr, &buffer); result != VK_SUCCESS)
+		std::cout << "Error from Vulkan during vkCreateBuffer: " << magic_enum::enum_name(result) << std::endl;
+	return buffer;
+}
+
+auto vulkan_destroy_render_graph_cache(auto const &vulkan, Helgelse::RenderGraphCache &cache) {
+	for(auto &image : cache.images) {
+		if(image.view != VK_NULL_HANDLE)
+			vkDestroyImageView(vulkan.device, image.view, nullptr);
+		if(image.image != VK_NULL_HANDLE)
+			vkDestroyImage(vulkan.device, image.image, nullptr);
+		if(image.memory != VK_NULL_HANDLE)
+			vkFreeMemory(vulkan.device, image.memory, nullptr);
+	}
+	for(auto buffer : cache.buffers)
+		if(buffer != VK_NULL_HANDLE)
+			vkDestroyBuffer(vulkan.device, buffer, nullptr);
+	for(auto memory : cache.blocks)
+		vkFreeMemory(vulkan.device, memory, nullptr);
+	cache = Helgelse::RenderGraphCache{};
+}
+
+/*
+Creates the transients of a graph and binds them into aliased memory blocks. Images that
+live inside a single pass and are only ever attachments never need to leave tile memory,
+they get the transient attachment usage and lazily allocated memory where the device has
+it, so tilers never back them at all. Passes using such an attachment must not store it.
+Allocations are kept while the graph keeps the same shape, a different shape rebuilds them.
+*/
+auto vulkan_create_render_graph_resources(auto const &vulkan, auto const &graph, auto &compiled, Helgelse::RenderGraphCache &cache) -> bool {
+	auto const count = graph.resources().size();
+	cache.images.assign(count, {});
+	cache.buffers.assign(count, VK_NULL_HANDLE);
+	cache.requirements.assign(count, {});
+	auto const device_local = vulkan_device_local_types(vulkan.gpu);
+	std::vector<VkImageUsageFlags> image_usages(count, 0);
+	for(uint32_t i = 0; i < count; ++i) {
+		auto const &resource = graph.resources()[i];
+		auto const &lifetime = compiled.lifetimes[i];
+		if(resource.imported || lifetime.first==UINT32_MAX)
+			continue;
+		auto [image_usage, buffer_usage] = vulkan_render_graph_usage(graph, i);
+		VkMemoryRequirements requirements;
+		if(resource.kind==Helgelse::RenderGraphResource::Kind::Buffer) {
+			cache.buffers[i] = vulkan_create_render_graph_buffer(vulkan, resource, buffer_usage);
+			if(cache.buffers[i]==VK_NULL_HANDLE)
+				return false;
+			vkGetBufferMemoryRequirements(vulkan.device, cache.buffers[i], &requirements);
+		}
+		else {
+			auto const attachment_only = (image_usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))==0;
+			auto const lazy = attachment_only && lifetime.first==lifetime.second;
+			if(lazy)
+				image_usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			image_usages[i] = image_usage;
+			auto &image = cache.images[i];
+			image.image = vulkan_create_render_graph_image(vulkan, resource, image_usage);
+			if(image.image==VK_NULL_HANDLE)
+				return false;
+			vkGetImageMemoryRequirements(vulkan.device, image.image, &requirements);
+			if(lazy) {
+				auto memory_type = vulkan_find_memory_type(vulkan.gpu, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+				if(memory_type) {
+					image.memory = vulkan_allocate_memory(vulkan, requirements.size, memory_type);
+					if(image.memory==VK_NULL_HANDLE)
+						return false;
+					vkBindImageMemory(vulkan.device, image.image, image.memory, 0);
+					continue;
+				}
+			}
+		}
+		cache.requirements[i] = Helgelse::MemoryRequirement{requirements.size, requirements.alignment, requirements.memoryTypeBits & device_local};
+	}
+
+	auto const plan = graph.alias(compiled, cache.requirements);
+	uint64_t largest = 0;
+	for(auto const &block : plan.blocks) {
+		auto const memory_type = vulkan_find_memory_type(vulkan.gpu, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		auto const memory = vulkan_allocate_memory(vulkan, block.size, memory_type);
+		if(memory==VK_NULL_HANDLE)
+			return false;
+		cache.blocks.push_back(memory);
+		if(block.size > largest) {
+			largest	   = block.size;
+			cache.heap = vulkan_memory_heap(vulkan.gpu, *memory_type);
+		}
+	}
+	for(uint32_t i = 0; i < count; ++i) {
+		auto const &placement = plan.placements[i];
+		if(placement.block != UINT32_MAX) {
+			if(cache.buffers[i] != VK_NULL_HANDLE)
+				vkBindBufferMemory(vulkan.device, cache.buffers[i], cache.blocks[placement.block], placement.offset);
+			else
+				vkBindImageMemory(vulkan.device, cache.images[i].image, cache.blocks[placement.block], placement.offset);
+		}
+		if(cache.images[i].image != VK_NULL_HANDLE && !vulkan_create_render_graph_view(vulkan, graph.resources()[i], cache.images[i], image_usages[i]))
+			return false;
+		vulkan_name_object(vulkan, VK_OBJECT_TYPE_IMAGE, cache.images[i].image, graph.resources()[i].name.c_str());
+		vulkan_name_object(vulkan, VK_OBJECT_TYPE_BUFFER, cache.buffers[i], graph.resources()[i].name.c_str());
+	}
+	return true;
+}
+
+// Hands the cache's objects to the deletion queue and leaves it empty, the next frame rebuilds what it needs
+auto vulkan_retire_render_graph_cache(auto const &vulkan, Helgelse::RenderGraphCache &cache) {
+	if(cache.residencyId != 0)
+		vulkan.residency->untrack(cache.residencyId);
+	cache.residencyId = 0; // also for an empty cache, a later untrack must not hit an id handed out again
+	if(cache.images.empty())
+		return;
+	auto retired = std::make_shared<Helgelse::RenderGraphCache>(std::move(cache));
+	cache = Helgelse::RenderGraphCache{};
+	vulkan_retire(vulkan, [vulkan, retired] { vulkan_destroy_render_graph_cache(vulkan, *retired); });
+}
+
+// Fill in the transient resources of a graph, imported ones must already be set in the context
+auto vulkan_realize_render_graph(auto const &vulkan, auto const &graph, auto &compiled, Helgelse::RenderGraphCache &cache, Helgelse::RenderGraphContext &context) -> bool {
+	auto signature = vulkan_render_graph_signature(graph, compiled);
+	if(signature != cache.signature || cache.images.size() != graph.resources().size()) {
+		// Earlier frames may still be using the old allocations
+		vulkan_retire_render_graph_cache(vulkan, cache);
+		if(!vulkan_create_render_graph_resources(vulkan, graph, compiled, cache)) {
+			vulkan_destroy_render_graph_cache(vulkan, cache);
+			return false;
+		}
+		cache.signature = std::move(signature);
+		uint64_t bytes = 0;
+		for(auto const &requirement : cache.requirements)
+			bytes += requirement.size;
+		// Transients are cheap to rebuild, a window that stops drawing gives them up first
+		if(bytes > 0)
+			cache.residencyId = vulkan.residency->track(cache.heap, bytes, Helgelse::MemoryResidency::Eviction::Recreate,
+														 [vulkan, &cache] { vulkan_retire_render_graph_cache(vulkan, cache); });
+	}
+	else {
+		graph.alias(compiled, cache.requirements); // same placements as when the cache was built, only the barriers are needed
+		if(cache.residencyId != 0)
+			vulkan.residency->touch(cache.residencyId);
+	}
+
+	auto const count = graph.resources().size();
+	context.images.resize(count, VK_NULL_HANDLE);
+	context.imageViews.resize(count, VK_NULL_HANDLE);
+	context.buffers.resize(count, VK_NULL_HANDLE);
+	for(uint32_t i = 0; i < count; ++i) {
+		if(graph.resources()[i].imported)
+			continue;
+		context.images[i]	  = cache.images[i].image;
+		context.imageViews[i] = cache.images[i].view;
+		context.buffers[i]	  = cache.buffers[i];
+	}
+	return true;
+}
@@ -0,0 +1,403 @@
+#pragma once
+#include "Helgelse/TextureLoader.hpp"
+#include "Helgelse/VulkanContext.hpp"
+
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Helgelse {
+// Only the streamed levels exist on the GPU, the view's level 0 is info.residentLevel of the full texture
+struct VulkanTexture {
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	TextureInfo info;
+	VkDeviceSize size = 0;
+	uint32_t heap = 0;
+	MemoryResidency::Id residencyId = 0;
+};
+
+// Textures copied in one submit on the transfer queue, their staging memory lives until the copy is done
+struct VulkanUploadBatch {
+	struct Entry {
+		std::string name;
+		uint64_t generation = 0;
+		VulkanTexture texture;
+	};
+	std::vector<Entry> textures;
+	VkBuffer staging = VK_NULL_HANDLE;
+	VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	uint64_t value = 0; // transfer timeline value signaled once the copies are complete
+};
+
+/*
+The device side of the textures in the space. Decoded textures queue up here and go out
+in batches of at most UploadBudget bytes per frame, so a burst of loads at startup is
+spread over several frames instead of stalling one. Until a texture is resident its
+view is the placeholder's.
+*/
+struct VulkanTextures {
+	static constexpr VkDeviceSize UploadBudget = VkDeviceSize(64) << 20;
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VulkanTexture placeholder;
+	std::map<std::string, VulkanTexture, std::less<>> resident;
+	std::deque<DecodedTexture> queued;
+	std::vector<VulkanUploadBatch> uploads;
+};
+}
+
+inline auto vulkan_texture_format(Helgelse::TextureFormat format) -> VkFormat {
+	return static_cast<VkFormat>(Helgelse::texture_format_info(format).vkFormat);
+}
+
+/*
+Block compressed formats need their feature family enabled on the device and the format
+sampleable with optimal tiling, a family being present doesn't promise every format in it.
+*/
+inline auto vulkan_supported_texture_formats(VkPhysicalDevice gpu, VkPhysicalDeviceFeatures const &enabled) -> Helgelse::TextureFormats {
+	auto formats = Helgelse::TextureFormats::uncompressed();
+	for(size_t i = 0; i < size_t(Helgelse::TextureFormat::Count); ++i) {
+		auto const format = Helgelse::TextureFormat(i);
+		auto const vkFormat = vulkan_texture_format(format);
+		auto const family = vkFormat >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && vkFormat <= VK_FORMAT_BC7_SRGB_BLOCK ? enabled.textureCompressionBC
+						  : vkFormat >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && vkFormat <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK ? enabled.textureCompressionETC2
+						  : vkFormat >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && vkFormat <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK ? enabled.textureCompressionASTC_LDR
+						  : VK_TRUE;
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(gpu, vkFormat, &properties);
+		if(family && (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+			formats.add(format);
+	}
+	return formats;
+}
+
+auto vulkan_destroy_texture(auto const &context, Helgelse::VulkanTexture &texture) {
+	if(texture.residencyId != 0)
+		context.residency->untrack(texture.residencyId);
+	if(texture.view != VK_NULL_HANDLE)
+		vkDestroyImageView(context.device, texture.view, nullptr);
+	if(texture.image != VK_NULL_HANDLE)
+		vkDestroyImage(context.device, texture.image, nullptr);
+	if(texture.memory != VK_NULL_HANDLE)
+		vkFreeMemory(context.device, texture.memory, nullptr);
+	texture = Helgelse::VulkanTexture{};
+}
+
+auto vulkan_create_texture(auto const &context, Helgelse::TextureData const &data, std::string const &name) -> std::optional<Helgelse::VulkanTexture> {
+	Helgelse::VulkanTexture texture;
+	texture.info = Helgelse::TextureInfo{Helgelse::TextureState::Resident, data.width, data.height, static_cast<uint32_t>(data.levels.size()), data.format, data.firstLevel};
+
+	// Shared by both families rather than handed over, the copy engine writes it once and never touches it again
+	uint32_t const families[] {context.graphicsQueueFamily, context.transferQueueFamily};
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType					= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType				= VK_IMAGE_TYPE_2D;
+	image_create_info.format				= vulkan_texture_format(data.format);
+	image_create_info.extent				= {data.width, data.height, 1};
+	image_create_info.mipLevels				= texture.info.mipLevels;
+	image_create_info.arrayLayers			= 1;
+	image_create_info.samples				= VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling				= VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage					= VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_create_info.sharingMode			= families[0] != families[1] ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.queueFamilyIndexCount = families[0] != families[1] ? 2 : 0;
+	image_create_info.pQueueFamilyIndices	= families;
+	image_create_info.initialLayout			= VK_IMAGE_LAYOUT_UNDEFINED;
+	if(auto const result = vkCreateImage(context.device, &image_create_info, nullptr, &texture.image); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateImage: " << magic_enum::enum_name(result) << std::endl;
+		return std::nullopt;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(context.device, texture.image, &requirements);
+	auto const memory_type = vulkan_find_memory_type(context.gpu, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	texture.memory = vulkan_allocate_memory(context, requirements.size, memory_type);
+	texture.size   = requirements.size;
+	texture.heap   = memory_type ? vulkan_memory_heap(context.gpu, *memory_type) : 0;
+	if(texture.memory==VK_NULL_HANDLE || vkBindImageMemory(context.device, texture.image, texture.memory, 0) != VK_SUCCESS) {
+		vulkan_destroy_texture(context, texture);
+		return std::nullopt;
+	}
+
+	VkImageViewCreateInfo view_create_info{};
+	view_create_info.sType			  = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_create_info.image			  = texture.image;
+	view_create_info.viewType		  = VK_IMAGE_VIEW_TYPE_2D;
+	view_create_info.format			  = image_create_info.format;
+	view_create_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.info.mipLevels, 0, 1};
+	if(vkCreateImageView(context.device, &view_create_info, nullptr, &texture.view) != VK_SUCCESS) {
+		vulkan_destroy_texture(context, texture);
+		return std::nullopt;
+	}
+	vulkan_name_object(context, VK_OBJECT_TYPE_IMAGE, texture.image, name.c_str());
+	return texture;
+}
+
+// Every level in one copy, then straight to the layout shaders sample from
+inline auto vulkan_record_texture_copy(VkCommandBuffer commandBuffer, Helgelse::VulkanTexture const &texture, Helgelse::TextureData const &data, VkBuffer staging, VkDeviceSize offset) {
+	VkImageMemoryBarrier barrier{};
+	barrier.sType				= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask		= 0;
+	barrier.dstAccessMask		= VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout			= VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout			= VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image				= texture.image;
+	barrier.subresourceRange	= {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.info.mipLevels, 0, 1};
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> copies;
+	for(uint32_t level = 0; level < data.levels.size(); ++level) {
+		auto const &source = data.levels[level];
+		VkBufferImageCopy copy{};
+		copy.bufferOffset	  = offset+source.offset;
+		copy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+		copy.imageExtent	  = {source.width, source.height, 1};
+		copies.push_back(copy);
+	}
+	vkCmdCopyBufferToImage(commandBuffer, staging, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copies.size(), copies.data());
+
+	// Frames wait for the transfer timeline before sampling, that wait makes the writes visible
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout	  = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout	  = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+auto vulkan_destroy_upload_batch(auto const &context, Helgelse::VulkanTextures &textures, Helgelse::VulkanUploadBatch &batch) {
+	if(batch.commandBuffer != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(context.device, textures.commandPool, 1, &batch.commandBuffer);
+	if(batch.staging != VK_NULL_HANDLE)
+		vkDestroyBuffer(context.device, batch.staging, nullptr);
+	if(batch.stagingMemory != VK_NULL_HANDLE)
+		vkFreeMemory(context.device, batch.stagingMemory, nullptr);
+	batch.commandBuffer = VK_NULL_HANDLE;
+	batch.staging		= VK_NULL_HANDLE;
+	batch.stagingMemory = VK_NULL_HANDLE;
+}
+
+// Creates the images, packs every level into one staging buffer and submits the copies, textures that can't be created are left out
+auto vulkan_submit_texture_batch(auto const &context, Helgelse::VulkanTextures &textures, std::vector<Helgelse::DecodedTexture> const &decoded) -> std::optional<Helgelse::VulkanUploadBatch> {
+	Helgelse::VulkanUploadBatch batch;
+	std::vector<VkDeviceSize> offsets;
+	VkDeviceSize total = 0;
+	for(auto const &texture : decoded) {
+		auto created = vulkan_create_texture(context, texture.data, texture.name);
+		if(!created)
+			continue;
+		batch.textures.push_back(Helgelse::VulkanUploadBatch::Entry{texture.name, texture.generation, *created});
+		total = (total+15) & ~VkDeviceSize(15); // copies need texel aligned offsets, 16 covers every format
+		offsets.push_back(total);
+		total += texture.data.bytes.size();
+	}
+	if(batch.textures.empty())
+		return std::nullopt;
+	auto const fail = [&]() -> std::optional<Helgelse::VulkanUploadBatch> {
+		for(auto &entry : batch.textures)
+			vulkan_destroy_texture(context, entry.texture);
+		vulkan_destroy_upload_batch(context, textures, batch);
+		return std::nullopt;
+	};
+
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType	   = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.size		   = total;
+	buffer_create_info.usage	   = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if(auto const result = vkCreateBuffer(context.device, &buffer_create_info, nullptr, &batch.staging); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateBuffer: " << magic_enum::enum_name(result) << std::endl;
+		return fail();
+	}
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(context.device, batch.staging, &requirements);
+	batch.stagingMemory = vulkan_allocate_memory(context, requirements.size, vulkan_find_memory_type(context.gpu, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+	void *mapped = nullptr;
+	if(batch.stagingMemory==VK_NULL_HANDLE || vkBindBufferMemory(context.device, batch.staging, batch.stagingMemory, 0) != VK_SUCCESS ||
+	   vkMapMemory(context.device, batch.stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		return fail();
+	for(size_t i = 0, t = 0; i < decoded.size() && t < batch.textures.size(); ++i)
+		if(decoded[i].name==batch.textures[t].name && decoded[i].generation==batch.textures[t].generation) {
+			std::memcpy(static_cast<uint8_t*>(mapped)+offsets[t], decoded[i].data.bytes.data(), decoded[i].data.bytes.size());
+			++t;
+		}
+	vkUnmapMemory(context.device, batch.stagingMemory);
+
+	VkCommandBufferAllocateInfo allocate_info{};
+	allocate_info.sType				 = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocate_info.commandPool		 = textures.commandPool;
+	allocate_info.level				 = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocate_info.commandBufferCount = 1;
+	if(vkAllocateCommandBuffers(context.device, &allocate_info, &batch.commandBuffer) != VK_SUCCESS)
+		return fail();
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(batch.commandBuffer, &begin_info);
+	for(size_t i = 0, t = 0; i < decoded.size() && t < batch.textures.size(); ++i)
+		if(decoded[i].name==batch.textures[t].name && decoded[i].generation==batch.textures[t].generation) {
+			vulkan_record_texture_copy(batch.commandBuffer, batch.textures[t].texture, decoded[i].data, batch.staging, offsets[t]);
+			++t;
+		}
+	vkEndCommandBuffer(batch.commandBuffer);
+
+	batch.value = context.transfers->upcoming();
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+	timeline_submit_info.sType					   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_submit_info.signalSemaphoreValueCount = 1;
+	timeline_submit_info.pSignalSemaphoreValues	   = &batch.value;
+	VkSubmitInfo submit_info{};
+	submit_info.sType				 = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext				 = &timeline_submit_info;
+	submit_info.commandBufferCount	 = 1;
+	submit_info.pCommandBuffers		 = &batch.commandBuffer;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores	 = &context.transfers->semaphore;
+	if(auto const result = vulkan_check_device(context, vkQueueSubmit(context.transferQueue, 1, &submit_info, VK_NULL_HANDLE)); result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkQueueSubmit: " << magic_enum::enum_name(result) << std::endl;
+		return fail();
+	}
+	context.transfers->next();
+	return batch;
+}
+
+// Only for a device that is idle or lost
+auto vulkan_destroy_textures(auto const &context, Helgelse::VulkanTextures &textures) {
+	for(auto &batch : textures.uploads) {
+		for(auto &entry : batch.textures)
+			vulkan_destroy_texture(context, entry.texture);
+		vulkan_destroy_upload_batch(context, textures, batch);
+	}
+	for(auto &[name, texture] : textures.resident)
+		vulkan_destroy_texture(context, texture);
+	vulkan_destroy_texture(context, textures.placeholder);
+	if(textures.sampler != VK_NULL_HANDLE)
+		vkDestroySampler(context.device, textures.sampler, nullptr);
+	if(textures.commandPool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(context.device, textures.commandPool, nullptr);
+	textures = Helgelse::VulkanTextures{};
+}
+
+// The placeholder is uploaded and waited for right here, once per device
+auto vulkan_create_textures(auto const &context) -> std::optional<Helgelse::VulkanTextures> {
+	Helgelse::VulkanTextures textures;
+	VkCommandPoolCreateInfo pool_create_info{};
+	pool_create_info.sType			  = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags			  = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_info.queueFamilyIndex = context.transferQueueFamily;
+	if(vkCreateCommandPool(context.device, &pool_create_info, nullptr, &textures.commandPool) != VK_SUCCESS)
+		return std::nullopt;
+
+	VkSamplerCreateInfo sampler_create_info{};
+	sampler_create_info.sType		 = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter	 = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter	 = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode	 = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_create_info.maxLod		 = VK_LOD_CLAMP_NONE;
+	if(vkCreateSampler(context.device, &sampler_create_info, nullptr, &textures.sampler) != VK_SUCCESS) {
+		vulkan_destroy_textures(context, textures);
+		return std::nullopt;
+	}
+
+	// A single mid grey texel, neutral enough that nothing flashes while the real texture streams in
+	Helgelse::DecodedTexture placeholder{"placeholder", 0, Helgelse::TextureData{1, 1, Helgelse::TextureFormat::RGBA8, {{1, 1, 0, 4}}, {128, 128, 128, 255}}};
+	auto batch = vulkan_submit_texture_batch(context, textures, {placeholder});
+	if(!batch) {
+		vulkan_destroy_textures(context, textures);
+		return std::nullopt;
+	}
+	context.transfers->wait(batch->value);
+	textures.placeholder = batch->textures[0].texture;
+	vulkan_destroy_upload_batch(context, textures, *batch);
+	return textures;
+}
+
+/*
+Called by the frame loop once per frame: lets the loader start the level changes the
+last frame's usage asks for, hands finished uploads to the loader, drops removed textures
+and submits the next batch of decoded ones. A texture replacing one that frames may
+still sample retires the old image on the frame timeline. Returns whether anything
+became resident, windows showing the placeholder or coarser levels need a redraw.
+*/
+auto vulkan_update_textures(auto const &context, Helgelse::VulkanTextures &textures, Helgelse::TextureLoader &loader) -> bool {
+	for(auto const &name : loader.stream())
+		if(auto const it = textures.resident.find(name); it != textures.resident.end())
+			context.residency->touch(it->second.residencyId);
+
+	auto became_resident = false;
+	for(auto it = textures.uploads.begin(); it != textures.uploads.end();) {
+		if(!context.transfers->reached(it->value)) {
+			++it;
+			continue;
+		}
+		for(auto &entry : it->textures) {
+			// Superseded while in flight, no frame has seen it
+			if(!loader.uploaded(entry.name, entry.generation, true)) {
+				vulkan_destroy_texture(context, entry.texture);
+				continue;
+			}
+			if(auto const old = textures.resident.find(entry.name); old != textures.resident.end()) {
+				auto retired = old->second;
+				vulkan_retire(context, [context, retired]() mutable { vulkan_destroy_texture(context, retired); });
+			}
+			// Under memory pressure the loader drops the texture to its tail, the image goes once that replaces it
+			entry.texture.residencyId = context.residency->track(entry.texture.heap, entry.texture.size, Helgelse::MemoryResidency::Eviction::Recreate,
+																 [&loader, name = entry.name] { loader.evict(name); });
+			textures.resident[entry.name] = entry.texture;
+			became_resident = true;
+		}
+		vulkan_destroy_upload_batch(context, textures, *it);
+		it = textures.uploads.erase(it);
+	}
+
+	for(auto const &name : loader.takeRemoved())
+		if(auto const it = textures.resident.find(name); it != textures.resident.end()) {
+			auto retired = it->second;
+			vulkan_retire(context, [context, retired]() mutable { vulkan_destroy_texture(context, retired); });
+			textures.resident.erase(it);
+		}
+
+	for(auto &texture : loader.takeDecoded())
+		textures.queued.push_back(std::move(texture));
+	if(textures.queued.empty())
+		return became_resident;
+	std::vector<Helgelse::DecodedTexture> batch;
+	VkDeviceSize bytes = 0;
+	while(!textures.queued.empty() && (batch.empty() || bytes+textures.queued.front().data.bytes.size() <= Helgelse::VulkanTextures::UploadBudget)) {
+		bytes += textures.queued.front().data.bytes.size();
+		batch.push_back(std::move(textures.queued.front()));
+		textures.queued.pop_front();
+	}
+	auto submitted = vulkan_submit_texture_batch(context, textures, batch);
+	// Whatever didn't make it into the submit failed for good
+	for(auto const &texture : batch)
+		if(!submitted || std::none_of(submitted->textures.begin(), submitted->textures.end(), [&](auto const &entry) { return entry.name==texture.name && entry.generation==texture.generation; }))
+			loader.uploaded(texture.name, texture.generation, false);
+	if(submitted)
+		textures.uploads.push_back(std::move(*submitted));
+	return became_resident;
+}
+
+// What a draw binds for the named texture, the placeholder until it is resident
+inline auto vulkan_texture_view(Helgelse::VulkanTextures const &textures, std::string_view name) -> VkImageView {
+	if(auto const it = textures.resident.find(name); it != textures.resident.end())
+		return it->second.view;
+	return textures.placeholder.view;
+}
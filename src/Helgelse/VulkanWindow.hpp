@@ -0,0 +1,731 @@
+#pragma once
+#include "Helgelse/VulkanContext.hpp"
+#include "Helgelse/FramePacer.hpp"
+#include "Helgelse/ChangeTracker.hpp"
+#include "Helgelse/CreateWindow.hpp"
+#include "Helgelse/DamageTracker.hpp"
+#include "Helgelse/RenderGraph.hpp"
+#include "Helgelse/Shader.hpp"
+#include "Helgelse/VulkanCulling.hpp"
+#include "Helgelse/VulkanMeshes.hpp"
+#include "Helgelse/VulkanRenderGraph.hpp"
+#include "Helgelse/VulkanTextures.hpp"
+#include "PathSpace.hpp"
+
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Helgelse {
+struct VulkanFrame {
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkSemaphore imageAvailable = VK_NULL_HANDLE;
+	uint64_t submitted = 0; // timeline value of the frame's last submit, the command buffer is free once it is reached
+};
+
+// The objects tied to one swapchain, split off a window when a resize replaces them
+struct VulkanSwapchain {
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	std::vector<VkImage> images;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkFramebuffer> framebuffers;
+	std::vector<VkSemaphore> renderFinished;
+	VkRenderPass clearRenderPass = VK_NULL_HANDLE;
+	VkRenderPass loadRenderPass = VK_NULL_HANDLE;
+};
+
+struct VulkanWindow {
+	std::string name;
+	CreateWindow config;
+	VulkanContext const *context = nullptr; // lets GLFW callbacks draw without going through the frame loop
+	GLFWwindow *window = nullptr;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent{};
+	std::vector<VkImage> images;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkFramebuffer> framebuffers; // render pass fallback only, empty with dynamic rendering
+	std::vector<VkSemaphore> renderFinished; // one per swapchain image, the presentation engine holds it until the image returns
+	VkRenderPass clearRenderPass = VK_NULL_HANDLE; // redraws the whole image
+	VkRenderPass loadRenderPass = VK_NULL_HANDLE;  // keeps the previous contents and only touches damaged rects
+	DamageHistory damageHistory;
+	RenderGraphCache renderGraphCache; // transient attachments of the frame graph
+	std::map<std::string, CullSetState, std::less<>> cullSets; // inserted below culling/, only touched under the space's windows mutex
+	bool cullSetsChanged = false;
+	std::map<std::string, CullSetState, std::less<>> drawnCullSets; // the frame loop's copy of cullSets, what the GPU sets are built from
+	std::map<std::string, VulkanCullSet, std::less<>> culling;
+	std::map<std::string, PipelineDescription, std::less<>> cullPipelines; // by shader id, the last one culled with
+	std::map<std::string, VulkanCulledDrawPipeline, std::less<>> culledDrawPipelines; // by vertex and fragment shader id
+	ShaderLibrary const *shaders = nullptr;
+	PipelineCache<VulkanComputePipeline> *pipelines = nullptr; // the space's, shared by all windows
+	std::optional<VulkanTextures> const *textures = nullptr; // the space's, empty while there is no device
+	std::optional<VulkanMeshes> const *meshes = nullptr;	 // the space's arena, what culled draws draw from
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<VulkanFrame> frames;
+	uint32_t frameIndex = 0;
+	uint64_t presentId = 0;
+	uint64_t awaitedPresent = 0; // present id the pacer waits to see on the display, 0 for none
+	FramePacer::Clock::time_point presentPolled{}; // when it was last found not yet displayed
+	VkClearColorValue clearColor{{0.0f, 0.0f, 0.0f, 1.0f}};
+	FramePacer pacer;
+	bool iconified = false;
+	bool hasArea = true; // false while the framebuffer is zero sized
+	FramePacer::Clock::time_point throttledUntil{}; // set when the surface stopped handing out images, e.g. occluded
+	ChangeTracker *changes = nullptr;
+	FSNG::PathSpaceTE content = FSNG::PathSpace{}; // everything inserted below /graphics/windows/<name>
+	std::map<std::string, Rect, std::less<>> itemBounds; // declared bounds of content items, limits the damage their inserts cause
+};
+}
+
+inline auto glfw_mark_changed(GLFWwindow *glfwWindow) -> void {
+	auto const window = static_cast<Helgelse::VulkanWindow*>(glfwGetWindowUserPointer(glfwWindow));
+	if(window && window->changes)
+		window->changes->markChanged(window->name);
+}
+
+// Any input or exposure event on the window schedules a frame for it in on-change rendering
+inline auto glfw_set_change_callbacks(Helgelse::VulkanWindow &window) -> void {
+	glfwSetWindowUserPointer(window.window, &window);
+	glfwSetWindowRefreshCallback(window.window, [](GLFWwindow *w) { glfw_mark_changed(w); });
+	glfwSetWindowFocusCallback(window.window, [](GLFWwindow *w, int) { glfw_mark_changed(w); });
+	glfwSetKeyCallback(window.window, [](GLFWwindow *w, int, int, int, int) { glfw_mark_changed(w); });
+	glfwSetCharCallback(window.window, [](GLFWwindow *w, unsigned int) { glfw_mark_changed(w); });
+	glfwSetCursorPosCallback(window.window, [](GLFWwindow *w, double, double) { glfw_mark_changed(w); });
+	glfwSetCursorEnterCallback(window.window, [](GLFWwindow *w, int) { glfw_mark_changed(w); });
+	glfwSetMouseButtonCallback(window.window, [](GLFWwindow *w, int, int, int) { glfw_mark_changed(w); });
+	glfwSetScrollCallback(window.window, [](GLFWwindow *w, double, double) { glfw_mark_changed(w); });
+	glfwSetWindowIconifyCallback(window.window, [](GLFWwindow *w, int iconified) {
+		if(auto const window = static_cast<Helgelse::VulkanWindow*>(glfwGetWindowUserPointer(w))) {
+			window->iconified = iconified==GLFW_TRUE;
+			if(!window->iconified)
+				glfw_mark_changed(w);
+		}
+	});
+}
+
+// Suspended windows acquire, record and present nothing until they are restored
+inline auto vulkan_window_suspended(Helgelse::VulkanWindow const &window) -> bool {
+	return window.iconified || !window.hasArea || window.swapchain==VK_NULL_HANDLE || glfwGetWindowAttrib(window.window, GLFW_VISIBLE)==GLFW_FALSE;
+}
+
+auto vulkan_create_render_pass(auto const &context, VkFormat format, bool keepContents) -> VkRenderPass {
+	VkAttachmentDescription attachment{};
+	attachment.format		  = format;
+	attachment.samples		  = VK_SAMPLE_COUNT_1_BIT;
+	attachment.loadOp		  = keepContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachment.storeOp		  = VK_ATTACHMENT_STORE_OP_STORE;
+	attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// The frame graph moves the image in and out of attachment layout with its own barriers
+	attachment.initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	attachment.finalLayout	  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint	 = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments	 = &color_reference;
+
+	VkRenderPassCreateInfo render_pass_create_info{};
+	render_pass_create_info.sType			= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	render_pass_create_info.attachmentCount = 1;
+	render_pass_create_info.pAttachments	= &attachment;
+	render_pass_create_info.subpassCount	= 1;
+	render_pass_create_info.pSubpasses		= &subpass;
+
+	VkRenderPass render_pass = VK_NULL_HANDLE;
+	auto const result = vkCreateRenderPass(context.device, &render_pass_create_info, nullptr, &render_pass);
+	if(result != VK_SUCCESS)
+		std::cout << "Error from Vulkan during vkCreateRenderPass: " << magic_enum::enum_name(result) << std::endl;
+	return render_pass;
+}
+
+auto vulkan_create_framebuffers(auto const &context, auto &window) -> bool {
+	auto const needs_render_passes = !context.hasDynamicRendering;
+	if(needs_render_passes) {
+		window.clearRenderPass = vulkan_create_render_pass(context, window.format, false);
+		window.loadRenderPass  = vulkan_create_render_pass(context, window.format, true);
+		if(window.clearRenderPass==VK_NULL_HANDLE || window.loadRenderPass==VK_NULL_HANDLE)
+			return false;
+	}
+	for(auto image : window.images) {
+		VkImageViewCreateInfo view_create_info{};
+		view_create_info.sType			  = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		view_create_info.image			  = image;
+		view_create_info.viewType		  = VK_IMAGE_VIEW_TYPE_2D;
+		view_create_info.format			  = window.format;
+		view_create_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+		VkImageView view = VK_NULL_HANDLE;
+		if(vkCreateImageView(context.device, &view_create_info, nullptr, &view) != VK_SUCCESS)
+			return false;
+		window.imageViews.push_back(view);
+		if(!needs_render_passes)
+			continue;
+
+		// Both render passes are compatible, one framebuffer serves either
+		VkFramebufferCreateInfo framebuffer_create_info{};
+		framebuffer_create_info.sType			= VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebuffer_create_info.renderPass		= window.clearRenderPass;
+		framebuffer_create_info.attachmentCount = 1;
+		framebuffer_create_info.pAttachments	= &view;
+		framebuffer_create_info.width			= window.extent.width;
+		framebuffer_create_info.height			= window.extent.height;
+		framebuffer_create_info.layers			= 1;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+		if(vkCreateFramebuffer(context.device, &framebuffer_create_info, nullptr, &framebuffer) != VK_SUCCESS)
+			return false;
+		window.framebuffers.push_back(framebuffer);
+	}
+	return true;
+}
+
+auto vulkan_destroy_swapchain_resources(auto const &context, auto &window) {
+	for(auto framebuffer : window.framebuffers)
+		vkDestroyFramebuffer(context.device, framebuffer, nullptr);
+	window.framebuffers.clear();
+	for(auto view : window.imageViews)
+		vkDestroyImageView(context.device, view, nullptr);
+	window.imageViews.clear();
+	for(auto renderPass : {window.clearRenderPass, window.loadRenderPass})
+		if(renderPass != VK_NULL_HANDLE)
+			vkDestroyRenderPass(context.device, renderPass, nullptr);
+	window.clearRenderPass = window.loadRenderPass = VK_NULL_HANDLE;
+	for(auto semaphore : window.renderFinished)
+		vkDestroySemaphore(context.device, semaphore, nullptr);
+	window.renderFinished.clear();
+	window.images.clear();
+}
+
+auto vulkan_destroy_swapchain(auto const &context, auto &window) {
+	vulkan_destroy_swapchain_resources(context, window);
+	if(window.swapchain != VK_NULL_HANDLE)
+		vkDestroySwapchainKHR(context.device, window.swapchain, nullptr);
+	window.swapchain = VK_NULL_HANDLE;
+}
+
+auto vulkan_create_swapchain(auto const &context, auto &window, VkSwapchainKHR oldSwapchain) -> bool {
+	VkSurfaceCapabilitiesKHR capabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(context.gpu, window.surface, &capabilities);
+
+	uint32_t format_count = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(context.gpu, window.surface, &format_count, nullptr);
+	std::vector<VkSurfaceFormatKHR> formats(format_count);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(context.gpu, window.surface, &format_count, formats.data());
+	if(formats.empty())
+		return false;
+	auto surface_format = formats[0];
+	for(auto const &format : formats)
+		if(format.format==VK_FORMAT_B8G8R8A8_UNORM && format.colorSpace==VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+			surface_format = format;
+
+	VkExtent2D extent = capabilities.currentExtent;
+	if(extent.width==UINT32_MAX) {
+		int width, height;
+		glfwGetFramebufferSize(window.window, &width, &height);
+		extent.width  = std::clamp(static_cast<uint32_t>(width), capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+		extent.height = std::clamp(static_cast<uint32_t>(height), capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+	}
+
+	// Every extra image is another frame the CPU may queue ahead of the display
+	uint32_t image_count = capabilities.minImageCount;
+	if(window.pacer.pacing()==Helgelse::FramePacing::QueueAhead)
+		image_count += 1;
+	if(capabilities.maxImageCount > 0)
+		image_count = std::min(image_count, capabilities.maxImageCount);
+
+	// FIFO is always there and never tears, without vsync prefer mailbox, which doesn't tear either
+	auto present_mode = VK_PRESENT_MODE_FIFO_KHR;
+	if(!window.config.vsync) {
+		uint32_t present_mode_count = 0;
+		vkGetPhysicalDeviceSurfacePresentModesKHR(context.gpu, window.surface, &present_mode_count, nullptr);
+		std::vector<VkPresentModeKHR> present_modes(present_mode_count);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(context.gpu, window.surface, &present_mode_count, present_modes.data());
+		for(auto const mode : {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR})
+			if(present_mode==VK_PRESENT_MODE_FIFO_KHR && std::find(present_modes.begin(), present_modes.end(), mode) != present_modes.end())
+				present_mode = mode;
+	}
+
+	auto composite_alpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	if(window.config.transparent)
+		for(auto const alpha : {VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR, VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR})
+			if(capabilities.supportedCompositeAlpha & alpha)
+				composite_alpha = alpha;
+
+	VkSwapchainCreateInfoKHR swapchain_create_info{};
+	swapchain_create_info.sType			   = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	swapchain_create_info.surface		   = window.surface;
+	swapchain_create_info.minImageCount	   = image_count;
+	swapchain_create_info.imageFormat	   = surface_format.format;
+	swapchain_create_info.imageColorSpace  = surface_format.colorSpace;
+	swapchain_create_info.imageExtent	   = extent;
+	swapchain_create_info.imageArrayLayers = 1;
+	swapchain_create_info.imageUsage	   = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	swapchain_create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	swapchain_create_info.preTransform	   = capabilities.currentTransform;
+	swapchain_create_info.compositeAlpha   = composite_alpha;
+	swapchain_create_info.presentMode	   = present_mode;
+	swapchain_create_info.clipped		   = VK_TRUE;
+	swapchain_create_info.oldSwapchain	   = oldSwapchain;
+
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	auto const result = vkCreateSwapchainKHR(context.device, &swapchain_create_info, nullptr, &swapchain);
+	if(result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkCreateSwapchainKHR: " << magic_enum::enum_name(result) << std::endl;
+		return false;
+	}
+	window.swapchain = swapchain;
+	window.format	 = surface_format.format;
+	window.extent	 = extent;
+
+	uint32_t swapchain_image_count = 0;
+	vkGetSwapchainImagesKHR(context.device, swapchain, &swapchain_image_count, nullptr);
+	window.images.resize(swapchain_image_count);
+	vkGetSwapchainImagesKHR(context.device, swapchain, &swapchain_image_count, window.images.data());
+
+	VkSemaphoreCreateInfo semaphore_create_info{};
+	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	window.renderFinished.resize(swapchain_image_count, VK_NULL_HANDLE);
+	for(auto &semaphore : window.renderFinished)
+		vkCreateSemaphore(context.device, &semaphore_create_info, nullptr, &semaphore);
+	window.damageHistory.reset(swapchain_image_count);
+	if(context.setObjectName) {
+		vulkan_name_object(context, VK_OBJECT_TYPE_SWAPCHAIN_KHR, swapchain, window.name.c_str());
+		for(size_t i = 0; i < window.images.size(); ++i)
+			vulkan_name_object(context, VK_OBJECT_TYPE_IMAGE, window.images[i], (window.name + " image " + std::to_string(i)).c_str());
+	}
+	// Nothing was presented from it yet, it goes right away together with whatever views and framebuffers were made
+	if(!vulkan_create_framebuffers(context, window)) {
+		vulkan_destroy_swapchain(context, window);
+		return false;
+	}
+	return true;
+}
+
+auto vulkan_create_frames(auto const &context, auto &window) -> bool {
+	VkCommandPoolCreateInfo pool_create_info{};
+	pool_create_info.sType			  = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags			  = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_create_info.queueFamilyIndex = context.graphicsQueueFamily;
+	if(vkCreateCommandPool(context.device, &pool_create_info, nullptr, &window.commandPool) != VK_SUCCESS)
+		return false;
+
+	// A single frame in flight means the CPU never records more than one frame ahead of the GPU
+	window.frames.resize(window.pacer.pacing()==Helgelse::FramePacing::LowLatency ? 1 : 2);
+	for(auto &frame : window.frames) {
+		VkCommandBufferAllocateInfo allocate_info{};
+		allocate_info.sType				 = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocate_info.commandPool		 = window.commandPool;
+		allocate_info.level				 = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocate_info.commandBufferCount = 1;
+		VkSemaphoreCreateInfo semaphore_create_info{};
+		semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if(vkAllocateCommandBuffers(context.device, &allocate_info, &frame.commandBuffer) != VK_SUCCESS ||
+		   vkCreateSemaphore(context.device, &semaphore_create_info, nullptr, &frame.imageAvailable) != VK_SUCCESS)
+			return false;
+	}
+	window.frameIndex = 0;
+	return true;
+}
+
+auto vulkan_destroy_frames(auto const &context, auto &window) {
+	for(auto &frame : window.frames)
+		vkDestroySemaphore(context.device, frame.imageAvailable, nullptr);
+	window.frames.clear();
+	if(window.commandPool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(context.device, window.commandPool, nullptr);
+	window.commandPool = VK_NULL_HANDLE;
+}
+
+// Everything of a window that belongs to the device, the GLFW window and its surface outlive a lost device
+auto vulkan_create_window_resources(auto const &context, auto &window) -> bool {
+	VkBool32 present_supported = VK_FALSE;
+	vkGetPhysicalDeviceSurfaceSupportKHR(context.gpu, context.graphicsQueueFamily, window.surface, &present_supported);
+	if(present_supported==VK_FALSE || !vulkan_create_swapchain(context, window, VK_NULL_HANDLE) || !vulkan_create_frames(context, window)) {
+		vulkan_destroy_frames(context, window);
+		vulkan_destroy_swapchain(context, window);
+		return false;
+	}
+	window.presentId	  = 0;
+	window.awaitedPresent = 0;
+	return true;
+}
+
+// Only for a device that is idle or lost, nothing here waits for the GPU
+auto vulkan_destroy_window_resources(auto const &context, auto &window) {
+	context.residency->untrack(window.renderGraphCache.residencyId);
+	vulkan_destroy_render_graph_cache(context, window.renderGraphCache);
+	for(auto &[name, set] : window.culling)
+		vulkan_destroy_cull_set(context, set);
+	window.culling.clear();
+	window.cullPipelines.clear(); // the pipelines belong to the space's cache
+	for(auto &[name, pipeline] : window.culledDrawPipelines)
+		vulkan_destroy_culled_draw_pipeline(context, pipeline);
+	window.culledDrawPipelines.clear();
+	vulkan_destroy_frames(context, window);
+	vulkan_destroy_swapchain(context, window);
+}
+
+auto vulkan_create_window(auto const &context, auto const &name, Helgelse::CreateWindow const &config, GLFWwindow *glfwWindow, Helgelse::FramePacing pacing) -> std::optional<Helgelse::VulkanWindow> {
+	Helgelse::VulkanWindow window;
+	window.name	   = name;
+	window.config  = config;
+	window.context = &context;
+	window.window  = glfwWindow;
+	window.pacer.setPacing(pacing);
+	// Pace against the monitor the window is on, fullscreen windows own theirs
+	auto monitor = glfwGetWindowMonitor(glfwWindow);
+	if(!monitor)
+		monitor = glfwGetPrimaryMonitor();
+	if(auto const mode = monitor ? glfwGetVideoMode(monitor) : nullptr; mode && mode->refreshRate > 0)
+		window.pacer.setRefreshInterval(std::chrono::duration_cast<Helgelse::FramePacer::Clock::duration>(std::chrono::duration<double>(1.0/mode->refreshRate)));
+
+	if(glfwCreateWindowSurface(context.instance, glfwWindow, nullptr, &window.surface) != VK_SUCCESS)
+		return std::nullopt;
+	if(!vulkan_create_window_resources(context, window)) {
+		vkDestroySurfaceKHR(context.instance, window.surface, nullptr);
+		return std::nullopt;
+	}
+	return window;
+}
+
+// The window disappears right away, its Vulkan objects once the GPU is done with its last frame
+auto vulkan_destroy_window(auto const &context, auto &window) {
+	glfwHideWindow(window.window);
+	glfwSetWindowUserPointer(window.window, nullptr);
+	context.residency->untrack(window.renderGraphCache.residencyId); // its eviction callback points into the window
+	auto retired = std::make_shared<Helgelse::VulkanWindow>(std::move(window));
+	vulkan_retire(context, [context, retired] {
+		vulkan_destroy_window_resources(context, *retired);
+		vkDestroySurfaceKHR(context.instance, retired->surface, nullptr);
+		glfwDestroyWindow(retired->window);
+	});
+}
+
+// No device wait: the new swapchain takes over from the old one, which is retired with its views and semaphores
+auto vulkan_recreate_swapchain(auto const &context, auto &window) -> bool {
+	auto retired = std::make_shared<Helgelse::VulkanSwapchain>(Helgelse::VulkanSwapchain{
+		window.swapchain, std::move(window.images), std::move(window.imageViews), std::move(window.framebuffers),
+		std::move(window.renderFinished), window.clearRenderPass, window.loadRenderPass});
+	window.images.clear();
+	window.imageViews.clear();
+	window.framebuffers.clear();
+	window.renderFinished.clear();
+	window.clearRenderPass = window.loadRenderPass = VK_NULL_HANDLE;
+	window.awaitedPresent  = 0; // its present id belongs to the old swapchain
+	auto const created = vulkan_create_swapchain(context, window, retired->swapchain);
+	vulkan_retire(context, [context, retired] { vulkan_destroy_swapchain(context, *retired); });
+	if(!created)
+		window.swapchain = VK_NULL_HANDLE;
+	return created;
+}
+
+// Starts rendering into the window's image, clearing it first when a clear value is given
+auto vulkan_begin_window_rendering(auto const &context, VkCommandBuffer commandBuffer, auto const &window, uint32_t imageIndex, std::optional<VkClearValue> clear) {
+	if(context.hasDynamicRendering) {
+		VkRenderingAttachmentInfoKHR color_attachment{};
+		color_attachment.sType		 = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		color_attachment.imageView	 = window.imageViews[imageIndex];
+		color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		color_attachment.loadOp		 = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+		color_attachment.storeOp	 = VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment.clearValue	 = clear.value_or(VkClearValue{});
+		VkRenderingInfoKHR rendering_info{};
+		rendering_info.sType				= VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		rendering_info.renderArea			= {{0, 0}, window.extent};
+		rendering_info.layerCount			= 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments	= &color_attachment;
+		context.beginRendering(commandBuffer, &rendering_info);
+		return;
+	}
+	VkRenderPassBeginInfo render_pass_begin_info{};
+	render_pass_begin_info.sType		   = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	render_pass_begin_info.renderPass	   = clear ? window.clearRenderPass : window.loadRenderPass;
+	render_pass_begin_info.framebuffer	   = window.framebuffers[imageIndex];
+	render_pass_begin_info.renderArea	   = {{0, 0}, window.extent};
+	render_pass_begin_info.clearValueCount = clear ? 1 : 0;
+	render_pass_begin_info.pClearValues	   = clear ? &*clear : nullptr;
+	vkCmdBeginRenderPass(commandBuffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+auto vulkan_end_window_rendering(auto const &context, VkCommandBuffer commandBuffer) {
+	if(context.hasDynamicRendering)
+		context.endRendering(commandBuffer);
+	else
+		vkCmdEndRenderPass(commandBuffer);
+}
+
+/*
+Brings the GPU sets in line with the space, culls each and draws the survivors into the
+damaged rects of the backbuffer. Sets whose pipelines aren't built yet are skipped,
+without the mesh arena there is nothing to draw and nothing is culled either.
+*/
+auto vulkan_add_window_culling(auto const &context, Helgelse::RenderGraph &graph, auto &window, uint32_t backbuffer, uint32_t imageIndex,
+							   std::vector<Helgelse::Rect> const &rects, std::vector<std::pair<uint32_t, VkBuffer>> &imports) {
+	for(auto it = window.culling.begin(); it != window.culling.end();) {
+		auto const state = window.drawnCullSets.find(it->first);
+		if(state != window.drawnCullSets.end() && state->second.generation==it->second.generation) {
+			++it;
+			continue;
+		}
+		// Replaced or removed, earlier frames may still draw from it
+		vulkan_retire(context, [context, set = it->second]() mutable { vulkan_destroy_cull_set(context, set); });
+		it = window.culling.erase(it);
+	}
+	if(!window.shaders || !window.pipelines || !window.meshes || !*window.meshes || rects.empty())
+		return;
+	auto const &meshes = **window.meshes;
+	for(auto const &[name, state] : window.drawnCullSets) {
+		auto const *pipeline = vulkan_cull_pipeline(context, window.cullPipelines, *window.pipelines, *window.shaders, state.set.shader);
+		auto const *draw_pipeline = vulkan_culled_draw_pipeline(context, window.culledDrawPipelines, *window.shaders, state.set, window.format, window.loadRenderPass);
+		if(!pipeline || !draw_pipeline)
+			continue;
+		auto set = window.culling.find(name);
+		if(set==window.culling.end()) {
+			auto created = vulkan_create_cull_set(context, state, pipeline->setLayout, window.name + " " + name);
+			if(!created)
+				continue;
+			set = window.culling.emplace(name, std::move(*created)).first;
+		}
+		auto const draws = vulkan_add_culling(context, graph, set->second, *pipeline, state.frustum, name, imports);
+		Helgelse::CulledDrawPushConstants const push_constants{state.view.viewProjection};
+		graph.addPass(name + " draw", {{backbuffer, Helgelse::Access::ColorAttachment}, {draws.commands, Helgelse::Access::IndirectBuffer}, {draws.count, Helgelse::Access::IndirectBuffer}},
+					  [&context, &window, &set = set->second, draw_pipeline, &meshes, push_constants, imageIndex, &rects](Helgelse::RenderGraphContext &pass) {
+			vulkan_begin_window_rendering(context, pass.commandBuffer, window, imageIndex, std::nullopt);
+			VkViewport const viewport{0.0f, 0.0f, float(window.extent.width), float(window.extent.height), 0.0f, 1.0f};
+			vkCmdSetViewport(pass.commandBuffer, 0, 1, &viewport);
+			vkCmdBindPipeline(pass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_pipeline->pipeline);
+			vkCmdPushConstants(pass.commandBuffer, draw_pipeline->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants), &push_constants);
+			vulkan_bind_meshes(pass.commandBuffer, meshes);
+			// Like the damage pass, everything outside the rects keeps last frame's pixels
+			for(auto const &rect : rects) {
+				VkRect2D const scissor{{rect.x, rect.y}, {rect.width, rect.height}};
+				vkCmdSetScissor(pass.commandBuffer, 0, 1, &scissor);
+				vulkan_draw_culled(context, pass.commandBuffer, set);
+			}
+			vulkan_end_window_rendering(context, pass.commandBuffer);
+		});
+	}
+}
+
+auto vulkan_record_frame(auto const &context, VkCommandBuffer commandBuffer, auto &window, uint32_t imageIndex, std::vector<Helgelse::Rect> const &rects, bool redrawAll) {
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &begin_info);
+
+	// A full redraw doesn't care what the image held, a partial one builds on the last presented contents
+	Helgelse::RenderGraph graph;
+	auto const backbuffer = graph.importImage("backbuffer", redrawAll ? std::nullopt : std::optional(Helgelse::Access::Present));
+	graph.addPass("damage", {{backbuffer, Helgelse::Access::ColorAttachment}}, [&](Helgelse::RenderGraphContext &pass) {
+		VkClearValue clear_value{};
+		clear_value.color = window.clearColor;
+		vulkan_begin_window_rendering(context, pass.commandBuffer, window, imageIndex, redrawAll ? std::optional(clear_value) : std::nullopt);
+
+		// Only the damaged rects are repainted, everything outside them keeps last frame's pixels
+		if(!redrawAll && !rects.empty()) {
+			VkClearAttachment clear_attachment{VK_IMAGE_ASPECT_COLOR_BIT, 0, clear_value};
+			std::vector<VkClearRect> clear_rects;
+			for(auto const &rect : rects)
+				clear_rects.push_back(VkClearRect{{{rect.x, rect.y}, {rect.width, rect.height}}, 0, 1});
+			vkCmdClearAttachments(pass.commandBuffer, 1, &clear_attachment, clear_rects.size(), clear_rects.data());
+		}
+		vulkan_end_window_rendering(context, pass.commandBuffer);
+	});
+	graph.markOutput(backbuffer, Helgelse::Access::Present);
+	std::vector<std::pair<uint32_t, VkBuffer>> imports;
+	vulkan_add_window_culling(context, graph, window, backbuffer, imageIndex, rects, imports);
+
+	auto compiled = graph.compile();
+	Helgelse::RenderGraphContext graph_context{commandBuffer, window.extent};
+	graph_context.images.resize(graph.resources().size(), VK_NULL_HANDLE);
+	graph_context.imageViews.resize(graph.resources().size(), VK_NULL_HANDLE);
+	graph_context.images[backbuffer]	 = window.images[imageIndex];
+	graph_context.imageViews[backbuffer] = window.imageViews[imageIndex];
+	graph_context.buffers.resize(graph.resources().size(), VK_NULL_HANDLE);
+	for(auto const &[resource, buffer] : imports)
+		graph_context.buffers[resource] = buffer;
+	if(window.textures && *window.textures) {
+		auto const &textures = **window.textures;
+		graph_context.texture = [&textures](std::string_view name) { return vulkan_texture_view(textures, name); };
+		graph_context.sampler = textures.sampler;
+	}
+	if(vulkan_realize_render_graph(context, graph, compiled, window.renderGraphCache, graph_context))
+		vulkan_execute_render_graph(context, graph, compiled, graph_context);
+	vkEndCommandBuffer(commandBuffer);
+}
+
+/*
+Checks with a zero timeout whether the awaited present reached the display, the frame
+loop calls it every time it comes around so waiting for a vblank never holds up the
+other windows or input.
+*/
+auto vulkan_poll_present(auto const &context, auto &window) {
+	if(window.awaitedPresent==0 || window.swapchain==VK_NULL_HANDLE)
+		return;
+	auto const now	  = Helgelse::FramePacer::Clock::now();
+	auto const result = vulkan_check_device(context, context.waitForPresent(context.device, window.swapchain, window.awaitedPresent, 0));
+	if(result==VK_TIMEOUT) {
+		window.presentPolled = now;
+		return;
+	}
+	if(result==VK_SUCCESS)
+		window.pacer.displayedBetween(window.presentPolled, now);
+	window.awaitedPresent = 0; // shown or never will be, e.g. the swapchain went out of date
+}
+
+auto vulkan_draw_frame(auto const &context, auto &window, Helgelse::DamageRegion const &damage) -> VkResult {
+	auto &frame = window.frames[window.frameIndex];
+	if(!context.timeline->wait(frame.submitted) && vulkan_device_lost(context))
+		return VK_ERROR_DEVICE_LOST;
+
+	uint32_t image_index = 0;
+	// Bounded so an occluded window whose compositor holds on to its images can't block the other windows
+	auto const acquire_timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(2*window.pacer.interval()).count();
+	auto result = vulkan_check_device(context, vkAcquireNextImageKHR(context.device, window.swapchain, acquire_timeout, frame.imageAvailable, VK_NULL_HANDLE, &image_index));
+	if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		return result;
+	window.pacer.acquired();
+
+	// The acquired image may be a few frames old, repair everything it missed as well
+	auto const repair = window.damageHistory.repairRegion(image_index, damage);
+	auto const rects = repair.resolve(window.extent.width, window.extent.height);
+	auto const redraw_all = rects.size()==1 && rects[0]==Helgelse::Rect{0, 0, window.extent.width, window.extent.height};
+	window.damageHistory.drawn(image_index, damage);
+
+	vkResetCommandBuffer(frame.commandBuffer, 0);
+	vulkan_record_frame(context, frame.commandBuffer, window, image_index, rects, redraw_all);
+
+	// The binary semaphore is for the presentation engine, the timeline value tells everyone else when the frame is done
+	auto const submitted = context.timeline->upcoming();
+	VkSemaphore const signal_semaphores[] {window.renderFinished[image_index], context.timeline->semaphore};
+	uint64_t const signal_values[] {0, submitted};
+	/*
+	Textures are only handed out once the CPU saw their upload complete, waiting for the
+	transfer value reached by now never stalls but makes the copies visible to this frame.
+	*/
+	VkSemaphore const wait_semaphores[] {frame.imageAvailable, context.transfers->semaphore};
+	uint64_t const wait_values[] {0, context.transfers->progress()};
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+	timeline_submit_info.sType					   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_submit_info.waitSemaphoreValueCount   = 2;
+	timeline_submit_info.pWaitSemaphoreValues	   = wait_values;
+	timeline_submit_info.signalSemaphoreValueCount = 2;
+	timeline_submit_info.pSignalSemaphoreValues	   = signal_values;
+
+	VkPipelineStageFlags const wait_stages[] {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+	VkSubmitInfo submit_info{};
+	submit_info.sType				 = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext				 = &timeline_submit_info;
+	submit_info.waitSemaphoreCount	 = 2;
+	submit_info.pWaitSemaphores		 = wait_semaphores;
+	submit_info.pWaitDstStageMask	 = wait_stages;
+	submit_info.commandBufferCount	 = 1;
+	submit_info.pCommandBuffers		 = &frame.commandBuffer;
+	submit_info.signalSemaphoreCount = 2;
+	submit_info.pSignalSemaphores	 = signal_semaphores;
+	result = vulkan_check_device(context, vkQueueSubmit(context.graphicsQueue, 1, &submit_info, VK_NULL_HANDLE));
+	if(result != VK_SUCCESS) {
+		std::cout << "Error from Vulkan during vkQueueSubmit: " << magic_enum::enum_name(result) << std::endl;
+		return result;
+	}
+	frame.submitted = context.timeline->next();
+
+	// Tell the compositor which parts changed so it can skip copying the rest
+	std::vector<VkRectLayerKHR> present_rects;
+	for(auto const &rect : damage.resolve(window.extent.width, window.extent.height))
+		present_rects.push_back(VkRectLayerKHR{{rect.x, rect.y}, {rect.width, rect.height}, 0});
+	VkPresentRegionKHR present_region{};
+	present_region.rectangleCount = present_rects.size();
+	present_region.pRectangles	  = present_rects.data();
+	VkPresentRegionsKHR present_regions{};
+	present_regions.sType		   = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+	present_regions.swapchainCount = 1;
+	present_regions.pRegions	   = &present_region;
+
+	auto const present_id = ++window.presentId;
+	VkPresentIdKHR present_id_info{};
+	present_id_info.sType		   = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	present_id_info.pNext		   = context.hasIncrementalPresent ? &present_regions : nullptr;
+	present_id_info.swapchainCount = 1;
+	present_id_info.pPresentIds	   = &present_id;
+
+	VkPresentInfoKHR present_info{};
+	present_info.sType				= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	present_info.pNext				= context.hasPresentWait ? static_cast<void const*>(&present_id_info) : context.hasIncrementalPresent ? static_cast<void const*>(&present_regions) : nullptr;
+	present_info.waitSemaphoreCount = 1;
+	present_info.pWaitSemaphores	= &window.renderFinished[image_index];
+	present_info.swapchainCount		= 1;
+	present_info.pSwapchains		= &window.swapchain;
+	present_info.pImageIndices		= &image_index;
+	result = vulkan_check_device(context, vkQueuePresentKHR(context.graphicsQueue, &present_info));
+	window.pacer.presented();
+
+	// The pacer learns the real vblank once the frame is on screen, vulkan_poll_present looks for that without blocking
+	if(context.hasPresentWait && window.pacer.pacing()==Helgelse::FramePacing::LowLatency && (result==VK_SUCCESS || result==VK_SUBOPTIMAL_KHR)) {
+		window.awaitedPresent = present_id;
+		window.presentPolled  = Helgelse::FramePacer::Clock::now();
+		vulkan_poll_present(context, window);
+	}
+
+	window.frameIndex = (window.frameIndex+1) % window.frames.size();
+	return result;
+}
+
+/*
+Everything but success after a frame was drawn. The frame took the window's damage out
+of the tracker, so whatever went wrong short of losing the device marks the window
+again and a later iteration retries. Returns false when the device is lost, the other
+windows would fail the same way and the frame loop replaces it first.
+*/
+auto vulkan_handle_frame_result(auto const &context, Helgelse::VulkanWindow &window, Helgelse::ChangeTracker &changes, VkResult result, Helgelse::FramePacer::Clock::time_point now) -> bool {
+	if(result==VK_SUCCESS)
+		return true;
+	if(result==VK_ERROR_DEVICE_LOST || vulkan_device_lost(context))
+		return false;
+	if(result==VK_ERROR_OUT_OF_DATE_KHR || result==VK_SUBOPTIMAL_KHR)
+		vulkan_recreate_swapchain(context, window);
+	else if(result==VK_TIMEOUT || result==VK_NOT_READY)
+		window.throttledUntil = now + std::chrono::milliseconds(250); // most likely occluded: retry a few times a second instead of every frame
+	else
+		std::cout << "Error from Vulkan during frame: " << magic_enum::enum_name(result) << std::endl;
+	changes.markChanged(window.name);
+	return true;
+}
+
+/*
+While the user drags a window edge some platforms keep the thread inside their own
+modal loop until the drag ends, so nothing outside GLFW callbacks runs. The swapchain
+is therefore rebuilt and a frame drawn right in the size callback, which keeps the
+contents tracking the drag at full rate instead of stretching a stale image.
+*/
+inline auto glfw_resize_window(GLFWwindow *glfwWindow, int width, int height) -> void {
+	auto const window = static_cast<Helgelse::VulkanWindow*>(glfwGetWindowUserPointer(glfwWindow));
+	if(!window || !window->context)
+		return;
+	// A zero sized framebuffer can't have a swapchain, keep the old one until the window has an area again
+	window->hasArea = width > 0 && height > 0;
+	if(!window->hasArea)
+		return;
+	if(!vulkan_recreate_swapchain(*window->context, *window))
+		return;
+	if(window->changes)
+		window->changes->takeDamage(window->name);
+	auto const now = Helgelse::FramePacer::Clock::now();
+	window->pacer.beginFrame(now);
+	auto const result = vulkan_draw_frame(*window->context, *window, Helgelse::DamageRegion::everything());
+	// A lost device is left to the frame loop, which notices it once the drag lets go
+	if(window->changes)
+		vulkan_handle_frame_result(*window->context, *window, *window->changes, result, now);
+}
+
+inline auto glfw_set_resize_callback(Helgelse::VulkanWindow &window) -> void {
+	glfwSetFramebufferSizeCallback(window.window, glfw_resize_window);
+}
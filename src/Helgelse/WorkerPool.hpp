@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Helgelse {
+/*
+A fixed set of threads draining one job queue, for work that must stay off the thread
+calling insert and off the frame loop (file reads, decoding). Threads start with the
+first job, so a space that never loads anything never spawns them. Jobs still queued
+when the pool is destroyed are dropped, running ones are finished.
+*/
+struct WorkerPool {
+	explicit WorkerPool(size_t threads=0) : threadCount(threads != 0 ? threads : std::max(2u, std::thread::hardware_concurrency())-1) {}
+	WorkerPool(WorkerPool const&) = delete;
+	auto operator=(WorkerPool const&) -> WorkerPool& = delete;
+
+	~WorkerPool() {
+		{
+			std::lock_guard lock(this->mutex);
+			this->stopping = true;
+			this->jobs.clear();
+		}
+		this->wake.notify_all();
+		for(auto &thread : this->threads)
+			thread.join();
+	}
+
+	auto submit(std::function<void()> job) {
+		{
+			std::lock_guard lock(this->mutex);
+			this->jobs.push_back(std::move(job));
+			// One thread per job that is queued or running, up to the limit, so a burst starts as many as it can use
+			if(this->threads.size() < std::min(this->threadCount, this->busy + this->jobs.size()))
+				this->threads.emplace_back([this] { this->run(); });
+		}
+		this->wake.notify_one();
+	}
+
+	// Jobs queued or running
+	auto pending() -> size_t {
+		std::lock_guard lock(this->mutex);
+		return this->jobs.size() + this->busy;
+	}
+
+	// Blocks until every job submitted so far has finished
+	auto drain() {
+		std::unique_lock lock(this->mutex);
+		this->idle.wait(lock, [this] { return this->jobs.empty() && this->busy==0; });
+	}
+
+private:
+	auto run() -> void {
+		std::unique_lock lock(this->mutex);
+		while(true) {
+			this->wake.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+			if(this->stopping)
+				return;
+			auto job = std::move(this->jobs.front());
+			this->jobs.pop_front();
+			++this->busy;
+			lock.unlock();
+			job();
+			lock.lock();
+			--this->busy;
+			if(this->jobs.empty() && this->busy==0)
+				this->idle.notify_all();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::deque<std::function<void()>> jobs;
+	std::vector<std::thread> threads;
+	size_t threadCount;
+	size_t busy = 0;
+	bool stopping = false;
+};
+}
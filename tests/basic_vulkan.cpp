@@ -3,6 +3,9 @@
 #include "Helgelse/GLFWVulkanSpace.hpp"
 #include "PathSpace.hpp"
 
+#include <cstring>
+#include <vector>
+
 
 using namespace FSNG;
 using namespace Helgelse;
@@ -14,4 +17,47 @@ TEST_CASE("Basic Vulkan") {
         space.insert("/graphics", PathSpaceTE(GLFWVulkanSpace()));
         space.insert("/graphics/windows/main", CreateWindow{.title="Main", .fullscreen=false});
     }
+
+    // Needs no window, runs headless on lavapipe
+    SECTION("Compute Doubles A Buffer") {
+        /*
+        Hand assembled so the test needs no shader compiler:
+            layout(set=0, binding=0) buffer Data { uint values[]; };
+            void main() { values[gl_GlobalInvocationID.x] *= 2; }
+        */
+        std::vector<uint32_t> const spirv{
+            0x07230203, 0x00010000, 0x00000000, 0x00000016, 0x00000000, 0x00020011, 0x00000001, 0x0003000e,
+            0x00000000, 0x00000001, 0x0006000f, 0x00000005, 0x0000000f, 0x6e69616d, 0x00000000, 0x00000006,
+            0x00060010, 0x0000000f, 0x00000011, 0x00000001, 0x00000001, 0x00000001, 0x00040047, 0x00000006,
+            0x0000000b, 0x0000001c, 0x00040047, 0x0000000a, 0x00000006, 0x00000004, 0x00050048, 0x0000000b,
+            0x00000000, 0x00000023, 0x00000000, 0x00030047, 0x0000000b, 0x00000003, 0x00040047, 0x0000000d,
+            0x00000022, 0x00000000, 0x00040047, 0x0000000d, 0x00000021, 0x00000000, 0x00020013, 0x00000001,
+            0x00030021, 0x00000002, 0x00000001, 0x00040015, 0x00000003, 0x00000020, 0x00000000, 0x00040017,
+            0x00000004, 0x00000003, 0x00000003, 0x00040020, 0x00000005, 0x00000001, 0x00000004, 0x0004003b,
+            0x00000005, 0x00000006, 0x00000001, 0x00040020, 0x00000007, 0x00000001, 0x00000003, 0x0004002b,
+            0x00000003, 0x00000008, 0x00000000, 0x0004002b, 0x00000003, 0x00000009, 0x00000002, 0x0003001d,
+            0x0000000a, 0x00000003, 0x0003001e, 0x0000000b, 0x0000000a, 0x00040020, 0x0000000c, 0x00000002,
+            0x0000000b, 0x0004003b, 0x0000000c, 0x0000000d, 0x00000002, 0x00040020, 0x0000000e, 0x00000002,
+            0x00000003, 0x00050036, 0x00000001, 0x0000000f, 0x00000000, 0x00000002, 0x000200f8, 0x00000010,
+            0x00050041, 0x00000007, 0x00000011, 0x00000006, 0x00000008, 0x0004003d, 0x00000003, 0x00000012,
+            0x00000011, 0x00060041, 0x0000000e, 0x00000013, 0x0000000d, 0x00000008, 0x00000012, 0x0004003d,
+            0x00000003, 0x00000014, 0x00000013, 0x00050084, 0x00000003, 0x00000015, 0x00000014, 0x00000009,
+            0x0003003e, 0x00000013, 0x00000015, 0x000100fd, 0x00010038};
+        std::vector<uint32_t> const values{1, 2, 3, 4};
+        ComputeBuffer buffer;
+        buffer.data.resize(values.size()*4);
+        std::memcpy(buffer.data.data(), values.data(), buffer.data.size());
+
+        GLFWVulkanSpace vulkan;
+        REQUIRE(vulkan.insert(Path("/shaders/double"), spirv));
+        REQUIRE(vulkan.insert(Path("/compute/double"), ComputeJob{.shader="double", .buffers={buffer}, .groups={4, 1, 1}}));
+        ComputeResult result;
+        REQUIRE(vulkan.grabBlock(Path("/compute/double"), &typeid(ComputeResult), &result, false));
+        REQUIRE(result.buffers.size() == 1);
+        std::vector<uint32_t> doubled(values.size());
+        std::memcpy(doubled.data(), result.buffers[0].data(), result.buffers[0].size());
+        REQUIRE(doubled == std::vector<uint32_t>{2, 4, 6, 8});
+        // Grabbing took it
+        REQUIRE_FALSE(vulkan.grab(Path("/compute/double"), &typeid(ComputeResult), &result, false));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <catch.hpp>
+
+#include "Helgelse/ChangeTracker.hpp"
+
+using namespace Helgelse;
+
+TEST_CASE("Change Tracker") {
+    int wakes = 0;
+    ChangeTracker changes{[&wakes] { ++wakes; }};
+
+    SECTION("Changes Are Per Window") {
+        changes.markChanged("main");
+        REQUIRE(wakes == 1);
+        REQUIRE(changes.takeDamage("other").has_value() == false);
+        REQUIRE(changes.takeDamage("main").has_value());
+        REQUIRE(changes.takeDamage("main").has_value() == false);
+    }
+
+    SECTION("Repeated Changes Collapse Into One Frame") {
+        changes.markChanged("main");
+        changes.markChanged("main");
+        REQUIRE(wakes == 2);
+        REQUIRE(changes.takeDamage("main")->full);
+        REQUIRE(changes.takeDamage("main").has_value() == false);
+    }
+
+    SECTION("Mode Switch Wakes The Loop") {
+        REQUIRE(changes.renderMode() == RenderMode::Continuous);
+        changes.setMode(RenderMode::OnChange);
+        REQUIRE(changes.renderMode() == RenderMode::OnChange);
+        REQUIRE(wakes == 1);
+    }
+}
+
+TEST_CASE("Damage Tracking") {
+    ChangeTracker changes;
+
+    SECTION("Damage Rects Merge Per Window") {
+        changes.markDamaged("main", Rect{0, 0, 10, 10});
+        changes.markDamaged("main", Rect{5, 5, 10, 10});
+        changes.markDamaged("main", Rect{100, 100, 4, 4});
+        auto const damage = changes.takeDamage("main");
+        REQUIRE(damage.has_value());
+        REQUIRE(damage->full == false);
+        REQUIRE(damage->rects == std::vector<Rect>{Rect{0, 0, 15, 15}, Rect{100, 100, 4, 4}});
+        REQUIRE(changes.takeDamage("main").has_value() == false);
+    }
+
+    SECTION("Any Full Change Wins") {
+        changes.markDamaged("main", Rect{0, 0, 10, 10});
+        changes.markChanged("main");
+        changes.markDamaged("main", Rect{20, 20, 10, 10});
+        REQUIRE(changes.takeDamage("main")->full);
+    }
+
+    SECTION("Mostly Damaged Resolves To Whole Target") {
+        DamageRegion region;
+        region.add(Rect{-10, -10, 100, 100});
+        REQUIRE(region.resolve(100, 100) == std::vector<Rect>{Rect{0, 0, 100, 100}});
+        DamageRegion corner;
+        corner.add(Rect{90, 0, 20, 10});
+        REQUIRE(corner.resolve(100, 100) == std::vector<Rect>{Rect{90, 0, 10, 10}});
+    }
+
+    SECTION("Old Swapchain Images Repair Missed Frames") {
+        DamageHistory history;
+        history.reset(2);
+        DamageRegion clock;
+        clock.add(Rect{0, 0, 8, 8});
+        DamageRegion cursor;
+        cursor.add(Rect{50, 50, 4, 4});
+
+        REQUIRE(history.repairRegion(0, clock).full);
+        history.drawn(0, DamageRegion::everything());
+        REQUIRE(history.repairRegion(1, clock).full);
+        history.drawn(1, clock);
+
+        auto const repair = history.repairRegion(0, cursor);
+        REQUIRE(repair.full == false);
+        REQUIRE(repair.rects == std::vector<Rect>{Rect{50, 50, 4, 4}, Rect{0, 0, 8, 8}});
+        history.drawn(0, cursor);
+
+        REQUIRE(history.repairRegion(1, clock).rects == std::vector<Rect>{Rect{0, 0, 8, 8}, Rect{50, 50, 4, 4}});
+    }
+}
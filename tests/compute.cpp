@@ -0,0 +1,144 @@
+#include <catch.hpp>
+
+#include "Helgelse/Compute.hpp"
+#include "Helgelse/Shader.hpp"
+#include "Helgelse/ShaderWatcher.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+using namespace Helgelse;
+
+TEST_CASE("Shader Library") {
+    ShaderLibrary shaders;
+    std::vector<uint32_t> const spirv{SpirvMagic, 0x00010000, 0, 1, 0};
+
+    SECTION("Only SPIR-V Is Taken") {
+        REQUIRE_FALSE(shaders.set("bad", {0xDEADBEEF, 0, 0, 1, 0}));
+        REQUIRE_FALSE(shaders.set("short", {SpirvMagic}));
+        REQUIRE(shaders.set("double", spirv));
+        REQUIRE(shaders.get("double")->spirv == spirv);
+        REQUIRE_FALSE(shaders.get("bad").has_value());
+    }
+
+    SECTION("Replacing A Shader Bumps Its Version") {
+        shaders.set("double", spirv);
+        auto const first = shaders.version("double");
+        shaders.set("double", spirv);
+        REQUIRE(shaders.version("double") > first);
+        REQUIRE(shaders.remove("double"));
+        REQUIRE(shaders.version("double") == 0);
+    }
+
+    SECTION("Files Are Read As Words") {
+        auto const path = "compute_test.spv";
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<char const*>(spirv.data()), spirv.size()*4);
+        REQUIRE(shader_read_spirv(path) == spirv);
+        std::ofstream(path, std::ios::binary).write("\x03\x02\x23\x07\x00", 5);
+        REQUIRE_FALSE(shader_read_spirv(path).has_value());
+        std::remove(path);
+    }
+
+    SECTION("Staged Shaders Wait For The Commit") {
+        shaders.set("double", spirv);
+        auto const first = shaders.version("double");
+        REQUIRE(shaders.stage("double", spirv));
+        REQUIRE_FALSE(shaders.stage("bad", {0xDEADBEEF, 0, 0, 1, 0}));
+        REQUIRE(shaders.version("double") == first);
+        REQUIRE(shaders.commit());
+        REQUIRE(shaders.version("double") > first);
+        REQUIRE_FALSE(shaders.commit());
+    }
+
+    SECTION("Stages Come From The File Name") {
+        REQUIRE(shader_stage_from_path("shaders/cull.comp") == ShaderStage::Compute);
+        REQUIRE(shader_stage_from_path("blit.frag.hlsl") == ShaderStage::Fragment);
+        REQUIRE_FALSE(shader_stage_from_path("notes.txt").has_value());
+        REQUIRE(shader_is_source("blit.vert"));
+        REQUIRE_FALSE(shader_is_source("blit.vert.spv"));
+        REQUIRE_FALSE(shader_is_source("blit.spirv"));
+        REQUIRE_FALSE(shader_is_source("blit.bin"));
+    }
+}
+
+TEST_CASE("Shader Watcher") {
+    auto const shaders = std::make_shared<ShaderLibrary>();
+    std::vector<uint32_t> const spirv{SpirvMagic, 0x00010000, 0, 1, 0};
+    std::function<void()> whileCompiling;
+    auto const compile = [&](std::string const &source, std::string const&) {
+        if(whileCompiling)
+            whileCompiling();
+        return source=="good" ? ShaderCompileResult{spirv, ""} : ShaderCompileResult{{}, "syntax error"};
+    };
+    int compiled = 0;
+    ShaderWatcher watcher(shaders, compile, [&] { ++compiled; }, std::chrono::milliseconds(0));
+    auto const path = std::filesystem::temp_directory_path() / "shader_watcher_test.comp";
+    auto const write = [&](std::string const &source) {
+        auto const time = std::filesystem::exists(path) ? std::filesystem::last_write_time(path) : std::filesystem::file_time_type{};
+        std::ofstream(path) << source;
+        std::filesystem::last_write_time(path, time + std::chrono::seconds(1)); // changed even within the clock's resolution
+    };
+
+    write("good");
+    watcher.watch("double", path.string());
+    REQUIRE(watcher.poll() == 1);
+    REQUIRE(compiled == 1);
+    REQUIRE(shaders->version("double") == 0);
+    REQUIRE(shaders->commit());
+    auto const first = shaders->version("double");
+    REQUIRE(first > 0);
+    REQUIRE(watcher.poll() == 0);
+
+    SECTION("A Failed Compile Keeps The Last Good Version") {
+        write("bad");
+        REQUIRE(watcher.poll() == 0);
+        REQUIRE_FALSE(shaders->commit());
+        REQUIRE(shaders->version("double") == first);
+        write("good");
+        REQUIRE(watcher.poll() == 1);
+        REQUIRE(shaders->commit());
+        REQUIRE(shaders->version("double") > first);
+    }
+
+    SECTION("Unwatched Files Are Left Alone") {
+        REQUIRE(watcher.unwatch("double"));
+        write("good");
+        REQUIRE(watcher.poll() == 0);
+    }
+
+    SECTION("A Compile Overtaken By An Unwatch Is Dropped") {
+        write("good");
+        whileCompiling = [&] { watcher.unwatch("double"); };
+        REQUIRE(watcher.poll() == 0);
+        REQUIRE_FALSE(shaders->commit());
+        REQUIRE(shaders->version("double") == first);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Compute Job") {
+    ComputeJob job{.shader="double", .buffers={ComputeBuffer{{1, 2, 3, 4}, 0}}};
+    REQUIRE(compute_job_valid(job));
+    REQUIRE(compute_buffer_size(ComputeBuffer{{1, 2}, 16}) == 16);
+
+    SECTION("Every Group Count Must Be Set") {
+        job.groups = {4, 0, 1};
+        REQUIRE_FALSE(compute_job_valid(job));
+    }
+
+    SECTION("Push Constants Fit The Guaranteed Range") {
+        job.pushConstants.resize(ComputePushConstantBytes);
+        REQUIRE(compute_job_valid(job));
+        job.pushConstants.resize(ComputePushConstantBytes+4);
+        REQUIRE_FALSE(compute_job_valid(job));
+    }
+
+    SECTION("Empty Buffers Are Rejected") {
+        job.buffers.push_back(ComputeBuffer{});
+        REQUIRE_FALSE(compute_job_valid(job));
+    }
+}
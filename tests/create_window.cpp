@@ -0,0 +1,25 @@
+#include <catch.hpp>
+
+#include "Helgelse/CreateWindow.hpp"
+
+using namespace Helgelse;
+
+TEST_CASE("Create Window") {
+    SECTION("Defaults") {
+        nlohmann::json json = CreateWindow{.title="Main"};
+        REQUIRE(json["title"] == "Main");
+        REQUIRE(json["width"] == 0);
+        REQUIRE(json["x"].is_null());
+        REQUIRE(json["vsync"] == true);
+    }
+
+    SECTION("Fullscreen On A Monitor") {
+        nlohmann::json json = CreateWindow{.title="Game", .fullscreen=true, .x=10, .monitor=1, .refreshRate=144, .vsync=false};
+        REQUIRE(json["fullscreen"] == true);
+        REQUIRE(json["x"] == 10);
+        REQUIRE(json["y"].is_null());
+        REQUIRE(json["monitor"] == 1);
+        REQUIRE(json["refreshRate"] == 144);
+        REQUIRE(json["vsync"] == false);
+    }
+}
@@ -0,0 +1,79 @@
+#include <catch.hpp>
+
+#include "Helgelse/Culling.hpp"
+#include "Helgelse/Shader.hpp"
+
+#include <vector>
+
+using namespace Helgelse;
+
+TEST_CASE("Culling") {
+    // The identity leaves clip space as is: x and y in -1..1, depth in 0..1
+    auto const frustum = frustum_planes(CullView{}.viewProjection);
+
+    SECTION("Spheres Are Tested Against Every Plane") {
+        REQUIRE(frustum_contains_sphere(frustum, {0.0f, 0.0f, 0.5f, 0.1f}));
+        REQUIRE(frustum_contains_sphere(frustum, {1.05f, 0.0f, 0.5f, 0.1f}));
+        REQUIRE_FALSE(frustum_contains_sphere(frustum, {1.2f, 0.0f, 0.5f, 0.1f}));
+        REQUIRE_FALSE(frustum_contains_sphere(frustum, {0.0f, -3.0f, 0.5f, 1.0f}));
+        REQUIRE_FALSE(frustum_contains_sphere(frustum, {0.0f, 0.0f, -0.5f, 0.1f}));
+        REQUIRE_FALSE(frustum_contains_sphere(frustum, {0.0f, 0.0f, 1.5f, 0.1f}));
+    }
+
+    SECTION("Planes Follow The View") {
+        // Moves everything one unit along x, what sat at the right edge is now outside
+        CullView view;
+        view.viewProjection[12] = 1.0f;
+        auto const moved = frustum_planes(view.viewProjection);
+        REQUIRE(frustum_contains_sphere(moved, {-1.5f, 0.0f, 0.5f, 0.1f}));
+        REQUIRE_FALSE(frustum_contains_sphere(moved, {0.5f, 0.0f, 0.5f, 0.1f}));
+    }
+
+    SECTION("Visible Instances Keep Their Draws") {
+        std::vector<CullInstance> instances(3);
+        instances[0].sphere = {0.0f, 0.0f, 0.5f, 0.1f};
+        instances[0].draw   = {36, 1, 0, 0, 0};
+        instances[1].sphere = {5.0f, 0.0f, 0.5f, 0.1f};
+        instances[1].draw   = {12, 1, 36, 8, 1};
+        instances[2].sphere = {0.5f, 0.5f, 0.5f, 0.1f};
+        instances[2].draw   = {6, 4, 48, 12, 2};
+
+        auto const compacted = cull_instances(frustum, instances);
+        REQUIRE(compacted.size() == 2);
+        REQUIRE(compacted[0].indexCount == 36);
+        REQUIRE(compacted[1].firstInstance == 2);
+        REQUIRE(compacted[1].instanceCount == 4);
+
+        // Without a draw count every instance keeps its slot, the culled one draws nothing
+        auto const slots = cull_instances(frustum, instances, false);
+        REQUIRE(slots.size() == 3);
+        REQUIRE(slots[1].instanceCount == 0);
+        REQUIRE(slots[1].firstIndex == 36);
+        REQUIRE(slots[2].instanceCount == 4);
+    }
+
+    SECTION("Dispatch Covers Every Instance") {
+        REQUIRE(cull_groups(0) == 0);
+        REQUIRE(cull_groups(1) == 1);
+        REQUIRE(cull_groups(CullGroupSize) == 1);
+        REQUIRE(cull_groups(500000) == (500000 + CullGroupSize-1)/CullGroupSize);
+    }
+
+#ifdef HELGELSE_WITH_SHADERC
+    SECTION("The Built In Cull Shader Compiles") {
+        auto const compiled = shader_compile(CullShaderSource, "cull.comp");
+        INFO(compiled.log);
+        REQUIRE(spirv_valid(compiled.spirv));
+        REQUIRE(shader_compile("#version 450\nvoid main() { oops }", "broken.comp").spirv.empty());
+    }
+
+    SECTION("The Built In Draw Shaders Compile") {
+        auto const vertex = shader_compile(CulledVertexShaderSource, "culled.vert");
+        INFO(vertex.log);
+        REQUIRE(spirv_valid(vertex.spirv));
+        auto const fragment = shader_compile(CulledFragmentShaderSource, "culled.frag");
+        INFO(fragment.log);
+        REQUIRE(spirv_valid(fragment.spirv));
+    }
+#endif
+}
@@ -0,0 +1,41 @@
+#include <catch.hpp>
+
+#include "Helgelse/DeletionQueue.hpp"
+
+#include <vector>
+
+using namespace Helgelse;
+
+TEST_CASE("Deletion Queue") {
+    DeletionQueue queue;
+    std::vector<int> destroyed;
+
+    SECTION("Waits For The GPU To Reach The Value") {
+        queue.retire(3, [&] { destroyed.push_back(3); });
+        queue.retire(5, [&] { destroyed.push_back(5); });
+        REQUIRE(queue.collect(2) == 0);
+        REQUIRE(queue.collect(4) == 1);
+        REQUIRE(destroyed == std::vector<int>{3});
+        REQUIRE(queue.size() == 1);
+        REQUIRE(queue.collect(5) == 1);
+        REQUIRE(destroyed == std::vector<int>{3, 5});
+    }
+
+    SECTION("Late Retirements Are Kept In Order") {
+        queue.retire(7, [&] { destroyed.push_back(7); });
+        queue.retire(4, [&] { destroyed.push_back(4); });
+        REQUIRE(queue.collect(4) == 1);
+        REQUIRE(destroyed == std::vector<int>{4});
+    }
+
+    SECTION("Destructors May Retire More") {
+        queue.retire(1, [&] {
+            destroyed.push_back(1);
+            queue.retire(2, [&] { destroyed.push_back(2); });
+        });
+        REQUIRE(queue.collect(1) == 1);
+        REQUIRE(queue.size() == 1);
+        REQUIRE(queue.flush() == 1);
+        REQUIRE(destroyed == std::vector<int>{1, 2});
+    }
+}
@@ -0,0 +1,66 @@
+#include <catch.hpp>
+
+#include "Helgelse/FramePacer.hpp"
+
+using namespace Helgelse;
+using namespace std::chrono_literals;
+
+TEST_CASE("Frame Pacer") {
+    auto const t0 = FramePacer::Clock::time_point{} + 1s;
+
+    SECTION("Queue Ahead Starts Immediately") {
+        FramePacer pacer{FramePacing::QueueAhead, 16ms};
+        pacer.beginFrame(t0);
+        pacer.acquired(t0 + 1ms);
+        pacer.presented(t0 + 4ms);
+        REQUIRE(pacer.nextFrameStart(t0 + 5ms) == t0 + 5ms);
+    }
+
+    SECTION("Low Latency Delays Start Until Just Before VBlank") {
+        FramePacer pacer{FramePacing::LowLatency, 16ms};
+        REQUIRE(pacer.nextFrameStart(t0) == t0);
+
+        pacer.beginFrame(t0);
+        pacer.acquired(t0);
+        pacer.presented(t0 + 4ms);
+        REQUIRE(pacer.acquireToPresentLatency() == 4ms);
+        REQUIRE(pacer.workEstimate() == 8ms);
+
+        auto const start = pacer.nextFrameStart(t0 + 4ms);
+        REQUIRE(start > t0 + 4ms);
+        REQUIRE(start + pacer.workEstimate() < t0 + 16ms);
+    }
+
+    SECTION("Present Timing Overrides Acquire Estimate") {
+        FramePacer pacer{FramePacing::LowLatency, 16ms};
+        pacer.beginFrame(t0);
+        pacer.acquired(t0);
+        pacer.presented(t0 + 2ms);
+        pacer.displayed(t0 + 10ms);
+        pacer.acquired(t0 + 12ms);
+        REQUIRE(pacer.nextFrameStart(t0 + 11ms) == t0 + 26ms - pacer.workEstimate() - 500us);
+    }
+
+    SECTION("Polled Presents Land On The VBlank Between Two Looks") {
+        FramePacer pacer{FramePacing::LowLatency, 16ms};
+        pacer.displayed(t0);
+        pacer.displayedBetween(t0 + 10ms, t0 + 20ms);
+        pacer.beginFrame(t0 + 20ms);
+        pacer.presented(t0 + 22ms);
+        REQUIRE(pacer.nextFrameStart(t0 + 22ms) == t0 + 32ms - pacer.workEstimate() - 500us);
+
+        // Nothing of the estimate between the looks, the later one is all there is
+        pacer.displayedBetween(t0 + 34ms, t0 + 40ms);
+        REQUIRE(pacer.nextFrameStart(t0 + 40ms) == t0 + 56ms - pacer.workEstimate() - 500us);
+    }
+
+    SECTION("Missed VBlank Targets The Next One") {
+        FramePacer pacer{FramePacing::LowLatency, 16ms};
+        pacer.beginFrame(t0);
+        pacer.acquired(t0);
+        pacer.presented(t0 + 2ms);
+        auto const start = pacer.nextFrameStart(t0 + 40ms);
+        REQUIRE(start >= t0 + 40ms);
+        REQUIRE(start + pacer.workEstimate() + 500us == t0 + 48ms);
+    }
+}
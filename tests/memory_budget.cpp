@@ -0,0 +1,60 @@
+#include <catch.hpp>
+
+#include "Helgelse/MemoryBudget.hpp"
+
+#include <vector>
+
+using namespace Helgelse;
+
+TEST_CASE("Memory Residency") {
+    MemoryResidency residency;
+    std::vector<int> evicted;
+    auto const oldest = residency.track(0, 100, MemoryResidency::Eviction::Recreate, [&] { evicted.push_back(1); });
+    residency.beginFrame();
+    auto const newer = residency.track(0, 100, MemoryResidency::Eviction::ToHost, [&] { evicted.push_back(2); });
+    residency.track(1, 500, MemoryResidency::Eviction::Recreate, [&] { evicted.push_back(3); });
+    residency.beginFrame();
+
+    SECTION("Least Recently Used Goes First") {
+        REQUIRE(residency.evict(0, 50) == 100);
+        REQUIRE(evicted == std::vector<int>{1});
+        REQUIRE(residency.tracked(0) == 100);
+    }
+
+    SECTION("Touched Allocations Move To The Back") {
+        residency.touch(oldest);
+        residency.beginFrame();
+        REQUIRE(residency.evict(0, 50) == 100);
+        REQUIRE(evicted == std::vector<int>{2});
+    }
+
+    SECTION("Allocations Used This Frame Are Kept") {
+        residency.touch(oldest);
+        residency.touch(newer);
+        REQUIRE(residency.evict(0, 1000) == 0);
+        REQUIRE(evicted.empty());
+    }
+
+    SECTION("Watermarks") {
+        MemoryStats stats;
+        stats.heaps = {HeapBudget{.usage=950, .budget=1000}, HeapBudget{.usage=500, .budget=1000}};
+        // 950 is past 90%, evict down to 800 which takes both heap 0 allocations; heap 1 is fine
+        REQUIRE(residency.enforce(stats) == 200);
+        REQUIRE(evicted == std::vector<int>{1, 2});
+        REQUIRE(stats.evictedBytes == 200);
+        REQUIRE(stats.evictions == 1);
+        REQUIRE(residency.tracked(1) == 500);
+    }
+}
+
+TEST_CASE("Memory Stats") {
+    MemoryResidency residency;
+    residency.track(0, 300, MemoryResidency::Eviction::Recreate, {});
+    residency.beginFrame();
+    MemoryStats stats;
+    stats.heaps = {HeapBudget{.usage=1000, .budget=1000}};
+    REQUIRE(residency.update(stats) == 300);
+    REQUIRE(residency.update(stats) == 0);
+    REQUIRE(residency.stats().evictedBytes == 300);
+    REQUIRE(residency.stats().heaps.size() == 1);
+}
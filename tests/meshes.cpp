@@ -0,0 +1,92 @@
+#include <catch.hpp>
+
+#include "Helgelse/Mesh.hpp"
+
+#include <vector>
+
+using namespace Helgelse;
+
+TEST_CASE("Mesh Arena") {
+    SECTION("Ranges Are Handed Out First Fit And Merge When Freed") {
+        ArenaAllocator arena(100);
+        REQUIRE(arena.allocate(40) == 0u);
+        REQUIRE(arena.allocate(40) == 40u);
+        REQUIRE_FALSE(arena.allocate(30).has_value());
+        REQUIRE(arena.used() == 80);
+        REQUIRE(arena.extent() == 80);
+
+        arena.free(0, 40);
+        REQUIRE(arena.allocate(10) == 0u);
+        // The freed range and the tail are merged once the middle goes as well
+        arena.free(40, 40);
+        arena.free(0, 10);
+        REQUIRE(arena.used() == 0);
+        REQUIRE(arena.extent() == 0);
+        REQUIRE(arena.allocate(100) == 0u);
+    }
+
+    SECTION("Growing Keeps Every Offset") {
+        ArenaAllocator arena(64);
+        REQUIRE(arena.allocate(60) == 0u);
+        REQUIRE_FALSE(arena.allocate(10).has_value());
+        arena.grow(128);
+        REQUIRE(arena.capacity() == 128);
+        // The last 4 of the old capacity and the new space are one range
+        REQUIRE(arena.allocate(10) == 60u);
+        REQUIRE(arena.used() == 70);
+    }
+
+    SECTION("Meshes Draw From Their Range") {
+        MeshRange const range{100, 4, 600, 6};
+        auto const draw = mesh_draw(range, 3, 7);
+        REQUIRE(draw.indexCount == 6);
+        REQUIRE(draw.firstIndex == 600);
+        REQUIRE(draw.vertexOffset == 100);
+        REQUIRE(draw.instanceCount == 3);
+        REQUIRE(draw.firstInstance == 7);
+    }
+}
+
+TEST_CASE("Mesh Library") {
+    Mesh quad;
+    quad.vertices.resize(4);
+    quad.indices = {0, 1, 2, 2, 3, 0};
+    MeshLibrary library;
+
+    SECTION("Only Whole Triangles Within The Vertices Are Taken") {
+        REQUIRE(mesh_valid(quad));
+        auto broken = quad;
+        broken.indices.push_back(1);
+        REQUIRE_FALSE(library.set("broken", broken));
+        broken.indices = {0, 1, 4};
+        REQUIRE_FALSE(library.set("broken", broken));
+        REQUIRE_FALSE(library.info("broken").has_value());
+    }
+
+    SECTION("Replaced Meshes Upload Once At Their Latest Generation") {
+        REQUIRE(library.set("quad", quad));
+        REQUIRE(library.set("quad", quad));
+        auto const pending = library.takePending();
+        REQUIRE(pending.size() == 1);
+        REQUIRE(library.info("quad")->state == MeshState::Uploading);
+
+        REQUIRE_FALSE(library.uploaded("quad", pending[0].generation-1, MeshRange{0, 4, 0, 6}));
+        REQUIRE(library.uploaded("quad", pending[0].generation, MeshRange{0, 4, 0, 6}));
+        REQUIRE(library.wait("quad")->state == MeshState::Resident);
+        REQUIRE(library.info("quad")->range == MeshRange{0, 4, 0, 6});
+    }
+
+    SECTION("Removed Meshes Are Reported And Reloads Bring The Rest Back") {
+        library.set("quad", quad);
+        library.set("other", quad);
+        library.takePending();
+        REQUIRE(library.remove("quad") != nullptr);
+        REQUIRE(library.takeRemoved() == std::vector<std::string>{"quad"});
+        REQUIRE_FALSE(library.wait("quad").has_value());
+
+        library.reloadAll();
+        auto const pending = library.takePending();
+        REQUIRE(pending.size() == 1);
+        REQUIRE(pending[0].name == "other");
+    }
+}
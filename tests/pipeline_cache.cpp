@@ -0,0 +1,112 @@
+#include <catch.hpp>
+
+#include "Helgelse/PipelineCache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using namespace Helgelse;
+
+TEST_CASE("Pipeline Description") {
+    Shader const blur{{SpirvMagic, 0x00010000, 0, 1, 0}, 1, spirv_hash(std::vector<uint32_t>{SpirvMagic, 0x00010000, 0, 1, 0})};
+    Shader const copy{blur.spirv, 2, blur.hash}; // the same SPIR-V under another id
+
+    SECTION("Equal Shaders Make Equal Descriptions") {
+        REQUIRE(compute_pipeline_description(blur, 3) == compute_pipeline_description(copy, 3));
+        REQUIRE(pipeline_hash(compute_pipeline_description(blur, 3)) == pipeline_hash(compute_pipeline_description(copy, 3)));
+        REQUIRE_FALSE(compute_pipeline_description(blur, 3) == compute_pipeline_description(blur, 2));
+    }
+
+    SECTION("Every Field Counts") {
+        PipelineDescription description{.shaders={{ShaderStage::Compute, 1}, {ShaderStage::Compute, 2}}, .storageBuffers=2};
+        auto const hash = pipeline_hash(description);
+        auto changed = description;
+        changed.storageBuffers = 3;
+        REQUIRE(pipeline_hash(changed) != hash);
+        changed = description;
+        changed.shaders[1].stage = ShaderStage::Fragment;
+        REQUIRE(pipeline_hash(changed) != hash);
+        changed = description;
+        std::swap(changed.shaders[0], changed.shaders[1]);
+        REQUIRE(pipeline_hash(changed) != hash);
+    }
+}
+
+TEST_CASE("Pipeline Cache") {
+    std::atomic<int> woken = 0;
+    std::atomic<int> built = 0;
+    PipelineCache<int> cache([&] { ++woken; }, 2);
+    PipelineDescription const blit{.shaders={{ShaderStage::Compute, 1}}, .storageBuffers=2};
+    PipelineDescription const cull{.shaders={{ShaderStage::Compute, 2}}, .storageBuffers=3};
+    auto const create = [&](int pipeline) {
+        return [&, pipeline] { ++built; return std::optional(pipeline); };
+    };
+
+    SECTION("Identical Descriptions Share One Build") {
+        REQUIRE(cache.get(blit, create(10)) == nullptr);
+        cache.get(blit, create(11)); // whether or not the first build is done by now
+        cache.wait();
+        REQUIRE(built == 1);
+        REQUIRE(woken == 1);
+        REQUIRE(cache.takeFinished() == 1);
+        REQUIRE_FALSE(cache.building(blit));
+        auto const *pipeline = cache.get(blit, create(12));
+        REQUIRE(pipeline != nullptr);
+        REQUIRE(*pipeline == 10);
+        REQUIRE(cache.find(blit) == pipeline);
+        REQUIRE(cache.size() == 1);
+    }
+
+    SECTION("A Failed Build Isn't Retried") {
+        REQUIRE(cache.get(blit, [&] { ++built; return std::optional<int>(); }) == nullptr);
+        cache.wait();
+        REQUIRE_FALSE(cache.building(blit));
+        REQUIRE(cache.get(blit, create(10)) == nullptr);
+        cache.wait();
+        REQUIRE(built == 1);
+        REQUIRE(cache.find(blit) == nullptr);
+    }
+
+    SECTION("Pipelines Of Gone Shaders Are Evicted Once Unused") {
+        cache.get(blit, create(10));
+        cache.get(cull, create(30));
+        cache.wait();
+        for(int tick = 0; tick < 3; ++tick)
+            cache.tick();
+        REQUIRE(cache.evict({1, 2}, 2).empty()); // both shaders are still there
+        REQUIRE(cache.find(cull) != nullptr);	 // a fallback use keeps it around
+        REQUIRE(cache.evict({1}, 2).empty());
+        cache.tick();
+        cache.tick();
+        REQUIRE(cache.evict({1}, 2) == std::vector<int>{30});
+        REQUIRE(cache.find(cull) == nullptr);
+        REQUIRE(cache.find(blit) != nullptr);
+    }
+
+    SECTION("Evicted Descriptions Build Again") {
+        cache.get(cull, create(30));
+        cache.wait();
+        cache.tick();
+        REQUIRE(cache.evict({}, 1) == std::vector<int>{30});
+        REQUIRE(cache.get(cull, create(31)) == nullptr);
+        cache.wait();
+        REQUIRE(built == 2);
+        REQUIRE(*cache.get(cull, create(32)) == 31);
+    }
+
+    SECTION("Reset Hands Back Every Pipeline") {
+        cache.get(blit, create(10));
+        cache.get(cull, create(30));
+        auto pipelines = cache.reset();
+        std::sort(pipelines.begin(), pipelines.end());
+        REQUIRE(pipelines == std::vector<int>{10, 30});
+        REQUIRE(cache.size() == 0);
+        REQUIRE(cache.takeFinished() == 0);
+        cache.get(blit, create(10));
+        cache.wait();
+        REQUIRE(built == 3);
+    }
+}
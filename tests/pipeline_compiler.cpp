@@ -0,0 +1,59 @@
+#include <catch.hpp>
+
+#include "Helgelse/PipelineCompiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+using namespace Helgelse;
+
+TEST_CASE("Pipeline Compiler") {
+    std::atomic<int> woken = 0;
+    PipelineCompiler<int> compiler([&] { ++woken; }, 2);
+
+    SECTION("Builds Are Handed Over Once") {
+        REQUIRE(compiler.build("blit", 1, [] { return std::optional(10); }));
+        REQUIRE_FALSE(compiler.build("blit", 1, [] { return std::optional(11); }));
+        compiler.wait();
+        REQUIRE(woken == 1);
+        REQUIRE(compiler.takeFinished() == 1);
+        REQUIRE(compiler.building("blit"));
+        REQUIRE(compiler.take("blit") == std::vector<int>{10});
+        REQUIRE_FALSE(compiler.building("blit"));
+        REQUIRE(compiler.take("blit").empty());
+    }
+
+    SECTION("A Failed Build Waits For The Next Version") {
+        REQUIRE(compiler.build("blit", 1, [] { return std::optional<int>(); }));
+        compiler.wait();
+        REQUIRE_FALSE(compiler.building("blit"));
+        REQUIRE(compiler.take("blit").empty());
+        REQUIRE_FALSE(compiler.build("blit", 1, [] { return std::optional(10); }));
+        REQUIRE(compiler.build("blit", 2, [] { return std::optional(20); }));
+        compiler.wait();
+        REQUIRE(compiler.take("blit") == std::vector<int>{20});
+    }
+
+    SECTION("Forgotten Keys Build Any Version Again") {
+        compiler.build("blit", 1, [] { return std::optional(10); });
+        compiler.wait();
+        REQUIRE(compiler.forget("blit") == std::vector<int>{10});
+        REQUIRE_FALSE(compiler.building("blit"));
+        REQUIRE(compiler.build("blit", 1, [] { return std::optional(11); }));
+        compiler.wait();
+        REQUIRE(compiler.take("blit") == std::vector<int>{11});
+    }
+
+    SECTION("Reset Hands Back What Nobody Took") {
+        compiler.build("blit", 1, [] { return std::optional(10); });
+        compiler.build("cull", 1, [] { return std::optional(30); });
+        auto untaken = compiler.reset();
+        std::sort(untaken.begin(), untaken.end());
+        REQUIRE(untaken == std::vector<int>{10, 30});
+        REQUIRE(compiler.takeFinished() == 0);
+        REQUIRE(compiler.build("blit", 1, [] { return std::optional(10); }));
+        compiler.wait();
+    }
+}
@@ -0,0 +1,151 @@
+#include <catch.hpp>
+
+#include "Helgelse/RenderGraph.hpp"
+
+using namespace Helgelse;
+
+TEST_CASE("Render Graph") {
+    RenderGraph graph;
+    auto const backbuffer = graph.importImage("backbuffer", std::nullopt);
+    auto const scene = graph.createImage("scene", 800, 600, 44);
+    auto const blurred = graph.createImage("blurred", 400, 300, 44);
+
+    SECTION("Unused Passes Are Culled") {
+        auto const unused = graph.createImage("unused", 16, 16, 44);
+        graph.addPass("debug", {{unused, Access::ColorAttachment}}, {});
+        graph.addPass("draw", {{backbuffer, Access::ColorAttachment}}, {});
+        graph.markOutput(backbuffer, Access::Present);
+        auto const compiled = graph.compile();
+        REQUIRE(compiled.order == std::vector<uint32_t>{1});
+    }
+
+    SECTION("Culling Only Runs For A Draw That Reads It") {
+        auto const commands = graph.importBuffer("commands", std::nullopt);
+        graph.addPass("cull", {{commands, Access::StorageWrite}}, {});
+        graph.addPass("clear", {{backbuffer, Access::ColorAttachment}}, {});
+        graph.markOutput(backbuffer, Access::Present);
+        REQUIRE(graph.compile().order == std::vector<uint32_t>{1});
+
+        graph.addPass("draw", {{commands, Access::IndirectBuffer}, {backbuffer, Access::ColorAttachment}}, {});
+        REQUIRE(graph.compile().order == std::vector<uint32_t>{0, 1, 2});
+    }
+
+    SECTION("Side Effects Keep A Pass Alive") {
+        auto const readback = graph.createBuffer("readback", 64);
+        graph.addPass("readback", {{readback, Access::TransferDst}}, {}, true);
+        REQUIRE(graph.compile().order == std::vector<uint32_t>{0});
+    }
+
+    SECTION("Barriers Follow The Resource Through The Frame") {
+        graph.addPass("scene", {{scene, Access::ColorAttachment}}, {});
+        graph.addPass("blur", {{scene, Access::Sampled}, {blurred, Access::ColorAttachment}}, {});
+        graph.addPass("composite", {{blurred, Access::Sampled}, {backbuffer, Access::ColorAttachment}}, {});
+        graph.markOutput(backbuffer, Access::Present);
+        auto const compiled = graph.compile();
+        REQUIRE(compiled.order == std::vector<uint32_t>{0, 1, 2});
+
+        REQUIRE(compiled.barriers[0].size() == 1);
+        REQUIRE(compiled.barriers[0][0].oldLayout == Layout::Undefined);
+        REQUIRE(compiled.barriers[0][0].newLayout == Layout::ColorAttachment);
+        REQUIRE(compiled.barriers[0][0].after.empty());
+
+        REQUIRE(compiled.barriers[1].size() == 2);
+        REQUIRE(compiled.barriers[1][0].resource == scene);
+        REQUIRE(compiled.barriers[1][0].after == std::vector<Access>{Access::ColorAttachment});
+        REQUIRE(compiled.barriers[1][0].newLayout == Layout::ShaderReadOnly);
+
+        REQUIRE(compiled.finalBarriers.size() == 1);
+        REQUIRE(compiled.finalBarriers[0].resource == backbuffer);
+        REQUIRE(compiled.finalBarriers[0].oldLayout == Layout::ColorAttachment);
+        REQUIRE(compiled.finalBarriers[0].newLayout == Layout::Present);
+
+        REQUIRE(compiled.lifetimes[scene] == std::pair<uint32_t, uint32_t>{0, 1});
+        REQUIRE(compiled.lifetimes[blurred] == std::pair<uint32_t, uint32_t>{1, 2});
+    }
+
+    SECTION("Repeated Reads Need No Barrier") {
+        graph.addPass("scene", {{scene, Access::ColorAttachment}}, {});
+        graph.addPass("blur", {{scene, Access::Sampled}, {blurred, Access::ColorAttachment}}, {});
+        graph.addPass("composite", {{scene, Access::Sampled}, {blurred, Access::Sampled}, {backbuffer, Access::ColorAttachment}}, {});
+        graph.markOutput(backbuffer, Access::Present);
+        auto const compiled = graph.compile();
+        for(auto const &barrier : compiled.barriers[2])
+            REQUIRE(barrier.resource != scene);
+    }
+
+    SECTION("Writes Wait For Earlier Readers") {
+        graph.addPass("scene", {{scene, Access::StorageWrite}}, {});
+        graph.addPass("read", {{scene, Access::StorageRead}, {blurred, Access::StorageWrite}}, {});
+        graph.addPass("overwrite", {{scene, Access::StorageWrite}, {blurred, Access::StorageRead}, {backbuffer, Access::ColorAttachment}}, {});
+        graph.markOutput(backbuffer, Access::Present);
+        auto const compiled = graph.compile();
+        REQUIRE(compiled.order == std::vector<uint32_t>{0, 1, 2});
+        REQUIRE(compiled.barriers[2][0].resource == scene);
+        REQUIRE(compiled.barriers[2][0].after == std::vector<Access>{Access::StorageRead});
+    }
+
+    SECTION("Independent Passes Are Grouped By Level") {
+        auto const shadowA = graph.createImage("shadowA", 64, 64, 126);
+        auto const shadowB = graph.createImage("shadowB", 64, 64, 126);
+        auto const other = graph.importImage("other", std::nullopt);
+        graph.addPass("shadowA", {{shadowA, Access::DepthAttachment}}, {});
+        graph.addPass("drawA", {{shadowA, Access::Sampled}, {backbuffer, Access::ColorAttachment}}, {});
+        graph.addPass("shadowB", {{shadowB, Access::DepthAttachment}}, {});
+        graph.addPass("drawB", {{shadowB, Access::Sampled}, {other, Access::ColorAttachment}}, {});
+        graph.markOutput(backbuffer, Access::Present);
+        graph.markOutput(other, Access::Present);
+        REQUIRE(graph.compile().order == std::vector<uint32_t>{0, 2, 1, 3});
+    }
+
+    SECTION("Imported Contents Are Kept") {
+        auto const kept = graph.importImage("kept", Access::Present);
+        graph.addPass("damage", {{kept, Access::ColorAttachment}}, {});
+        graph.markOutput(kept, Access::Present);
+        auto const compiled = graph.compile();
+        REQUIRE(compiled.barriers[0][0].oldLayout == Layout::Present);
+        REQUIRE(compiled.barriers[0][0].after == std::vector<Access>{Access::Present});
+    }
+}
+
+TEST_CASE("Render Graph Aliasing") {
+    RenderGraph graph;
+    auto const backbuffer = graph.importImage("backbuffer", std::nullopt);
+    auto const scene = graph.createImage("scene", 800, 600, 44);
+    auto const blurX = graph.createImage("blur x", 800, 600, 44);
+    auto const blurY = graph.createImage("blur y", 800, 600, 44);
+    graph.addPass("scene", {{scene, Access::ColorAttachment}}, {});
+    graph.addPass("blur x", {{scene, Access::Sampled}, {blurX, Access::ColorAttachment}}, {});
+    graph.addPass("blur y", {{blurX, Access::Sampled}, {blurY, Access::ColorAttachment}}, {});
+    graph.addPass("composite", {{blurY, Access::Sampled}, {backbuffer, Access::ColorAttachment}}, {});
+    graph.markOutput(backbuffer, Access::Present);
+    auto compiled = graph.compile();
+
+    std::vector<MemoryRequirement> requirements(4, MemoryRequirement{1024, 256, 0b11});
+    requirements[backbuffer] = {};
+
+    SECTION("Disjoint Lifetimes Share Memory") {
+        auto const plan = graph.alias(compiled, requirements);
+        REQUIRE(plan.blocks.size() == 1);
+        REQUIRE(plan.blocks[0].size == 2048);
+        REQUIRE(plan.placements[backbuffer].block == UINT32_MAX);
+        // scene dies when blur y is born, so blur y takes its place
+        REQUIRE(plan.placements[scene].offset == plan.placements[blurY].offset);
+        REQUIRE(plan.placements[scene].offset != plan.placements[blurX].offset);
+    }
+
+    SECTION("First Use Waits For The Previous Occupant") {
+        graph.alias(compiled, requirements);
+        auto const &barriers = compiled.barriers[2];
+        auto const it = std::find_if(barriers.begin(), barriers.end(), [&](auto const &barrier) { return barrier.resource == blurY; });
+        REQUIRE(it != barriers.end());
+        REQUIRE(std::find(it->after.begin(), it->after.end(), Access::Sampled) != it->after.end());
+        REQUIRE(it->oldLayout == Layout::Undefined);
+    }
+
+    SECTION("Incompatible Memory Types Get Their Own Block") {
+        requirements[blurY].memoryTypeBits = 0b100;
+        auto const plan = graph.alias(compiled, requirements);
+        REQUIRE(plan.blocks.size() == 2);
+        REQUIRE(plan.placements[blurY].block != plan.placements[scene].block);
+    }
+}
@@ -0,0 +1,97 @@
+#include <catch.hpp>
+
+#include "Helgelse/RouteTable.hpp"
+
+#include <string>
+
+using namespace Helgelse;
+
+TEST_CASE("Route Table") {
+    RouteTable<std::string> routes;
+    routes.add<int>("/pacing", "pacing");
+    routes.add<float>("/windows/*", "create");
+    routes.add("/windows/*/**", "content");
+    routes.add<double>("/windows/*/*/bounds", "bounds");
+    auto const intType = std::type_index(typeid(int));
+    auto const floatType = std::type_index(typeid(float));
+    auto const doubleType = std::type_index(typeid(double));
+
+    SECTION("Exact And Typed") {
+        auto const route = routes.find("/pacing", intType);
+        REQUIRE(route.has_value());
+        REQUIRE(*route->first == "pacing");
+        REQUIRE(routes.find("/pacing", floatType).has_value() == false);
+        REQUIRE(routes.find("/unknown", intType).has_value() == false);
+    }
+
+    SECTION("Wildcards Capture Segments") {
+        auto const route = routes.find("/windows/main", floatType);
+        REQUIRE(route.has_value());
+        REQUIRE(*route->first == "create");
+        REQUIRE(route->second.capture(0) == "main");
+        REQUIRE(route->second.remainder.empty());
+    }
+
+    SECTION("Rest Matches Deeper Paths") {
+        auto const route = routes.find("/windows/main/clock/text", intType);
+        REQUIRE(route.has_value());
+        REQUIRE(*route->first == "content");
+        REQUIRE(route->second.capture(0) == "main");
+        REQUIRE(route->second.remainder == "clock/text");
+    }
+
+    SECTION("Typed Routes Win, Otherwise Fall Back To Rest") {
+        auto const bounds = routes.find("/windows/main/clock/bounds", doubleType);
+        REQUIRE(*bounds->first == "bounds");
+        REQUIRE(bounds->second.capture(1) == "clock");
+
+        auto const content = routes.find("/windows/main/clock/bounds", intType);
+        REQUIRE(*content->first == "content");
+        REQUIRE(content->second.remainder == "clock/bounds");
+
+        auto const item = routes.find("/windows/main/clock", intType);
+        REQUIRE(*item->first == "content");
+        REQUIRE(item->second.remainder == "clock");
+    }
+
+    SECTION("The Path Behind A Capture Is Forwarded As Is") {
+        auto const content = routes.find("/windows/main/clock/text/", intType);
+        REQUIRE(content->second.after(0) == "/clock/text");
+        REQUIRE(content->second.after(1).empty());
+
+        auto const bounds = routes.find("/windows/main/clock/bounds", doubleType);
+        REQUIRE(bounds->second.after(0) == "/clock/bounds");
+        REQUIRE(bounds->second.after(1) == "/bounds");
+
+        REQUIRE(routes.find("/windows/main", floatType)->second.after(0).empty());
+    }
+
+    SECTION("Names Equal To Literal Segments Still Reach Wildcards") {
+        routes.add<int>("/windows/*/culling/*", "cull set");
+        auto const bounds = routes.find("/windows/main/culling/bounds", doubleType);
+        REQUIRE(*bounds->first == "bounds");
+        REQUIRE(bounds->second.capture(1) == "culling");
+        REQUIRE(bounds->second.captureCount == 2);
+
+        auto const set = routes.find("/windows/main/culling/bounds", intType);
+        REQUIRE(*set->first == "cull set");
+        REQUIRE(set->second.capture(1) == "bounds");
+
+        auto const content = routes.find("/windows/main/culling/bounds", floatType);
+        REQUIRE(*content->first == "content");
+        REQUIRE(content->second.captureCount == 1);
+        REQUIRE(content->second.remainder == "culling/bounds");
+    }
+
+    SECTION("Window Node Without Matching Type") {
+        REQUIRE(routes.find("/windows/main", intType).has_value() == false);
+    }
+
+    SECTION("Compile Time Slots Match Runtime Types") {
+        auto const slot = RouteTable<std::string>::typeSlot<float>();
+        REQUIRE(routes.slotOf(floatType) == slot);
+        REQUIRE(*routes.find("/windows/main", slot)->first == "create");
+        REQUIRE(routes.slotOf(std::type_index(typeid(char))) == RouteTable<std::string>::None);
+        REQUIRE(*routes.find("/windows/main/clock", RouteTable<std::string>::typeSlot<char>())->first == "content");
+    }
+}
@@ -0,0 +1,306 @@
+#include <catch.hpp>
+
+#include "Helgelse/TextureLoader.hpp"
+
+#ifdef HELGELSE_WITH_BASISU
+#include <basisu_comp.h>
+#endif
+
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Helgelse;
+
+namespace {
+auto rgba_texture(uint32_t width, uint32_t height, TextureFormat format, std::vector<uint8_t> texel) -> TextureData {
+    TextureData texture;
+    texture.width = width;
+    texture.height = height;
+    texture.format = format;
+    for(uint32_t i = 0; i < width*height; ++i)
+        texture.bytes.insert(texture.bytes.end(), texel.begin(), texel.end());
+    texture.levels.push_back(TextureLevel{width, height, 0, texture.bytes.size()});
+    return texture;
+}
+
+auto ktx2_file(uint32_t width, uint32_t height, uint32_t vkFormat, uint32_t levelCount, std::vector<uint8_t> const &pixels) -> std::vector<uint8_t> {
+    std::vector<uint8_t> bytes(ktx2::Identifier.begin(), ktx2::Identifier.end());
+    auto const put32 = [&](uint32_t value) { for(int i = 0; i < 4; ++i) bytes.push_back((value >> (8*i)) & 0xFF); };
+    auto const put64 = [&](uint64_t value) { for(int i = 0; i < 8; ++i) bytes.push_back((value >> (8*i)) & 0xFF); };
+    for(auto const value : {vkFormat, 1u, width, height, 0u, 0u, 1u, levelCount, 0u})
+        put32(value);
+    for(int i = 0; i < 4; ++i)
+        put32(0);
+    put64(0);
+    put64(0);
+    put64(ktx2::HeaderSize+24);
+    put64(pixels.size());
+    put64(pixels.size());
+    bytes.insert(bytes.end(), pixels.begin(), pixels.end());
+    return bytes;
+}
+}
+
+TEST_CASE("Texture Data") {
+    SECTION("Mips Go Down To One Texel") {
+        auto texture = rgba_texture(5, 3, TextureFormat::RGBA8, {200, 100, 50, 255});
+        REQUIRE(texture_generate_mips(texture));
+        REQUIRE(texture.levels.size() == 3);
+        REQUIRE(texture.levels[1].width == 2);
+        REQUIRE(texture.levels[1].height == 1);
+        REQUIRE(texture.levels[2].width == 1);
+        REQUIRE(texture.bytes.size() == (5*3+2*1+1)*4);
+        auto const last = texture.levels.back().offset;
+        REQUIRE(std::vector<uint8_t>(texture.bytes.begin()+last, texture.bytes.end()) == std::vector<uint8_t>{200, 100, 50, 255});
+    }
+
+    SECTION("sRGB Averages In Linear Space") {
+        auto texture = rgba_texture(2, 1, TextureFormat::RGBA8_SRGB, {0, 0, 0, 0});
+        texture.bytes[4] = 255;
+        texture.bytes[7] = 255;
+        REQUIRE(texture_generate_mips(texture));
+        auto const *mip = texture.bytes.data()+texture.levels[1].offset;
+        REQUIRE(mip[0] == 188); // half intensity encoded, not 128
+        REQUIRE(mip[3] == 128); // alpha is linear
+    }
+
+    SECTION("Streamed Levels Follow The Screen Size") {
+        REQUIRE(texture_wanted_level(256, 256, 256, 256) == 0);
+        REQUIRE(texture_wanted_level(256, 256, 100, 100) == 1);
+        REQUIRE(texture_wanted_level(256, 128, 32, 32) == 2); // the shorter side decides
+        REQUIRE(texture_wanted_level(256, 256, 0, 0) == 8);
+        REQUIRE(texture_level_fitting(256, 100, 64) == 2);
+        REQUIRE(texture_level_fitting(32, 32, 64) == 0);
+
+        auto texture = rgba_texture(8, 4, TextureFormat::RGBA8, {1, 2, 3, 4});
+        REQUIRE(texture_generate_mips(texture));
+        texture_drop_levels(texture, 1);
+        REQUIRE(texture.firstLevel == 1);
+        REQUIRE(texture.width == 4);
+        REQUIRE(texture.levels.size() == 3);
+        REQUIRE(texture.levels[0].offset == 0);
+        REQUIRE(texture.bytes.size() == (4*2+2*1+1)*4);
+    }
+
+    SECTION("KTX2 Levels Are Read And Missing Mips Generated") {
+        std::vector<uint8_t> pixels(4*4*4, 64);
+        auto const texture = texture_decode_ktx2(ktx2_file(4, 4, ktx2::VkFormatRGBA8Srgb, 0, pixels), TextureFormats::uncompressed());
+        REQUIRE(texture.has_value());
+        REQUIRE(texture->format == TextureFormat::RGBA8_SRGB);
+        REQUIRE(texture->levels.size() == 3);
+        REQUIRE(texture->bytes[texture->levels[2].offset] == 64);
+    }
+
+    SECTION("Truncated KTX2 Is Rejected") {
+        auto bytes = ktx2_file(4, 4, ktx2::VkFormatRGBA8Unorm, 1, std::vector<uint8_t>(64, 1));
+        bytes.resize(bytes.size()-1);
+        REQUIRE_FALSE(texture_decode_ktx2(bytes, TextureFormats::uncompressed()).has_value());
+    }
+
+#ifdef HELGELSE_WITH_ZSTD
+    SECTION("Zstd Supercompressed KTX2 Levels Are Inflated") {
+        std::vector<uint8_t> pixels(8*8*4);
+        for(size_t i = 0; i < pixels.size(); ++i)
+            pixels[i] = static_cast<uint8_t>(i % 7);
+        std::vector<uint8_t> compressed(ZSTD_compressBound(pixels.size()));
+        compressed.resize(ZSTD_compress(compressed.data(), compressed.size(), pixels.data(), pixels.size(), 3));
+        auto bytes = ktx2_file(8, 8, ktx2::VkFormatRGBA8Unorm, 1, compressed);
+        auto const put = [&](size_t offset, uint64_t value, int size) { for(int i = 0; i < size; ++i) bytes[offset+i] = (value >> (8*i)) & 0xFF; };
+        put(44, ktx2::SupercompressionZstd, 4);
+        put(ktx2::HeaderSize+16, pixels.size(), 8); // the level's uncompressed length
+        auto const texture = texture_decode_ktx2(bytes, TextureFormats::uncompressed());
+        REQUIRE(texture.has_value());
+        REQUIRE(texture->bytes == pixels);
+
+        bytes[bytes.size()-2] ^= 0xFF;
+        REQUIRE_FALSE(texture_decode_ktx2(bytes, TextureFormats::uncompressed()).has_value());
+    }
+#endif
+
+#ifdef HELGELSE_WITH_BASISU
+    SECTION("Basis KTX2 Is Transcoded For The Device") {
+        basisu::basisu_encoder_init();
+        basisu::vector<basisu::image> images;
+        images.push_back(basisu::image(8, 8));
+        for(uint32_t y = 0; y < 8; ++y)
+            for(uint32_t x = 0; x < 8; ++x)
+                images[0](x, y) = basisu::color_rgba(200, 40, 40, 255);
+        size_t size = 0;
+        auto *encoded = static_cast<uint8_t*>(basisu::basis_compress(images, basisu::cFlagKTX2 | basisu::cFlagUASTC, 0.0f, &size));
+        REQUIRE(encoded != nullptr);
+        std::vector<uint8_t> const bytes(encoded, encoded+size);
+        basisu::basis_free_data(encoded);
+
+        auto const rgba = texture_decode_ktx2(bytes, TextureFormats::uncompressed());
+        REQUIRE(rgba.has_value());
+        REQUIRE(rgba->transcoded);
+        REQUIRE(rgba->format == TextureFormat::RGBA8);
+        REQUIRE(rgba->levels.size() == 4); // a single stored level gets its mips generated
+        REQUIRE(std::abs(int(rgba->bytes[0])-200) <= 4);
+
+        auto const bc7 = texture_decode_ktx2(bytes, TextureFormats::uncompressed().add(TextureFormat::BC7));
+        REQUIRE(bc7.has_value());
+        REQUIRE(bc7->format == TextureFormat::BC7);
+        REQUIRE(bc7->levels[0].size == 4*16);
+    }
+#endif
+
+    SECTION("Block Compressed KTX2 Uploads Only Where Supported") {
+        auto const bc7 = texture_format_info(TextureFormat::BC7).vkFormat;
+        // 6x6 rounds up to 2x2 blocks of 16 bytes
+        auto const bytes = ktx2_file(6, 6, bc7, 1, std::vector<uint8_t>(64, 7));
+        REQUIRE(texture_level_size(TextureFormat::BC7, 6, 6) == 64);
+        REQUIRE_FALSE(texture_decode_ktx2(bytes, TextureFormats::uncompressed()).has_value());
+        auto const texture = texture_decode_ktx2(bytes, TextureFormats::uncompressed().add(TextureFormat::BC7));
+        REQUIRE(texture.has_value());
+        REQUIRE(texture->format == TextureFormat::BC7);
+        REQUIRE(texture->bytes.size() == 64);
+        auto copy = *texture;
+        REQUIRE_FALSE(texture_generate_mips(copy)); // blocks can't be box filtered
+    }
+
+    SECTION("Transcoding Prefers The Densest Supported Format") {
+        auto const formats = TextureFormats::uncompressed();
+        REQUIRE(texture_transcode_target(formats, true, true) == TextureFormat::RGBA8_SRGB);
+        auto bc = formats;
+        bc.add(TextureFormat::BC1).add(TextureFormat::BC3).add(TextureFormat::BC7);
+        REQUIRE(texture_transcode_target(bc, false, false) == TextureFormat::BC7);
+        bc.bits &= ~(1u << static_cast<uint32_t>(TextureFormat::BC7));
+        REQUIRE(texture_transcode_target(bc, false, false) == TextureFormat::BC1);
+        REQUIRE(texture_transcode_target(bc, true, false) == TextureFormat::BC3);
+        auto mobile = formats;
+        mobile.add(TextureFormat::ETC2_RGBA8_SRGB).add(TextureFormat::ASTC_4x4_SRGB);
+        REQUIRE(texture_transcode_target(mobile, true, true) == TextureFormat::ASTC_4x4_SRGB);
+    }
+
+    SECTION("Decoders Are Chosen By Magic Bytes") {
+        TextureDecoders decoders;
+        decoders.add({'R', 'A', 'W'}, [](std::span<uint8_t const>, TextureFormats const&) { return std::optional(rgba_texture(1, 1, TextureFormat::RGBA8, {1, 2, 3, 4})); });
+        std::vector<uint8_t> const raw{'R', 'A', 'W', 0};
+        std::vector<uint8_t> const other{'P', 'N', 'G', 0};
+        REQUIRE(decoders.supports(raw));
+        REQUIRE(decoders.decode(raw)->bytes == std::vector<uint8_t>{1, 2, 3, 4});
+        REQUIRE_FALSE(decoders.decode(other).has_value());
+    }
+
+#ifdef HELGELSE_WITH_STB_IMAGE
+    SECTION("PNG Decodes To sRGB RGBA") {
+        // 2x1, an opaque red and a half transparent blue texel
+        std::vector<uint8_t> const png{
+            0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+            0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0xF4, 0x22, 0x7F,
+            0x8A, 0x00, 0x00, 0x00, 0x0E, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0xF8, 0xCF, 0xC0, 0x00,
+            0x42, 0x0D, 0x00, 0x0F, 0x7A, 0x03, 0x7E, 0x77, 0xE9, 0x7F, 0x97, 0x00, 0x00, 0x00, 0x00, 0x49,
+            0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82};
+        auto const texture = texture_default_decoders().decode(png);
+        REQUIRE(texture.has_value());
+        REQUIRE(texture->format == TextureFormat::RGBA8_SRGB);
+        REQUIRE(texture->width == 2);
+        REQUIRE(texture->levels.size() == 2);
+        REQUIRE(std::vector<uint8_t>(texture->bytes.begin(), texture->bytes.begin()+8) == std::vector<uint8_t>{255, 0, 0, 255, 0, 0, 255, 128});
+    }
+#endif
+}
+
+TEST_CASE("Texture Loader") {
+    auto const path = std::string("texture_loading_test.ktx2");
+    {
+        auto const bytes = ktx2_file(2, 2, ktx2::VkFormatRGBA8Unorm, 1, std::vector<uint8_t>(16, 9));
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+    }
+    std::atomic<int> wakeups = 0;
+    TextureLoader loader(texture_default_decoders(), [&] { ++wakeups; }, 2);
+
+    SECTION("Decoded Textures Wait For The Upload") {
+        auto const generation = loader.load("tile", path);
+        // The frame loop is woken once the texture is ready to take
+        while(wakeups == 0)
+            std::this_thread::yield();
+        auto const decoded = loader.takeDecoded();
+        REQUIRE(decoded.size() == 1);
+        REQUIRE(decoded[0].name == "tile");
+        REQUIRE(decoded[0].data.levels.size() == 1); // the file asks for exactly one level
+        REQUIRE(loader.info("tile")->state == TextureState::Uploading);
+        REQUIRE(loader.uploaded("tile", generation, true));
+        auto const info = loader.wait("tile");
+        REQUIRE(info->state == TextureState::Resident);
+        REQUIRE(info->mipLevels == 1);
+    }
+
+    SECTION("A Newer Load Supersedes One In Flight") {
+        auto const first = loader.load("tile", path);
+        auto const second = loader.load("tile", path);
+        REQUIRE_FALSE(loader.uploaded("tile", first, true));
+        REQUIRE(loader.uploaded("tile", second, true));
+    }
+
+    SECTION("Missing Files Fail") {
+        loader.load("missing", "does/not/exist.ktx2");
+        REQUIRE(loader.wait("missing")->state == TextureState::Failed);
+        REQUIRE(loader.takeDecoded().empty());
+    }
+
+    SECTION("Textures Stream From Their Tail") {
+        auto const big = std::string("texture_streaming_test.ktx2");
+        {
+            auto const bytes = ktx2_file(256, 256, ktx2::VkFormatRGBA8Unorm, 0, std::vector<uint8_t>(256*256*4, 3));
+            std::ofstream(big, std::ios::binary).write(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+        }
+        auto const next = [&] {
+            std::vector<DecodedTexture> decoded;
+            while(decoded.empty()) {
+                std::this_thread::yield();
+                decoded = loader.takeDecoded();
+            }
+            REQUIRE(decoded.size() == 1);
+            REQUIRE(loader.uploaded(decoded[0].name, decoded[0].generation, true));
+            return decoded[0].data.firstLevel;
+        };
+        loader.load("map", big);
+        REQUIRE(next() == 2); // 64x64 first
+        REQUIRE(loader.info("map")->state == TextureState::Resident);
+        REQUIRE(loader.info("map")->mipLevels == 9);
+
+        // Nothing reported yet, the chain grows to full size
+        loader.stream();
+        REQUIRE(next() == 0);
+        REQUIRE(loader.info("map")->residentLevel == 0);
+
+        // Drawn small, it drops the levels it doesn't need
+        REQUIRE(loader.used("map", TextureUsage{32, 32}));
+        REQUIRE(loader.stream() == std::vector<std::string>{"map"});
+        REQUIRE(next() == 3);
+
+        // One level finer is not worth a reload, but a larger size on screen is
+        loader.used("map", TextureUsage{12, 12});
+        loader.stream();
+        loader.drain(); // a load started by the stream above would be decoded by now
+        REQUIRE(loader.takeDecoded().empty());
+        loader.used("map", TextureUsage{200, 200});
+        loader.stream();
+        REQUIRE(next() == 0);
+
+        // Evicted, it falls back to its tail and stays there until drawn again
+        loader.evict("map");
+        REQUIRE(loader.stream().empty());
+        REQUIRE(next() == 2);
+        loader.stream();
+        loader.drain(); // a load started by the stream above would be decoded by now
+        REQUIRE(loader.takeDecoded().empty());
+        std::remove(big.c_str());
+    }
+
+    SECTION("Removed Textures Stop Waiting") {
+        loader.load("tile", path);
+        loader.remove("tile");
+        REQUIRE_FALSE(loader.wait("tile").has_value());
+        REQUIRE(loader.takeRemoved() == std::vector<std::string>{"tile"});
+        REQUIRE(loader.takeRemoved().empty());
+    }
+    std::remove(path.c_str());
+}
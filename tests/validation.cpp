@@ -0,0 +1,26 @@
+#include <catch.hpp>
+
+#include "Helgelse/Validation.hpp"
+
+#include <cstdlib>
+
+using namespace Helgelse;
+
+TEST_CASE("Validation") {
+    SECTION("Names") {
+        REQUIRE(validation_from_string("none") == Validation::None);
+        REQUIRE(validation_from_string("Validation") == Validation::Standard);
+        REQUIRE(validation_from_string("SYNC") == Validation::Synchronization);
+        REQUIRE(validation_from_string("gpu-assisted") == Validation::GPUAssisted);
+        REQUIRE(validation_from_string("verbose") == std::nullopt);
+    }
+
+    SECTION("Environment Overrides The Request") {
+        setenv("HELGELSE_VALIDATION", "sync", 1);
+        REQUIRE(validation_from_environment(Validation::None) == Validation::Synchronization);
+        setenv("HELGELSE_VALIDATION", "nonsense", 1);
+        REQUIRE(validation_from_environment(Validation::GPUAssisted) == Validation::GPUAssisted);
+        unsetenv("HELGELSE_VALIDATION");
+        REQUIRE(validation_from_environment(Validation::None) == Validation::None);
+    }
+}